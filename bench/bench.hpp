@@ -0,0 +1,121 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+/// \file bench.hpp
+/// A minimal benchmark harness for `cppco`.
+///
+/// Benchmarks are registered with `CPPCO_BENCHMARK` and receive a `cppco_bench::state` that holds the number of
+/// iterations to perform. Each benchmark does its own setup, then brackets the measured region with `state.start()`
+/// and `state.stop()`. The runner grows the iteration count until the measured region takes long enough and then
+/// reports the time and the number of `operator new` calls per iteration.
+
+#ifndef CPPCO_BENCH_BENCH_HPP_INCLUDE_GUARD
+#define CPPCO_BENCH_BENCH_HPP_INCLUDE_GUARD
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace cppco_bench {
+
+/// Stack size used by benchmarks that keep many cothreads alive at once.
+constexpr size_t small_stack_size = 64 * 1024;
+
+/// The number of calls to the global `operator new` since the start of the program.
+size_t allocation_count() noexcept;
+
+/// `cppco_bench::state` is the measurement state of a single benchmark run.
+class state
+{
+public:
+	using clock = std::chrono::steady_clock;
+
+	explicit state(size_t iterations, bool quick = false) noexcept;
+
+	/// The number of operations the benchmark has to perform between `start()` and `stop()`.
+	size_t iterations() const noexcept;
+	/// Whether this is a smoke run with `--quick`. Benchmarks that size their work by themselves keep it small then.
+	bool quick() const noexcept;
+
+	/// Begins the measured region.
+	void start() noexcept;
+	/// Ends the measured region.
+	void stop() noexcept;
+
+	/// The time spent in the measured region.
+	clock::duration elapsed() const noexcept;
+	/// The number of allocations made in the measured region.
+	size_t allocations() const noexcept;
+
+	/// Attaches a free-form note to the report line of the benchmark, e.g. a derived metric.
+	void set_label(std::string label);
+	const std::string& get_label() const noexcept;
+
+private:
+	size_t m_iterations;
+	bool m_quick;
+	clock::time_point m_start;
+	clock::duration m_elapsed{};
+	size_t m_allocation_start = 0;
+	size_t m_allocations = 0;
+	std::string m_label;
+};
+
+using function_t = void (*)(state&);
+
+/// `cppco_bench::benchmark` is a registered benchmark.
+struct benchmark
+{
+	const char* name;
+	function_t function;
+	size_t max_iterations;
+};
+
+/// All benchmarks registered via `CPPCO_BENCHMARK`, in registration order.
+std::vector<benchmark>& registry();
+
+/// Registers a benchmark during static initialization.
+class registrar
+{
+public:
+	registrar(const char* name, function_t function, size_t max_iterations) noexcept;
+};
+
+/// Prevents the compiler from optimizing away the computation of `value`.
+template <typename T>
+inline void do_not_optimize(const T& value) noexcept
+{
+#ifdef __GNUC__
+	__asm__ __volatile__("" : : "r"(&value) : "memory");
+#else // __GNUC__
+	static const void* volatile sink;
+	sink = &value;
+#endif // __GNUC__
+}
+
+} // namespace cppco_bench
+
+/// Defines a benchmark whose iteration count is not limited.
+#define CPPCO_BENCHMARK(NAME) CPPCO_BENCHMARK_LIMIT(NAME, 0)
+
+/// Defines a benchmark with an upper limit on the iteration count.
+///
+/// This is useful for benchmarks that keep one cothread alive per iteration.
+#define CPPCO_BENCHMARK_LIMIT(NAME, MAX_ITERATIONS) \
+	static void NAME(::cppco_bench::state& state); \
+	static const ::cppco_bench::registrar NAME##_registrar(#NAME, &NAME, MAX_ITERATIONS); \
+	static void NAME(::cppco_bench::state& state)
+
+#endif // CPPCO_BENCH_BENCH_HPP_INCLUDE_GUARD
@@ -0,0 +1,95 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+// Benchmarks of `co::channel`. Each iteration is one value passed from a producer cothread to the main cothread, so
+// items per second is 1e9 / (ns/op).
+
+#include "bench.hpp"
+#include <co/channel.hpp>
+
+namespace {
+
+void pass_values(cppco_bench::state& state, size_t capacity, bool batch)
+{
+	auto iterations = state.iterations();
+	co::channel<size_t> channel(capacity);
+	co::thread producer([&channel, iterations]()
+	{
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			channel.send(i);
+		}
+		channel.close();
+		co::active().get_parent().switch_to();
+	}, cppco_bench::small_stack_size);
+	channel.set_sender(producer);
+	auto sum = size_t{ 0 };
+	state.start();
+	if (batch)
+	{
+		size_t values[256];
+		auto count = size_t{ 0 };
+		while ((count = channel.recv_batch(values, 256)) > 0)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				sum += values[i];
+			}
+		}
+	}
+	else
+	{
+		auto value = size_t{ 0 };
+		while (channel.recv(value))
+		{
+			sum += value;
+		}
+	}
+	state.stop();
+	cppco_bench::do_not_optimize(sum);
+}
+
+} // namespace
+
+// Rendezvous: two switches per value.
+CPPCO_BENCHMARK(channel_unbuffered)
+{
+	pass_values(state, 0, false);
+}
+
+CPPCO_BENCHMARK(channel_capacity_1)
+{
+	pass_values(state, 1, false);
+}
+
+CPPCO_BENCHMARK(channel_capacity_16)
+{
+	pass_values(state, 16, false);
+}
+
+CPPCO_BENCHMARK(channel_capacity_256)
+{
+	pass_values(state, 256, false);
+}
+
+CPPCO_BENCHMARK(channel_capacity_4096)
+{
+	pass_values(state, 4096, false);
+}
+
+CPPCO_BENCHMARK(channel_capacity_4096_recv_batch)
+{
+	pass_values(state, 4096, true);
+}
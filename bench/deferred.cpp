@@ -0,0 +1,87 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+// Startup cost of a large graph of cothreads, with eager and with deferred creation. Each iteration constructs one
+// `co::thread`, up to `graph_size` of them are alive at once, and the label reports the time to construct the whole
+// graph. The teardown is not measured.
+
+#include "bench.hpp"
+#include <co.hpp>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t graph_size = 100000;
+
+void yield_forever()
+{
+	while (true)
+	{
+		co::active().get_parent().switch_to();
+	}
+}
+
+std::string per_graph(const cppco_bench::state& state)
+{
+	auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(state.elapsed()).count();
+	auto us = static_cast<size_t>(ns) / state.iterations() * graph_size / 1000;
+	return std::to_string(us) + " us per " + std::to_string(graph_size) + " cothreads";
+}
+
+} // namespace
+
+CPPCO_BENCHMARK_LIMIT(graph_create_eager, graph_size)
+{
+	auto cothreads = std::vector<co::thread>();
+	cothreads.reserve(state.iterations());
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		cothreads.emplace_back(&yield_forever, cppco_bench::small_stack_size);
+	}
+	state.stop();
+	state.set_label(per_graph(state));
+}
+
+CPPCO_BENCHMARK_LIMIT(graph_create_deferred, graph_size)
+{
+	auto cothreads = std::vector<co::thread>();
+	cothreads.reserve(state.iterations());
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		cothreads.emplace_back(co::deferred, &yield_forever, cppco_bench::small_stack_size);
+	}
+	state.stop();
+	state.set_label(per_graph(state));
+}
+
+// The cost that deferral moves to the first switch: creating the cothread and the round trip into it.
+CPPCO_BENCHMARK_LIMIT(graph_deferred_first_switch, graph_size)
+{
+	auto cothreads = std::vector<co::thread>();
+	cothreads.reserve(state.iterations());
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		cothreads.emplace_back(co::deferred, &yield_forever, cppco_bench::small_stack_size);
+	}
+	state.start();
+	for (auto&& cothread : cothreads)
+	{
+		cothread.switch_to();
+	}
+	state.stop();
+}
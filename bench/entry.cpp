@@ -0,0 +1,86 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+// Benchmarks of entry functor storage. Lambdas with a few captures fit `co::thread::inline_entry_size`.
+
+#include "bench.hpp"
+#include <co.hpp>
+
+namespace {
+
+struct large_capture
+{
+	char data[2 * co::thread::inline_entry_size];
+};
+
+} // namespace
+
+// A lambda capturing three references is stored inside the `co::thread`: no allocation with a pooled cothread.
+CPPCO_BENCHMARK(entry_small_lambda)
+{
+	co::thread_pool pool;
+	auto a = 0;
+	auto b = 0;
+	auto c = 0;
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		auto cothread = co::thread([&a, &b, &c]()
+		{
+			++a;
+			++b;
+			++c;
+			co::active().get_parent().switch_to();
+		}, cppco_bench::small_stack_size, pool);
+		cothread.switch_to();
+	}
+	state.stop();
+}
+
+// A lambda capturing more than `co::thread::inline_entry_size` bytes is allocated on the heap.
+CPPCO_BENCHMARK(entry_large_lambda)
+{
+	co::thread_pool pool;
+	auto capture = large_capture{};
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		auto cothread = co::thread([capture]()
+		{
+			cppco_bench::do_not_optimize(capture);
+			co::active().get_parent().switch_to();
+		}, cppco_bench::small_stack_size, pool);
+		cothread.switch_to();
+	}
+	state.stop();
+}
+
+// A `std::function` fits the inline storage too, but allocates internally for captures beyond its own small buffer.
+CPPCO_BENCHMARK(entry_std_function)
+{
+	co::thread_pool pool;
+	auto capture = large_capture{};
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		auto entry = co::thread::entry_t([capture]()
+		{
+			cppco_bench::do_not_optimize(capture);
+			co::active().get_parent().switch_to();
+		});
+		auto cothread = co::thread(std::move(entry), cppco_bench::small_stack_size, pool);
+		cothread.switch_to();
+	}
+	state.stop();
+}
@@ -0,0 +1,67 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+// Benchmarks of `co::executor`. Only built with `CPPCO_THREAD_MIGRATION`.
+
+#include "bench.hpp"
+#include <co/executor.hpp>
+
+namespace {
+
+// Fine grained tasks that yield a few times. A root task spawns them into its own worker's queue, so the other workers
+// only get work by stealing it. Each iteration is one task.
+void fine_grained_tasks(cppco_bench::state& state, size_t workers)
+{
+	const auto iterations = state.iterations();
+	co::executor executor(workers, cppco_bench::small_stack_size);
+	state.start();
+	executor.spawn([iterations]()
+	{
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			co::executor::current()->spawn([]()
+			{
+				for (int j = 0; j < 4; ++j)
+				{
+					co::executor::yield();
+				}
+			});
+		}
+	});
+	executor.wait();
+	state.stop();
+}
+
+} // namespace
+
+CPPCO_BENCHMARK(executor_fine_grained_1_worker)
+{
+	fine_grained_tasks(state, 1);
+}
+
+CPPCO_BENCHMARK(executor_fine_grained_2_workers)
+{
+	fine_grained_tasks(state, 2);
+}
+
+CPPCO_BENCHMARK(executor_fine_grained_4_workers)
+{
+	fine_grained_tasks(state, 4);
+}
+
+CPPCO_BENCHMARK(executor_fine_grained_all_workers)
+{
+	fine_grained_tasks(state, 0);
+}
@@ -0,0 +1,57 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+// Benchmarks of `co::generator`.
+
+#include "bench.hpp"
+#include <co/generator.hpp>
+
+// Each iteration is one value handed from the producer to the consumer, i.e. two switches.
+CPPCO_BENCHMARK(generator_next)
+{
+	auto iterations = state.iterations();
+	co::generator<size_t> counter([iterations](co::generator<size_t>::sink& yield)
+	{
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			yield(i);
+		}
+	}, cppco_bench::small_stack_size);
+	auto sum = size_t{ 0 };
+	state.start();
+	for (auto&& value : counter)
+	{
+		sum += value;
+	}
+	state.stop();
+	cppco_bench::do_not_optimize(sum);
+}
+
+// Restarting a generator that has finished, on the same cothread.
+CPPCO_BENCHMARK(generator_rewind)
+{
+	co::generator<int> single([](co::generator<int>::sink& yield)
+	{
+		yield(1);
+	}, cppco_bench::small_stack_size);
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		single.rewind();
+		single.next();
+		single.next();
+	}
+	state.stop();
+}
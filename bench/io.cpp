@@ -0,0 +1,167 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+// Benchmarks of `co::io` over loopback TCP. Each iteration is one 64 byte round trip: a client writes a message and
+// reads back the echo of a server task.
+
+#include "bench.hpp"
+#include <co/io.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+
+namespace {
+
+constexpr size_t message_size = 64;
+
+int open_listener(sockaddr_in& address)
+{
+	auto listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	address = sockaddr_in{};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	auto length = static_cast<socklen_t>(sizeof(address));
+	if (listener < 0
+		|| bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+		|| listen(listener, SOMAXCONN) != 0
+		|| getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length) != 0)
+	{
+		std::perror("listener");
+		std::abort();
+	}
+	return listener;
+}
+
+bool transfer_all(int fd, char* buffer, bool write)
+{
+	auto done = size_t{ 0 };
+	while (done < message_size)
+	{
+		auto result = write ? co::io::write(fd, buffer + done, message_size - done) : co::io::read(fd, buffer + done, message_size - done);
+		if (result <= 0)
+		{
+			return false;
+		}
+		done += static_cast<size_t>(result);
+	}
+	return true;
+}
+
+void echo(int fd)
+{
+	char buffer[message_size];
+	while (transfer_all(fd, buffer, false) && transfer_all(fd, buffer, true))
+	{
+	}
+	co::io::close(fd);
+}
+
+// Runs the round trips over up to `max_connections` concurrent connections. The measurement starts once every client
+// has connected.
+void echo_round_trips(cppco_bench::state& state, size_t max_connections)
+{
+	auto limit = rlimit{};
+	getrlimit(RLIMIT_NOFILE, &limit);
+	auto connections = std::min(std::min(max_connections, state.iterations()), (static_cast<size_t>(limit.rlim_cur) - 64) / 2);
+	auto iterations = state.iterations();
+	auto address = sockaddr_in{};
+	auto listener = open_listener(address);
+	auto* pstate = &state;
+
+	co::io::reactor reactor;
+	co::scheduler scheduler(32 * 1024);
+	scheduler.spawn([listener, connections, &scheduler]()
+	{
+		for (size_t i = 0; i < connections; ++i)
+		{
+			auto fd = co::io::accept(listener, nullptr, nullptr);
+			if (fd < 0)
+			{
+				std::perror("accept");
+				std::abort();
+			}
+			scheduler.spawn([fd]()
+			{
+				echo(fd);
+			});
+		}
+	});
+	auto parked = std::vector<co::scheduler::handle>();
+	auto connected = size_t{ 0 };
+	auto finished = size_t{ 0 };
+	for (size_t c = 0; c < connections; ++c)
+	{
+		auto rounds = iterations / connections + (c < iterations % connections ? 1 : 0);
+		scheduler.spawn([&, rounds]()
+		{
+			auto fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+			auto no_delay = 1;
+			if (fd < 0
+				|| setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay)) != 0
+				|| co::io::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+			{
+				std::perror("connect");
+				std::abort();
+			}
+			if (++connected == connections)
+			{
+				pstate->start();
+				for (auto&& client : parked)
+				{
+					co::resume(client);
+				}
+			}
+			else
+			{
+				parked.push_back(co::active_task());
+				co::suspend();
+			}
+			char buffer[message_size] = {};
+			for (size_t i = 0; i < rounds; ++i)
+			{
+				transfer_all(fd, buffer, true);
+				transfer_all(fd, buffer, false);
+			}
+			if (++finished == connections)
+			{
+				pstate->stop();
+			}
+			co::io::close(fd);
+		});
+	}
+	reactor.run(scheduler);
+	co::io::close(listener);
+	state.set_label(std::to_string(connections) + (connections == 1 ? " connection" : " connections"));
+}
+
+} // namespace
+
+// A single connection, so every round trip waits for the reactor: the latency of a wake up.
+CPPCO_BENCHMARK(io_echo_1_connection)
+{
+	echo_round_trips(state, 1);
+}
+
+// Many connections share each `epoll_wait`, this is the throughput of the reactor.
+CPPCO_BENCHMARK(io_echo_10k_connections)
+{
+	echo_round_trips(state, 10000);
+}
@@ -0,0 +1,83 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+// Per cothread state accessed from inside a cothread. Each iteration is one access. The `map_*` benchmark looks the
+// value up in a `std::unordered_map` keyed by the active `co::thread`, which is how such state is kept without
+// `co::local`.
+
+#include "bench.hpp"
+#include <co.hpp>
+#include <co/local.hpp>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// The number of cothreads that have a value, so the map is not trivially small.
+constexpr size_t cothread_count = 16;
+
+template <typename F>
+void run_in_cothreads(cppco_bench::state& state, F&& access)
+{
+	auto& parent = co::active();
+	auto sum = size_t{ 0 };
+	std::vector<co::thread> cothreads;
+	cothreads.reserve(cothread_count);
+	for (size_t i = 0; i < cothread_count; ++i)
+	{
+		cothreads.emplace_back([&parent, &state, &access, &sum, i]()
+		{
+			access(i);
+			parent.switch_to();
+			if (i == 0)
+			{
+				state.start();
+				for (size_t j = 0; j < state.iterations(); ++j)
+				{
+					sum += access(j);
+				}
+				state.stop();
+			}
+			parent.switch_to();
+		}, cppco_bench::small_stack_size);
+	}
+	// Give every cothread its value first, then measure from one of them.
+	for (auto&& cothread : cothreads)
+	{
+		cothread.switch_to();
+	}
+	cothreads.front().switch_to();
+	cppco_bench::do_not_optimize(sum);
+}
+
+} // namespace
+
+CPPCO_BENCHMARK(map_access)
+{
+	std::unordered_map<const co::thread*, size_t> values;
+	run_in_cothreads(state, [&values](size_t i)
+	{
+		return values[&co::active()] += i;
+	});
+}
+
+CPPCO_BENCHMARK(local_access)
+{
+	co::local<size_t> values;
+	run_in_cothreads(state, [&values](size_t i)
+	{
+		return *values += i;
+	});
+}
@@ -0,0 +1,237 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+#include "bench.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+
+namespace {
+
+std::atomic<size_t> g_allocations{ 0 };
+
+void* counted_allocate(size_t size)
+{
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	if (size == 0)
+	{
+		size = 1;
+	}
+	if (auto* p = std::malloc(size))
+	{
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+} // namespace
+
+void* operator new(size_t size)
+{
+	return counted_allocate(size);
+}
+void* operator new[](size_t size)
+{
+	return counted_allocate(size);
+}
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+void operator delete[](void* p) noexcept
+{
+	std::free(p);
+}
+void operator delete(void* p, size_t) noexcept
+{
+	std::free(p);
+}
+void operator delete[](void* p, size_t) noexcept
+{
+	std::free(p);
+}
+
+namespace cppco_bench {
+
+size_t allocation_count() noexcept
+{
+	return g_allocations.load(std::memory_order_relaxed);
+}
+
+state::state(size_t iterations, bool quick) noexcept
+	: m_iterations{ iterations }
+	, m_quick{ quick }
+{
+}
+
+size_t state::iterations() const noexcept
+{
+	return m_iterations;
+}
+
+bool state::quick() const noexcept
+{
+	return m_quick;
+}
+
+void state::start() noexcept
+{
+	m_allocation_start = allocation_count();
+	m_start = clock::now();
+}
+
+void state::stop() noexcept
+{
+	auto end = clock::now();
+	m_allocations += allocation_count() - m_allocation_start;
+	m_elapsed += end - m_start;
+}
+
+state::clock::duration state::elapsed() const noexcept
+{
+	return m_elapsed;
+}
+
+size_t state::allocations() const noexcept
+{
+	return m_allocations;
+}
+
+void state::set_label(std::string label)
+{
+	m_label = std::move(label);
+}
+
+const std::string& state::get_label() const noexcept
+{
+	return m_label;
+}
+
+std::vector<benchmark>& registry()
+{
+	static std::vector<benchmark> instance;
+	return instance;
+}
+
+registrar::registrar(const char* name, function_t function, size_t max_iterations) noexcept
+{
+	registry().push_back(benchmark{ name, function, max_iterations });
+}
+
+} // namespace cppco_bench
+
+namespace {
+
+struct run_options
+{
+	std::chrono::nanoseconds min_time = std::chrono::milliseconds(200);
+	size_t max_iterations = 0;
+	bool quick = false;
+	const char* filter = nullptr;
+};
+
+void usage(const char* program)
+{
+	std::printf("Usage: %s [--quick] [--min-time <ms>] [--filter <substring>]\n", program);
+}
+
+void run(const cppco_bench::benchmark& benchmark, const run_options& options)
+{
+	auto limit = benchmark.max_iterations;
+	if (options.max_iterations != 0 && (limit == 0 || options.max_iterations < limit))
+	{
+		limit = options.max_iterations;
+	}
+	size_t iterations = 1;
+	while (true)
+	{
+		auto state = cppco_bench::state(iterations, options.quick);
+		benchmark.function(state);
+		auto elapsed = state.elapsed();
+		auto done = elapsed >= options.min_time || (limit != 0 && iterations >= limit);
+		if (done)
+		{
+			auto ns = std::chrono::duration<double, std::nano>(elapsed).count();
+			std::printf("%-40s %12zu %12.1f %12.2f  %s\n",
+				benchmark.name,
+				iterations,
+				ns / static_cast<double>(iterations),
+				static_cast<double>(state.allocations()) / static_cast<double>(iterations),
+				state.get_label().c_str());
+			std::fflush(stdout);
+			return;
+		}
+		// Aim for the minimum time with some headroom, but grow at most tenfold per round.
+		auto grow = size_t{ 10 };
+		if (elapsed.count() > 0)
+		{
+			auto ratio = 1.4 * static_cast<double>(options.min_time.count()) / static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+			grow = static_cast<size_t>(std::min(10.0, std::max(2.0, ratio)));
+		}
+		iterations *= grow;
+		if (limit != 0 && iterations > limit)
+		{
+			iterations = limit;
+		}
+	}
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	auto options = run_options{};
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--quick") == 0)
+		{
+			options.min_time = std::chrono::nanoseconds(0);
+			options.max_iterations = 64;
+			options.quick = true;
+		}
+		else if (std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc)
+		{
+			options.min_time = std::chrono::milliseconds(std::atol(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+		{
+			options.filter = argv[++i];
+		}
+		else
+		{
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+#ifdef CPPCO_LIBCO_INTEROP
+	std::printf("cppco benchmarks (CPPCO_LIBCO_INTEROP)\n");
+#else // CPPCO_LIBCO_INTEROP
+	std::printf("cppco benchmarks\n");
+#endif // CPPCO_LIBCO_INTEROP
+	std::printf("%-40s %12s %12s %12s\n", "benchmark", "iterations", "ns/op", "allocs/op");
+	for (auto&& benchmark : cppco_bench::registry())
+	{
+		if (options.filter != nullptr && std::strstr(benchmark.name, options.filter) == nullptr)
+		{
+			continue;
+		}
+		run(benchmark, options);
+	}
+	return 0;
+}
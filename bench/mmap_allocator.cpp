@@ -0,0 +1,127 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+// Resident memory of many cothreads with `co::mmap_allocator`.
+//
+// Each benchmark runs a single iteration that creates the cothreads and switches into each of them once, so ns/op is
+// the time for all of them. The label reports the resident memory they added. The count is capped by the available
+// memory and, with guard pages, by `vm.max_map_count`, and the label shows the count that was used and whether it was
+// capped. A `--quick` smoke run creates only a few cothreads.
+
+#include "bench.hpp"
+#include <co/mmap_allocator.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+// The number of cothreads of a `--quick` smoke run.
+constexpr size_t quick_count = 64;
+
+// Reads a single number from a /proc file, or returns `fallback`.
+size_t read_proc(const char* path, const char* key, size_t fallback)
+{
+	auto* file = std::fopen(path, "r");
+	if (file == nullptr)
+	{
+		return fallback;
+	}
+	auto result = fallback;
+	char line[256];
+	while (std::fgets(line, sizeof(line), file) != nullptr)
+	{
+		auto value = 0ul;
+		if (key == nullptr ? std::sscanf(line, "%lu", &value) == 1 : std::sscanf(line, key, &value) == 1)
+		{
+			result = value;
+			break;
+		}
+	}
+	std::fclose(file);
+	return result;
+}
+
+size_t resident_bytes()
+{
+	// The second field of statm is the resident set in pages.
+	auto* file = std::fopen("/proc/self/statm", "r");
+	if (file == nullptr)
+	{
+		return 0;
+	}
+	auto size = 0ul;
+	auto resident = 0ul;
+	if (std::fscanf(file, "%lu %lu", &size, &resident) != 2)
+	{
+		resident = 0;
+	}
+	std::fclose(file);
+	return resident * co::mmap_allocator::page_size();
+}
+
+void measure_rss(cppco_bench::state& state, size_t requested, size_t guard_pages)
+{
+	auto count = state.quick() ? std::min(requested, quick_count) : requested;
+	// Two pages per cothread are touched: the cothread at the bottom of the stack and the frames at the top.
+	auto available = read_proc("/proc/meminfo", "MemAvailable: %lu kB", 0) * 1024;
+	if (available != 0)
+	{
+		count = std::min(count, available / 2 / (4 * co::mmap_allocator::page_size()));
+	}
+	if (guard_pages > 0)
+	{
+		count = std::min(count, (read_proc("/proc/sys/vm/max_map_count", nullptr, 65530) - 1000) / 2);
+	}
+	co::mmap_allocator allocator(guard_pages);
+	auto& parent = co::active();
+	auto cothreads = std::vector<co::thread>();
+	cothreads.reserve(count);
+	auto before = resident_bytes();
+	state.start();
+	for (size_t i = 0; i < count; ++i)
+	{
+		cothreads.emplace_back([&parent]()
+		{
+			parent.switch_to();
+		}, co::thread::default_stack_size, allocator);
+		cothreads.back().switch_to();
+	}
+	state.stop();
+	auto added = resident_bytes() - before;
+	auto capped = count < requested ? " (capped from " + std::to_string(requested) + ")" : std::string();
+	state.set_label(std::to_string(count) + " cothreads" + capped + ", " + std::to_string(added / (1024 * 1024))
+		+ " MiB RSS, " + std::to_string(added / count) + " B each, " + std::to_string(allocator.get_reserved() >> 30) + " GiB reserved");
+}
+
+} // namespace
+
+CPPCO_BENCHMARK_LIMIT(mmap_rss_10k, 1)
+{
+	measure_rss(state, 10000, 1);
+}
+
+CPPCO_BENCHMARK_LIMIT(mmap_rss_100k_no_guard, 1)
+{
+	measure_rss(state, 100000, 0);
+}
+
+CPPCO_BENCHMARK_LIMIT(mmap_rss_1m_no_guard, 1)
+{
+	measure_rss(state, 1000000, 0);
+}
@@ -0,0 +1,86 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+// Spawning, joining and tearing down a batch of `batch_size` short children per iteration, as a `co::nursery` and as a
+// vector of `co::thread`s that are run once and destroyed one by one. A `co::thread` must not return from its entry, so
+// its stack is unwound by the destructor with two more switches, while the nursery releases finished children without
+// switching to them again.
+
+#include "bench.hpp"
+#include <co/nursery.hpp>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t batch_size = 64;
+
+std::string per_child(const cppco_bench::state& state)
+{
+	auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(state.elapsed()).count();
+	return std::to_string(static_cast<size_t>(ns) / (state.iterations() * batch_size)) + " ns per child";
+}
+
+} // namespace
+
+CPPCO_BENCHMARK(nursery_spawn_join)
+{
+	auto counter = size_t{ 0 };
+	co::nursery nursery(cppco_bench::small_stack_size);
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		for (size_t j = 0; j < batch_size; ++j)
+		{
+			nursery.spawn([&counter]()
+			{
+				++counter;
+			});
+		}
+		nursery.join();
+	}
+	state.stop();
+	cppco_bench::do_not_optimize(counter);
+	state.set_label(per_child(state));
+}
+
+CPPCO_BENCHMARK(threads_run_destroy)
+{
+	auto counter = size_t{ 0 };
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		auto children = std::vector<co::thread>();
+		children.reserve(batch_size);
+		for (size_t j = 0; j < batch_size; ++j)
+		{
+			children.emplace_back([&counter]()
+			{
+				++counter;
+				while (true)
+				{
+					co::active().get_parent().switch_to();
+				}
+			}, cppco_bench::small_stack_size);
+		}
+		for (auto&& child : children)
+		{
+			child.switch_to();
+		}
+	}
+	state.stop();
+	cppco_bench::do_not_optimize(counter);
+	state.set_label(per_child(state));
+}
@@ -0,0 +1,104 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+// Benchmarks of `co::scheduler`.
+
+#include "bench.hpp"
+#include <co/scheduler.hpp>
+
+namespace {
+
+// Measures `co::yield()` among `count` tasks. The measurement starts once every task is running, and each iteration
+// is a single `co::yield()`.
+void yield_among(cppco_bench::state& state, size_t count, size_t stack_size)
+{
+	auto started = size_t{ 0 };
+	auto remaining = state.iterations();
+	auto* pstate = &state;
+	co::scheduler scheduler(stack_size);
+	for (size_t i = 0; i < count; ++i)
+	{
+		scheduler.spawn([pstate, count, &started, &remaining]()
+		{
+			if (++started == count)
+			{
+				pstate->start();
+			}
+			co::yield();
+			while (remaining > 0)
+			{
+				if (--remaining == 0)
+				{
+					pstate->stop();
+				}
+				co::yield();
+			}
+		});
+	}
+	scheduler.run();
+}
+
+} // namespace
+
+CPPCO_BENCHMARK(scheduler_yield_2_tasks)
+{
+	yield_among(state, 2, cppco_bench::small_stack_size);
+}
+
+// 100k runnable tasks, so every yield goes to a cold stack.
+CPPCO_BENCHMARK(scheduler_yield_100k_tasks)
+{
+	yield_among(state, 100000, 32 * 1024);
+}
+
+// Spawning a task that returns immediately, running it and reaping it. Nodes and cothreads are reused.
+CPPCO_BENCHMARK(scheduler_spawn_and_finish)
+{
+	co::scheduler scheduler(cppco_bench::small_stack_size);
+	scheduler.spawn([]() {});
+	scheduler.run();
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		scheduler.spawn([]() {});
+		scheduler.run();
+	}
+	state.stop();
+}
+
+// A task suspends and is resumed by another one: the building block of wait lists.
+CPPCO_BENCHMARK(scheduler_suspend_resume)
+{
+	auto iterations = state.iterations();
+	auto sleeper = co::scheduler::handle();
+	co::scheduler scheduler(cppco_bench::small_stack_size);
+	sleeper = scheduler.spawn([iterations]()
+	{
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			co::suspend();
+		}
+	});
+	scheduler.spawn([iterations, &sleeper]()
+	{
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			co::resume(sleeper);
+			co::yield();
+		}
+	});
+	state.start();
+	scheduler.run();
+	state.stop();
+}
@@ -0,0 +1,101 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+// Benchmarks of stopping suspended `co::thread`s in each `co::stop_mode`.
+
+#include "bench.hpp"
+#include <co.hpp>
+#include <vector>
+
+namespace {
+
+void yield_forever()
+{
+	while (true)
+	{
+		co::active().get_parent().switch_to();
+	}
+}
+
+void yield_until_stopped()
+{
+	while (!co::stop_requested())
+	{
+		co::active().get_parent().switch_to();
+	}
+}
+
+void rewind_suspended(cppco_bench::state& state, void (*entry)(), co::stop_mode mode)
+{
+	auto cothread = co::thread(entry, cppco_bench::small_stack_size);
+	cothread.set_stop_mode(mode);
+	cothread.switch_to();
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		cothread.rewind();
+		cothread.switch_to();
+	}
+	state.stop();
+}
+
+void destroy_suspended(cppco_bench::state& state, void (*entry)(), co::stop_mode mode)
+{
+	auto cothreads = std::vector<co::thread>();
+	cothreads.reserve(state.iterations());
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		cothreads.emplace_back(entry, cppco_bench::small_stack_size);
+		cothreads.back().set_stop_mode(mode);
+		cothreads.back().switch_to();
+	}
+	state.start();
+	cothreads.clear();
+	state.stop();
+}
+
+} // namespace
+
+// `rewind()` in `co::stop_mode::unwind` throws `co::thread_stopping` through the entry and reuses the cothread.
+CPPCO_BENCHMARK(rewind_suspended_unwind)
+{
+	rewind_suspended(state, &yield_forever, co::stop_mode::unwind);
+}
+
+// `rewind()` in `co::stop_mode::cooperative` lets the entry return and reuses the cothread.
+CPPCO_BENCHMARK(rewind_suspended_cooperative)
+{
+	rewind_suspended(state, &yield_until_stopped, co::stop_mode::cooperative);
+}
+
+// `rewind()` in `co::stop_mode::abandon` deletes the cothread without switching to it and creates a new one.
+CPPCO_BENCHMARK(rewind_suspended_abandon)
+{
+	rewind_suspended(state, &yield_forever, co::stop_mode::abandon);
+}
+
+CPPCO_BENCHMARK_LIMIT(destroy_suspended_unwind, 10000)
+{
+	destroy_suspended(state, &yield_forever, co::stop_mode::unwind);
+}
+
+CPPCO_BENCHMARK_LIMIT(destroy_suspended_cooperative, 10000)
+{
+	destroy_suspended(state, &yield_until_stopped, co::stop_mode::cooperative);
+}
+
+CPPCO_BENCHMARK_LIMIT(destroy_suspended_abandon, 10000)
+{
+	destroy_suspended(state, &yield_forever, co::stop_mode::abandon);
+}
@@ -0,0 +1,113 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+// Lock and unlock throughput of `co::mutex` against `std::mutex`. Each iteration is one lock and unlock. In the
+// contended benchmarks every holder of the mutex has the other waiters queued up on it: `co::mutex` among scheduler
+// tasks that yield while they hold it, `std::mutex` among OS threads.
+
+#include "bench.hpp"
+#include <co/sync.hpp>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t contenders = 4;
+
+} // namespace
+
+CPPCO_BENCHMARK(co_mutex_uncontended)
+{
+	co::mutex mutex;
+	auto counter = size_t{ 0 };
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		std::lock_guard<co::mutex> lock(mutex);
+		++counter;
+	}
+	state.stop();
+	cppco_bench::do_not_optimize(counter);
+}
+
+CPPCO_BENCHMARK(std_mutex_uncontended)
+{
+	std::mutex mutex;
+	auto counter = size_t{ 0 };
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		++counter;
+	}
+	state.stop();
+	cppco_bench::do_not_optimize(counter);
+}
+
+CPPCO_BENCHMARK(co_mutex_contended_4_tasks)
+{
+	co::scheduler scheduler(cppco_bench::small_stack_size);
+	co::mutex mutex;
+	auto counter = size_t{ 0 };
+	auto remaining = state.iterations();
+	for (size_t i = 0; i < contenders; ++i)
+	{
+		scheduler.spawn([&mutex, &counter, &remaining]()
+		{
+			while (remaining > 0)
+			{
+				std::lock_guard<co::mutex> lock(mutex);
+				if (remaining > 0)
+				{
+					--remaining;
+					++counter;
+				}
+				co::yield();
+			}
+		});
+	}
+	state.start();
+	scheduler.run();
+	state.stop();
+	cppco_bench::do_not_optimize(counter);
+}
+
+CPPCO_BENCHMARK(std_mutex_contended_4_threads)
+{
+	std::mutex mutex;
+	auto counter = size_t{ 0 };
+	auto share = (state.iterations() + contenders - 1) / contenders;
+	std::vector<std::thread> threads;
+	threads.reserve(contenders);
+	state.start();
+	for (size_t i = 0; i < contenders; ++i)
+	{
+		threads.emplace_back([&mutex, &counter, share]()
+		{
+			for (size_t j = 0; j < share; ++j)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				++counter;
+			}
+		});
+	}
+	for (auto&& thread : threads)
+	{
+		thread.join();
+	}
+	state.stop();
+	cppco_bench::do_not_optimize(counter);
+}
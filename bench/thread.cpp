@@ -0,0 +1,275 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+// Benchmarks of the core `co::thread` operations, with raw `libco` calls as the baseline.
+
+#include "bench.hpp"
+#include <co.hpp>
+#include <vector>
+
+namespace {
+
+cothread_t raw_parent = nullptr;
+
+void raw_entry()
+{
+	while (true)
+	{
+		co_switch(raw_parent);
+	}
+}
+
+#ifdef CPPCO_LIBCO_INTEROP
+void raw_active_entry()
+{
+	while (true)
+	{
+		cppco_bench::do_not_optimize(co::active());
+		co_switch(raw_parent);
+	}
+}
+#endif // CPPCO_LIBCO_INTEROP
+
+void yield_forever()
+{
+	while (true)
+	{
+		co::active().get_parent().switch_to();
+	}
+}
+
+struct dummy_failure {};
+
+co::thread_pool& bench_pool()
+{
+	static co::thread_pool pool;
+	return pool;
+}
+
+} // namespace
+
+// A round trip between the calling cothread and a raw `libco` cothread: two `co_switch` calls.
+CPPCO_BENCHMARK(raw_co_switch_ping_pong)
+{
+	raw_parent = co_active();
+	auto cothread = co_create(static_cast<unsigned int>(cppco_bench::small_stack_size), &raw_entry);
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		co_switch(cothread);
+	}
+	state.stop();
+	co_delete(cothread);
+}
+
+// A round trip between the calling cothread and a `co::thread`: two `switch_to` calls.
+CPPCO_BENCHMARK(switch_to_ping_pong)
+{
+	auto cothread = co::thread(&yield_forever, cppco_bench::small_stack_size);
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		cothread.switch_to();
+	}
+	state.stop();
+}
+
+// `switch_to_fast()` on both sides skips the stop and failure checks.
+CPPCO_BENCHMARK(switch_to_fast_ping_pong)
+{
+	auto iterations = state.iterations();
+	auto cothread = co::thread([iterations]()
+	{
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			co::active().get_parent().switch_to_fast();
+		}
+		yield_forever();
+	}, cppco_bench::small_stack_size);
+	state.start();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		cothread.switch_to_fast();
+	}
+	state.stop();
+	cothread.switch_to(); // Leaves the cothread suspended in `switch_to()`, where it can be stopped.
+}
+
+// Round trips to 64 suspended `co::thread`s in turn, so that every switch goes to a cold stack.
+CPPCO_BENCHMARK(switch_to_fan_out_64)
+{
+	constexpr size_t count = 64;
+	auto cothreads = std::vector<co::thread>();
+	cothreads.reserve(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		cothreads.emplace_back(&yield_forever, cppco_bench::small_stack_size);
+	}
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		cothreads[i % count].switch_to();
+	}
+	state.stop();
+}
+
+CPPCO_BENCHMARK(active_on_main)
+{
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		cppco_bench::do_not_optimize(co::active());
+	}
+	state.stop();
+}
+
+CPPCO_BENCHMARK(active_on_cothread)
+{
+	auto* pstate = &state;
+	auto cothread = co::thread([pstate]()
+	{
+		pstate->start();
+		for (size_t i = 0; i < pstate->iterations(); ++i)
+		{
+			cppco_bench::do_not_optimize(co::active());
+		}
+		pstate->stop();
+		yield_forever();
+	}, cppco_bench::small_stack_size);
+	cothread.switch_to();
+}
+
+#ifdef CPPCO_LIBCO_INTEROP
+// Raw `co_switch` calls leave the cached active `co::thread` stale, so both `co::active()` calls of a round trip look
+// up the registry, with 64 other `co::thread`s in it.
+CPPCO_BENCHMARK(active_after_raw_switch)
+{
+	auto cothreads = std::vector<co::thread>();
+	for (size_t i = 0; i < 64; ++i)
+	{
+		cothreads.emplace_back(&yield_forever, cppco_bench::small_stack_size);
+	}
+	raw_parent = co_active();
+	auto cothread = co_create(static_cast<unsigned int>(cppco_bench::small_stack_size), &raw_active_entry);
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		co_switch(cothread);
+		cppco_bench::do_not_optimize(co::active());
+	}
+	state.stop();
+	co_delete(cothread);
+	co::clear_external();
+}
+#endif // CPPCO_LIBCO_INTEROP
+
+// `co::thread` construction runs `setup()` and therefore `co_create`. The cothread is never entered.
+CPPCO_BENCHMARK(construct_and_destroy)
+{
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		auto cothread = co::thread(&yield_forever, cppco_bench::small_stack_size);
+		cppco_bench::do_not_optimize(cothread);
+	}
+	state.stop();
+}
+
+// With a `co::thread_pool` the cothreads are reused, which leaves the bookkeeping of `co::thread` itself.
+CPPCO_BENCHMARK(construct_and_destroy_pooled)
+{
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		auto cothread = co::thread(&yield_forever, cppco_bench::small_stack_size, bench_pool());
+		cppco_bench::do_not_optimize(cothread);
+	}
+	state.stop();
+}
+
+// Replacing the entry of a `co::thread` that has not started yet reuses its cothread.
+CPPCO_BENCHMARK(reset_entry_not_started)
+{
+	auto cothread = co::thread(&yield_forever, cppco_bench::small_stack_size);
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		cothread.reset(&yield_forever);
+	}
+	state.stop();
+}
+
+// `reset()` of a suspended `co::thread` stops it and deletes its cothread.
+CPPCO_BENCHMARK(reset_suspended)
+{
+	auto cothread = co::thread(cppco_bench::small_stack_size);
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		cothread.reset(&yield_forever);
+		cothread.switch_to();
+		cothread.reset();
+	}
+	state.stop();
+}
+
+// `rewind()` of a suspended `co::thread` unwinds it with `co::thread_stopping`, then it is entered again.
+CPPCO_BENCHMARK(rewind_suspended)
+{
+	auto cothread = co::thread(&yield_forever, cppco_bench::small_stack_size);
+	cothread.switch_to();
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		cothread.rewind();
+		cothread.switch_to();
+	}
+	state.stop();
+}
+
+// Destroying suspended `co::thread`s: a switch into each, a `co::thread_stopping` unwind and `co_delete`.
+CPPCO_BENCHMARK_LIMIT(destroy_suspended, 10000)
+{
+	auto cothreads = std::vector<co::thread>();
+	cothreads.reserve(state.iterations());
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		cothreads.emplace_back(&yield_forever, cppco_bench::small_stack_size);
+		cothreads.back().switch_to();
+	}
+	state.start();
+	cothreads.clear();
+	state.stop();
+}
+
+// An exception escaping the entry is caught by `entry_wrapper` and rethrown from the parent's `switch_to()`.
+CPPCO_BENCHMARK(failure_propagation)
+{
+	auto cothread = co::thread([]()
+	{
+		throw dummy_failure();
+	}, cppco_bench::small_stack_size);
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		try
+		{
+			cothread.switch_to();
+		}
+		catch (const dummy_failure&)
+		{
+		}
+	}
+	state.stop();
+}
@@ -0,0 +1,114 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+// Creation and iteration of many cothreads, created one by one and as a `co::thread_group`.
+//
+// The creation benchmarks create and destroy a batch of `batch_size` cothreads per iteration. The sweep benchmarks
+// switch into each of `sweep_size` suspended cothreads in order per iteration, so ns/op covers the whole sweep.
+
+#include "bench.hpp"
+#include <co/thread_group.hpp>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t batch_size = 256;
+constexpr size_t sweep_size = 4096;
+
+void yield_forever()
+{
+	while (true)
+	{
+		co::active().get_parent().switch_to();
+	}
+}
+
+void yield_forever_indexed(size_t)
+{
+	yield_forever();
+}
+
+std::string per_cothread(const cppco_bench::state& state, size_t cothreads)
+{
+	auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(state.elapsed()).count();
+	return std::to_string(static_cast<size_t>(ns) / (state.iterations() * cothreads)) + " ns per cothread";
+}
+
+} // namespace
+
+CPPCO_BENCHMARK(individual_create_batch)
+{
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		auto cothreads = std::vector<co::thread>();
+		cothreads.reserve(batch_size);
+		for (size_t j = 0; j < batch_size; ++j)
+		{
+			cothreads.emplace_back(&yield_forever, cppco_bench::small_stack_size);
+		}
+		cppco_bench::do_not_optimize(cothreads);
+	}
+	state.stop();
+	state.set_label(per_cothread(state, batch_size));
+}
+
+CPPCO_BENCHMARK(group_create_batch)
+{
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		co::thread_group group(batch_size, &yield_forever_indexed, cppco_bench::small_stack_size);
+		cppco_bench::do_not_optimize(group);
+	}
+	state.stop();
+	state.set_label(per_cothread(state, batch_size));
+}
+
+CPPCO_BENCHMARK(individual_sweep)
+{
+	auto cothreads = std::vector<co::thread>();
+	cothreads.reserve(sweep_size);
+	for (size_t j = 0; j < sweep_size; ++j)
+	{
+		cothreads.emplace_back(&yield_forever, cppco_bench::small_stack_size);
+	}
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		for (auto&& cothread : cothreads)
+		{
+			cothread.switch_to();
+		}
+	}
+	state.stop();
+	state.set_label(per_cothread(state, sweep_size));
+}
+
+CPPCO_BENCHMARK(group_sweep)
+{
+	co::thread_group group(sweep_size, &yield_forever_indexed, cppco_bench::small_stack_size);
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		for (auto&& cothread : group)
+		{
+			cothread.switch_to();
+		}
+	}
+	state.stop();
+	state.set_label(per_cothread(state, sweep_size));
+}
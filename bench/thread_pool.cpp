@@ -0,0 +1,78 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+// Benchmarks of `co::thread`s that take their cothreads from a `co::thread_pool`.
+
+#include "bench.hpp"
+#include <co.hpp>
+#include <string>
+
+namespace {
+
+void yield_forever()
+{
+	while (true)
+	{
+		co::active().get_parent().switch_to();
+	}
+}
+
+std::string hit_rate(const co::thread_pool& pool, size_t stack_size)
+{
+	auto stats = pool.get_statistics(stack_size);
+	auto total = stats.hits + stats.misses;
+	return "hit rate " + std::to_string(total == 0 ? 0 : 100 * stats.hits / total) + "%";
+}
+
+} // namespace
+
+// Compare with `construct_and_destroy`.
+CPPCO_BENCHMARK(pooled_construct_and_destroy)
+{
+	co::thread_pool pool;
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		auto cothread = co::thread(&yield_forever, cppco_bench::small_stack_size, pool);
+		cppco_bench::do_not_optimize(cothread);
+	}
+	state.stop();
+	state.set_label(hit_rate(pool, cppco_bench::small_stack_size));
+}
+
+// A short-lived task: a pooled `co::thread` is created, entered once and destroyed while suspended.
+CPPCO_BENCHMARK(pooled_short_lived_task)
+{
+	co::thread_pool pool;
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		auto cothread = co::thread(&yield_forever, cppco_bench::small_stack_size, pool);
+		cothread.switch_to();
+	}
+	state.stop();
+	state.set_label(hit_rate(pool, cppco_bench::small_stack_size));
+}
+
+// The same short-lived task without a pool.
+CPPCO_BENCHMARK(short_lived_task)
+{
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		auto cothread = co::thread(&yield_forever, cppco_bench::small_stack_size);
+		cothread.switch_to();
+	}
+	state.stop();
+}
@@ -0,0 +1,117 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+// Benchmarks of `co::timer_wheel`.
+
+#include "bench.hpp"
+#include <co/timer.hpp>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+namespace {
+
+using clock = co::timer_wheel::clock;
+
+constexpr size_t pending_count = 1000000;
+
+// Deterministic spread of deadlines over the next hour.
+clock::duration spread(size_t i) noexcept
+{
+	auto hash = static_cast<std::uint64_t>(i) * 0x9E3779B97F4A7C15u;
+	return std::chrono::milliseconds((hash >> 32) % (60 * 60 * 1000));
+}
+
+struct pending_timers
+{
+	std::unique_ptr<co::timer_wheel::timer[]> timers{ new co::timer_wheel::timer[pending_count] };
+
+	explicit pending_timers(co::timer_wheel& wheel)
+	{
+		auto now = clock::now();
+		for (size_t i = 0; i < pending_count; ++i)
+		{
+			wheel.arm(timers[i], now + spread(i), co::scheduler::handle());
+		}
+	}
+};
+
+} // namespace
+
+// Each iteration arms a timer, with a million timers already pending.
+CPPCO_BENCHMARK_LIMIT(timer_arm_1m_pending, 4000000)
+{
+	co::timer_wheel wheel;
+	pending_timers pending(wheel);
+	auto timers = std::unique_ptr<co::timer_wheel::timer[]>(new co::timer_wheel::timer[state.iterations()]);
+	auto now = clock::now();
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		wheel.arm(timers[i], now + spread(i + pending_count), co::scheduler::handle());
+	}
+	state.stop();
+}
+
+// Each iteration cancels one of the timers, with a million other timers pending.
+CPPCO_BENCHMARK_LIMIT(timer_cancel_1m_pending, 4000000)
+{
+	co::timer_wheel wheel;
+	pending_timers pending(wheel);
+	auto timers = std::unique_ptr<co::timer_wheel::timer[]>(new co::timer_wheel::timer[state.iterations()]);
+	auto now = clock::now();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		wheel.arm(timers[i], now + spread(i + pending_count), co::scheduler::handle());
+	}
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		wheel.cancel(timers[i]);
+	}
+	state.stop();
+}
+
+// The typical timeout: armed before an operation and cancelled after it completes.
+CPPCO_BENCHMARK(timer_arm_and_cancel_1m_pending)
+{
+	co::timer_wheel wheel;
+	pending_timers pending(wheel);
+	co::timer_wheel::timer t;
+	auto deadline = clock::now() + std::chrono::seconds(5);
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		wheel.arm(t, deadline, co::scheduler::handle());
+		wheel.cancel(t);
+	}
+	state.stop();
+}
+
+// Each iteration advances the wheel by one tick, expiring about 280 timers per second of a million spread over an hour.
+CPPCO_BENCHMARK_LIMIT(timer_advance_1m_pending, 3600000)
+{
+	co::timer_wheel wheel;
+	pending_timers pending(wheel);
+	auto now = clock::now();
+	auto expired = size_t{ 0 };
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		expired += wheel.advance(now + std::chrono::milliseconds(i));
+	}
+	state.stop();
+	cppco_bench::do_not_optimize(expired);
+}
@@ -0,0 +1,130 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+// Round trips that pass a value to a cothread and get a value back. Each iteration is one round trip, that is two
+// switches. The `shared_*` benchmarks pass the values through variables captured by reference, the `transfer_*` ones
+// through `co::thread::switch_to(value)` and `co::receive<T>()`.
+
+#include "bench.hpp"
+#include <co.hpp>
+#include <string>
+#include <utility>
+
+namespace {
+
+// A payload that is moved cheaply but is expensive to copy, which is what the values handed between cothreads
+// usually are.
+std::string make_payload()
+{
+	return std::string(256, 'x');
+}
+
+} // namespace
+
+CPPCO_BENCHMARK(shared_int_round_trip)
+{
+	auto& parent = co::active();
+	auto request = size_t{ 0 };
+	auto reply = size_t{ 0 };
+	co::thread worker([&parent, &request, &reply]()
+	{
+		while (true)
+		{
+			reply = request + 1;
+			parent.switch_to();
+		}
+	}, cppco_bench::small_stack_size);
+	auto sum = size_t{ 0 };
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		request = i;
+		worker.switch_to();
+		sum += reply;
+	}
+	state.stop();
+	cppco_bench::do_not_optimize(sum);
+}
+
+CPPCO_BENCHMARK(transfer_int_round_trip)
+{
+	auto& parent = co::active();
+	co::thread worker([&parent]()
+	{
+		auto request = co::receive<size_t>();
+		while (true)
+		{
+			request = parent.switch_to<size_t>(request + 1);
+		}
+	}, cppco_bench::small_stack_size);
+	auto sum = size_t{ 0 };
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		sum += worker.switch_to<size_t>(size_t{ i });
+	}
+	state.stop();
+	cppco_bench::do_not_optimize(sum);
+}
+
+// The shared variables are copied into, as a cothread that is handed a reference cannot know when it may steal it.
+CPPCO_BENCHMARK(shared_string_round_trip)
+{
+	auto& parent = co::active();
+	auto request = std::string();
+	auto reply = std::string();
+	co::thread worker([&parent, &request, &reply]()
+	{
+		while (true)
+		{
+			reply = request;
+			parent.switch_to();
+		}
+	}, cppco_bench::small_stack_size);
+	auto payload = make_payload();
+	auto length = size_t{ 0 };
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		request = payload;
+		worker.switch_to();
+		length += reply.size();
+	}
+	state.stop();
+	cppco_bench::do_not_optimize(length);
+}
+
+CPPCO_BENCHMARK(transfer_string_round_trip)
+{
+	auto& parent = co::active();
+	co::thread worker([&parent]()
+	{
+		auto request = co::receive<std::string>();
+		while (true)
+		{
+			request = parent.switch_to<std::string>(std::move(request));
+		}
+	}, cppco_bench::small_stack_size);
+	auto payload = make_payload();
+	auto length = size_t{ 0 };
+	state.start();
+	for (size_t i = 0; i < state.iterations(); ++i)
+	{
+		payload = worker.switch_to<std::string>(std::move(payload));
+		length += payload.size();
+	}
+	state.stop();
+	cppco_bench::do_not_optimize(length);
+}
@@ -28,6 +28,38 @@
 /// - `CPPCO_LIBCO_INTEROP`: Adds additional code to `cppco` that facilitates interoperation with raw `libco` calls.
 ///   Ideally all calls to `libco` would be performed through `cppco`. However, if that is not possible, then `cppco`
 ///   needs to be aware of external cothreads and to keep track of the ones encountered via calls to `co::active()`.
+///   The cothreads are tracked per OS thread, so a `co::thread` has to be set up, moved and destroyed on the OS thread
+///   that runs it.
+///
+/// - `CPPCO_THREAD_MIGRATION`: Allows a suspended `co::thread` to be resumed on another OS thread than the one it was
+///   suspended on, as `co::executor` does. `cppco` then looks up its `thread_local` status again after every switch.
+///   A cothread that migrates must not be suspended inside a catch block, and it must not keep references to
+///   `thread_local` variables across switches. Compilers may reuse the addresses of `thread_local` variables within a
+///   function in position independent code, so the `initial-exec` or `local-exec` TLS model has to be used.
+///   It cannot be combined with `CPPCO_LIBCO_INTEROP`.
+///
+/// - `CPPCO_STACK_WATERMARK`: Paints the stacks of the cothreads with a pattern when they are created, so that
+///   `co::thread::stack_high_water()` and `co::stack_usage_report()` can tell how deep the stacks were actually used.
+///   `co_create` is replaced by `co_derive` on `malloc`ed memory. Painting commits the whole stack, so this is meant
+///   for measurement runs that find the right stack sizes, not for production builds.
+///
+/// - `CPPCO_TRACE`: Records a timestamped event whenever a cothread is created, switched to, stopped, reset or fails,
+///   see `co/trace.hpp`. The events can be flushed as Chrome trace event JSON with `co::trace::flush()`. Without it
+///   the hooks expand to nothing.
+///
+/// - `CPPCO_NO_EXCEPTIONS`: Makes `cppco` usable in builds without exceptions. It is defined automatically when the
+///   compiler has exceptions turned off. Errors are reported as `std::error_code`s of `co::errc` by
+///   `co::thread::try_create()` and `co::thread::try_switch_to()`, while the functions that would throw abort the
+///   process instead. `co::stop_mode::cooperative` is the default stop mode, so the entry functors have to check
+///   `co::stop_requested()` after every switch. `co::stop_mode::unwind` needs exceptions, so stopping a suspended
+///   `co::thread` in that mode aborts instead of skipping the destructors on its stack.
+///
+/// - `CPPCO_STATS`: Accounts the run time, the number of times it was switched to and the longest run slice of every
+///   `co::thread`, see `co::thread::stats()` and `co::stats_snapshot()`. The switches are counted exactly, while
+///   reading the clock would cost as much as the switch itself, so only a random sample of the run slices is timed:
+///   one in `CPPCO_STATS_SAMPLE_PERIOD` on average, which defaults to 64. The clock is the time stamp counter on x86
+///   and `std::chrono::steady_clock` elsewhere. With a period of 1 every slice is timed. Without it the accounting is
+///   compiled out.
 ///   
 
 #ifndef CO_HPP_INCLUDE_GUARD
@@ -35,22 +67,92 @@
 
 #include <libco.h>
 #include <stdexcept>
+#include <exception>
 #include <memory>
+#include <new>
 #include <functional>
-#ifdef CPPCO_LIBCO_INTEROP
 #include <map>
-#include <set>
+#include <vector>
+#include <cstddef>
+#include <type_traits>
+#include <system_error>
+#include <cstdint>
+#if defined(CPPCO_STACK_WATERMARK) || defined(CPPCO_STATS)
 #include <mutex>
-#endif // CPPCO_LIBCO_INTEROP
+#endif // CPPCO_STACK_WATERMARK || CPPCO_STATS
+#ifdef CPPCO_STATS
+#include <atomic>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define CPPCO_STATS_TSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else // _MSC_VER
+#include <x86intrin.h>
+#endif // _MSC_VER
+#endif // x86
+#ifndef CPPCO_STATS_SAMPLE_PERIOD
+#define CPPCO_STATS_SAMPLE_PERIOD 64
+#endif // CPPCO_STATS_SAMPLE_PERIOD
+#endif // CPPCO_STATS
+
+#if defined(CPPCO_THREAD_MIGRATION) && defined(CPPCO_LIBCO_INTEROP)
+#error "CPPCO_THREAD_MIGRATION cannot be combined with CPPCO_LIBCO_INTEROP"
+#endif // CPPCO_THREAD_MIGRATION && CPPCO_LIBCO_INTEROP
+
+#ifdef __GNUC__
+#define CPPCO_UNLIKELY(condition) __builtin_expect(!!(condition), 0)
+#define CPPCO_COLD __attribute__((noinline, cold))
+#elif defined(_MSC_VER) // __GNUC__
+#define CPPCO_UNLIKELY(condition) (condition)
+#define CPPCO_COLD __declspec(noinline)
+#else // _MSC_VER
+#define CPPCO_UNLIKELY(condition) (condition)
+#define CPPCO_COLD
+#endif // __GNUC__
+
+#if !defined(CPPCO_NO_EXCEPTIONS) && ((defined(__GNUC__) && !defined(__EXCEPTIONS)) || (defined(_MSC_VER) && !defined(_CPPUNWIND)))
+#define CPPCO_NO_EXCEPTIONS
+#endif // !CPPCO_NO_EXCEPTIONS && exceptions are turned off
+
+#ifdef CPPCO_NO_EXCEPTIONS
+#include <cstdio>
+#include <cstdlib>
+// The handler becomes the body of a loop that never runs, so an `else` after it cannot bind to the `if` of the macros.
+#define CPPCO_TRY if (true)
+#define CPPCO_CATCH(declaration) else for (; false; )
+#define CPPCO_THROW(exception) ::co::detail::abort_with(exception)
+#define CPPCO_RETHROW std::abort()
+#else // CPPCO_NO_EXCEPTIONS
+#define CPPCO_TRY try
+#define CPPCO_CATCH(declaration) catch (declaration)
+#define CPPCO_THROW(exception) throw exception
+#define CPPCO_RETHROW throw
+#endif // CPPCO_NO_EXCEPTIONS
+
+#ifdef CPPCO_TRACE
+#include "co/trace.hpp"
+#define CPPCO_TRACE_EVENT(kind, cothread, target) ::co::trace::record(::co::trace::event_kind::kind, cothread, target)
+#else // CPPCO_TRACE
+#define CPPCO_TRACE_EVENT(kind, cothread, target) static_cast<void>(0)
+#endif // CPPCO_TRACE
 
 namespace co {
 
 class thread;
 
+class stack_allocator;
+class thread_pool;
+
 class thread_failure;
 class thread_create_failure;
 class thread_return_failure;
 
+template <typename T>
+class local;
+template <typename Policy>
+class basic_thread;
+
 /// `co::active()` returns the currently active `co::thread`.
 ///
 /// It can also be used from the main cothread, which will return an instance
@@ -60,6 +162,25 @@ const thread& active() noexcept;
 /// `co::main()` returns the main cothread.
 const thread& main() noexcept;
 
+/// `co::stop_requested()` checks whether the active `co::thread` is being stopped.
+///
+/// Entry functors of `co::thread`s in `co::stop_mode::cooperative` use this to find out that they have to return.
+bool stop_requested() noexcept;
+
+/// `co::receive<T>()` takes the value that was passed to the active `co::thread` by `co::thread::switch_to(value)`.
+///
+/// The value is moved out of the object of the `co::thread` that passed it, which stays suspended until it is switched
+/// to again. So the value has to be received before the active `co::thread` switches away. An entry functor receives
+/// the value it was first switched to with this way.
+///
+/// `T` has to be the decayed type of the value that was passed, and a value has to be passed by the switch that
+/// resumed the active `co::thread`, otherwise the behavior is undefined. Debug builds assert both. `co::receive<void>()`
+/// ignores the value.
+///
+/// \return The value.
+template <typename T>
+T receive();
+
 #ifdef CPPCO_LIBCO_INTEROP
 /// `co::init()` manually initializes the internals of the `cppco` library.
 ///
@@ -70,7 +191,10 @@ const thread& main() noexcept;
 /// This function can be used to ensure the correct initialization of `cppco` by invoking it on the main cothread.
 void init() noexcept;
 
-/// `co::clear_external()` clears the tracked external cothreads from `cppco`'s cache.
+/// `co::clear_external()` clears the tracked external cothreads of the calling OS thread from `cppco`'s cache.
+///
+/// An external cothread is dropped from the cache automatically once its address is reused by a cothread that `cppco`
+/// creates, so this is only needed to release the memory of the remaining ones.
 ///
 /// Use with care. This could cause `co::thread`s' parent reference to become dangling. Make sure no `co::thread` is
 /// referring to such parents when calling `switch_to` otherwise the behavior becomes undefined.
@@ -93,6 +217,124 @@ void clear_external() noexcept;
 void set_active_as_main() noexcept;
 #endif // CPPCO_LIBCO_INTEROP
 
+#ifdef CPPCO_STACK_WATERMARK
+/// `co::stack_usage` is the measured stack usage of the cothreads of a stack size.
+struct stack_usage
+{
+	/// The stack size of the cothreads.
+	size_t stack_size = 0;
+	/// The number of samples. A sample is taken each time a cothread is released by its `co::thread`.
+	size_t samples = 0;
+	/// The deepest high-water mark among the samples in bytes.
+	size_t max_high_water = 0;
+	/// The sum of the high-water marks of the samples in bytes.
+	size_t total_high_water = 0;
+};
+
+/// `co::paint_stack()` fills the memory of a stack with the pattern that `co::stack_high_water()` looks for.
+///
+/// `co::stack_allocator`s that derive their cothreads with `co_derive` call it before `co_derive`.
+///
+/// \param memory  The memory that the cothread will be derived from.
+/// \param size    The size of the memory in bytes.
+void paint_stack(void* memory, size_t size) noexcept;
+
+/// `co::stack_high_water()` measures the deepest point a painted stack was used to.
+///
+/// The cothread has to be derived with `co_derive` from memory that starts at its own address and that was painted by
+/// `co::paint_stack()`. Cothreads that are reused keep their high-water mark from the earlier entry functors.
+///
+/// \param cothread    The cothread.
+/// \param stack_size  The size of the memory the cothread was derived from.
+/// 
+/// \return The used stack in bytes, or `stack_size` if no painted memory is left.
+size_t stack_high_water(cothread_t cothread, size_t stack_size) noexcept;
+
+/// `co::stack_usage_report()` gets the stack usage sampled so far across all OS threads.
+///
+/// 
+/// \return One entry per stack size, ordered by the stack size.
+std::vector<stack_usage> stack_usage_report();
+
+/// `co::reset_stack_usage_report()` drops the samples collected so far.
+void reset_stack_usage_report() noexcept;
+#endif // CPPCO_STACK_WATERMARK
+
+#ifdef CPPCO_STATS
+/// `co::thread_stats` is the accounting of a `co::thread`.
+///
+/// Only the run slices that have ended are counted, so the slice of the active `co::thread` is not included yet.
+struct thread_stats
+{
+	/// The time the `co::thread` ran for, estimated from the sampled run slices, see `CPPCO_STATS_SAMPLE_PERIOD`.
+	std::chrono::nanoseconds run_time{};
+	/// The number of times the `co::thread` was switched to.
+	std::uint64_t switches = 0;
+	/// The longest sampled time the `co::thread` ran for without switching away.
+	std::chrono::nanoseconds longest_slice{};
+};
+
+/// `co::thread_stats_entry` is the accounting of one `co::thread` in `co::stats_snapshot()`.
+struct thread_stats_entry
+{
+	/// Identifies the `co::thread`. It must not be dereferenced, as the `co::thread` may be gone or belong to another OS
+	/// thread by the time the snapshot is read.
+	const thread* owner = nullptr;
+	thread_stats stats;
+};
+
+/// `co::stats_snapshot()` gets the accounting of every `co::thread` that exists, across all OS threads.
+///
+/// The counters of each `co::thread` are read one by one while other OS threads keep running, so the entries are not
+/// taken at exactly the same time.
+///
+/// \return One entry per `co::thread`, including the main cothread of every OS thread that used `cppco`.
+std::vector<thread_stats_entry> stats_snapshot();
+
+namespace detail {
+
+/// `co::detail::thread_accounting` holds the counters of a `co::thread`.
+///
+/// The counters are only written by the OS thread that runs the `co::thread`. They are relaxed atomics so that
+/// `co::stats_snapshot()` can read them from any OS thread, which costs plain loads and stores. Every
+/// `co::detail::thread_accounting` is linked into a process wide list while it exists.
+class thread_accounting
+{
+public:
+	explicit thread_accounting(const thread* owner) noexcept;
+	~thread_accounting();
+
+	thread_accounting(const thread_accounting& other) = delete;
+	thread_accounting& operator=(const thread_accounting& other) = delete;
+
+	/// Counts a sampled run slice of `ticks` length for all the slices it stands for.
+	void add_slice(std::uint64_t ticks) noexcept;
+	/// Counts a switch to the `co::thread`.
+	void add_switch() noexcept;
+	/// Takes over the counters of `other`, which are reset.
+	void take(thread_accounting& other) noexcept;
+
+	thread_stats get() const noexcept;
+
+private:
+	friend std::vector<thread_stats_entry> co::stats_snapshot();
+
+	const thread* m_owner;
+	thread_accounting* m_previous;
+	thread_accounting* m_next;
+	std::atomic<std::uint64_t> m_run_ticks;
+	std::atomic<std::uint64_t> m_switches;
+	std::atomic<std::uint64_t> m_longest_ticks;
+};
+
+/// Reads the clock of the accounting, the time stamp counter on x86.
+std::uint64_t stats_ticks() noexcept;
+/// Converts a number of ticks of `stats_ticks()` to nanoseconds.
+std::chrono::nanoseconds stats_duration(std::uint64_t ticks) noexcept;
+
+} // namespace detail
+#endif // CPPCO_STATS
+
 /// `co::thread_failure` is the base exception of the `cppco` library.
 class thread_failure : public std::runtime_error
 {
@@ -114,6 +356,31 @@ public:
 	thread_return_failure() noexcept;
 };
 
+/// `co::errc` are the errors of `cppco` reported as `std::error_code`s.
+enum class errc
+{
+	/// A cothread could not be created, see `co::thread_create_failure`.
+	create_failure = 1,
+	/// An entry functor returned, see `co::thread_return_failure`.
+	return_failure,
+};
+
+/// `co::error_category()` is the `std::error_category` of `co::errc`.
+const std::error_category& error_category() noexcept;
+
+/// Makes a `std::error_code` of `co::error_category()`.
+std::error_code make_error_code(errc error) noexcept;
+
+#ifdef CPPCO_NO_EXCEPTIONS
+namespace detail {
+
+/// Reports a failure that would be thrown if exceptions were available and aborts.
+template <typename E>
+[[noreturn]] void abort_with(const E& failure) noexcept;
+
+} // namespace detail
+#endif // CPPCO_NO_EXCEPTIONS
+
 /// `co::thread_stopping` is used to signal that the entry functor needs to exit as soon as possible.
 ///
 /// Catching this exception is only permitted if it is rethrown in the same catch block.
@@ -121,6 +388,155 @@ class thread_stopping
 {
 };
 
+/// `co::stop_mode` selects how a suspended `co::thread` is stopped by `reset()`, `rewind()`, `set_stack_size()` and
+/// the destructor.
+enum class stop_mode
+{
+	/// The stack of the entry functor is unwound by throwing `co::thread_stopping` from the `switch_to()` it is
+	/// suspended in. This is the default. With `CPPCO_NO_EXCEPTIONS` stopping a suspended `co::thread` in this mode
+	/// aborts, so it has to be selected explicitly.
+	unwind,
+	/// The `switch_to()` the entry functor is suspended in returns normally and `co::stop_requested()` becomes `true`.
+	/// The entry functor has to return without switching to any other cothread, so no exception is thrown. This is the
+	/// default with `CPPCO_NO_EXCEPTIONS`.
+	cooperative,
+	/// The cothread is deleted without switching to it. No destructor of the objects on the stack of the entry functor
+	/// runs, so this is only permitted for entry functors that own no such objects and that are not suspended inside a
+	/// catch block.
+	abandon,
+};
+
+/// The `co::stop_mode` of new `co::thread`s.
+#ifndef CPPCO_NO_EXCEPTIONS
+constexpr stop_mode default_stop_mode = stop_mode::unwind;
+#else // CPPCO_NO_EXCEPTIONS
+constexpr stop_mode default_stop_mode = stop_mode::cooperative;
+#endif // CPPCO_NO_EXCEPTIONS
+
+/// `co::deferred_t` selects the constructors of `co::thread` that create the cothread on the first switch to it.
+struct deferred_t
+{
+	explicit deferred_t() = default;
+};
+
+/// Passed to the constructors of `co::thread` to defer the creation of its cothread, see `co::thread::set_deferred()`.
+constexpr deferred_t deferred{};
+
+/// `co::stack_allocator` is the interface of the sources of cothreads for `co::thread`.
+///
+/// A `co::thread` without an allocator calls `co_create` and `co_delete` directly.
+class stack_allocator
+{
+public:
+	virtual ~stack_allocator() = default;
+
+	/// Creates a cothread.
+	///
+	/// \param stack_size  The stack size of the cothread.
+	/// \param entry       The function the cothread begins execution with.
+	/// \return The new cothread, or `nullptr` on failure.
+	virtual cothread_t allocate(size_t stack_size, void (*entry)()) noexcept = 0;
+
+	/// Takes back a cothread that was created by `allocate`.
+	///
+	/// \param cothread    The cothread. It has either not been entered yet, or it is suspended between two entry
+	///                    functors, so it may be reused.
+	/// \param stack_size  The stack size the cothread was allocated with.
+	virtual void deallocate(cothread_t cothread, size_t stack_size) noexcept = 0;
+
+	/// Takes back a cothread that was created by `allocate` and that must never run again.
+	///
+	/// \param cothread    The cothread. It is suspended inside an entry functor that was abandoned.
+	/// \param stack_size  The stack size the cothread was allocated with.
+	virtual void discard(cothread_t cothread, size_t stack_size) noexcept = 0;
+};
+
+/// `co::thread_pool` is a `co::stack_allocator` that keeps released cothreads for reuse.
+///
+/// Cothreads are cached in size classes keyed by their exact stack size. A cached cothread is handed out again by
+/// `allocate` without calling `co_create`, and its stack is already warm. This relies on all cothreads of a pool being
+/// created with the same entry function, which holds for the pools used by `co::thread`, as its entry function keeps
+/// accepting new entry functors.
+///
+/// The memory retained by the cache is capped. Cothreads released while the cap is reached are deleted.
+///
+/// A `co::thread_pool` is not thread safe and it has to outlive the `co::thread`s that use it.
+class thread_pool final : public stack_allocator
+{
+public:
+	/// The default cap on the stack memory retained by a `co::thread_pool`.
+	static constexpr size_t default_max_retained = 64 * 1024 * 1024;
+
+	/// `co::thread_pool::statistics` are the counters of a size class.
+	struct statistics
+	{
+		/// The number of allocations served from the cache.
+		size_t hits = 0;
+		/// The number of allocations that had to create a new cothread.
+		size_t misses = 0;
+		/// The number of cothreads currently in the cache.
+		size_t retained = 0;
+	};
+
+	/// Constructs an empty `co::thread_pool`.
+	///
+	/// \param max_retained  The cap on the retained stack memory in bytes.
+	/// \param upstream      The allocator that creates and deletes cothreads on a cache miss or when the cap is
+	///                      reached. If `nullptr`, `co_create` and `co_delete` are used.
+	explicit thread_pool(size_t max_retained = default_max_retained, stack_allocator* upstream = nullptr) noexcept;
+	/// Destructor. Deletes the retained cothreads.
+	~thread_pool() override;
+
+	thread_pool(const thread_pool& other) = delete;
+	thread_pool& operator=(const thread_pool& other) = delete;
+
+	cothread_t allocate(size_t stack_size, void (*entry)()) noexcept override;
+	void deallocate(cothread_t cothread, size_t stack_size) noexcept override;
+	void discard(cothread_t cothread, size_t stack_size) noexcept override;
+
+	/// Gets the cap on the retained stack memory.
+	///
+	/// \return The cap in bytes.
+	size_t get_max_retained() const noexcept;
+	/// Sets the cap on the retained stack memory.
+	///
+	/// Cached cothreads are deleted until the retained memory fits the new cap.
+	///
+	/// \param max_retained  The new cap in bytes.
+	void set_max_retained(size_t max_retained) noexcept;
+
+	/// Gets the stack memory currently retained by the cache.
+	///
+	/// \return The retained memory in bytes.
+	size_t get_retained() const noexcept;
+
+	/// Gets the counters of a size class.
+	///
+	/// \param stack_size  The stack size that identifies the size class.
+	/// \return The counters of the size class. All zero if the size class has not been used.
+	statistics get_statistics(size_t stack_size) const noexcept;
+
+	/// Deletes all cached cothreads. The counters are kept.
+	void clear() noexcept;
+
+private:
+	struct size_class
+	{
+		std::vector<cothread_t> cothreads;
+		size_t outstanding = 0;
+		statistics stats;
+	};
+
+	cothread_t create(size_t stack_size, void (*entry)()) noexcept;
+	void destroy(cothread_t cothread, size_t stack_size) noexcept;
+	void trim(size_t max_retained) noexcept;
+
+	std::map<size_t, size_class> m_size_classes;
+	stack_allocator* m_upstream;
+	size_t m_max_retained;
+	size_t m_retained = 0;
+};
+
 /// `co::thread` is a class that represents and handles so-called "cothreads".
 class thread
 {
@@ -132,10 +548,38 @@ public:
 #endif // CPPCO_LIBCO_INTEROP
 	friend const thread& active() noexcept;
 	friend const thread& main() noexcept;
+	friend bool stop_requested() noexcept;
+	friend class thread_pool;
+	template <typename T>
+	friend T receive();
+	template <typename T>
+	friend class local;
+	template <typename Policy>
+	friend class basic_thread;
 
 	/// `co::thread::entry_t` is the functor type for the entry functions for cothreads.
+	///
+	/// Any callable that can be invoked without arguments can be used as an entry functor, `entry_t` is the one to use
+	/// when the entry functor needs to be stored before it is given to a `co::thread`.
 	using entry_t = std::function<void()>;
 
+	/// `co::thread::is_entry<F>` checks whether a decayed `F` can be used as an entry functor.
+	template <typename F, typename = void>
+	struct is_entry : std::false_type {};
+	template <typename F>
+	struct is_entry<F, decltype(std::declval<F&>()(), void())> : std::integral_constant<bool, !std::is_same<F, thread>::value> {};
+
+	/// Entry functors up to this size that are nothrow move constructible are stored inside the `co::thread`, without a
+	/// heap allocation. Larger ones are allocated on the heap.
+	static constexpr size_t inline_entry_size = 4 * sizeof(void*);
+
+	/// `co::thread::is_inline_entry<F>` checks whether an entry functor of type `F` is stored inside the `co::thread`.
+	template <typename F>
+	using is_inline_entry = std::integral_constant<bool,
+		sizeof(F) <= inline_entry_size
+		&& alignof(F) <= alignof(std::max_align_t)
+		&& std::is_nothrow_move_constructible<F>::value>;
+
 	/// The recommended size for the stack is 1 MB on 32 bit systems, and to define the stack size in pointer size.
 	///
 	/// Source: <https://github.com/higan-emu/libco/blob/9b76ff4c5c7680555d27c869ae90aa399d3cd0f2/doc/usage.md#co_create>
@@ -151,19 +595,63 @@ public:
 	/// The previously active `co::thread` will resume from where it called this function.
 	void switch_to() const;
 
+	/// Switches to this `co::thread` and passes `value` to it.
+	///
+	/// The `co::thread` that is switched to takes the value with `co::receive<U>()`, which moves it out of `value`
+	/// without copying it. When the calling `co::thread` is resumed, it receives the value of type `T` passed by the
+	/// `co::thread` that resumed it.
+	///
+	/// \param value  The value to pass. It has to be an rvalue, so it is never copied.
+	/// \return The value passed back by the resuming `co::thread`, or nothing if `T` is `void`.
+	template <typename T = void, typename U>
+	T switch_to(U&& value) const;
+
+#ifndef CPPCO_NO_EXCEPTIONS
+	/// Switches to this `co::thread` and throws `exception` from the `switch_to()` it is suspended in.
+	///
+	/// This is how the failure of an entry functor reaches its parent, and it must not be used on a `co::thread` that
+	/// is suspended in `switch_to_fast()`.
+	///
+	/// \param exception  The exception to throw. It must not be `nullptr`.
+	void throw_to(std::exception_ptr exception) const;
+#endif // CPPCO_NO_EXCEPTIONS
+
+#ifdef CPPCO_NO_EXCEPTIONS
+	/// Switches to this `co::thread` and reports the failure of a child instead of throwing it.
+	///
+	/// `switch_to()` aborts when a failure reaches the calling `co::thread`, because it cannot throw it.
+	///
+	/// \return `co::errc::return_failure` if the entry functor of a child of the calling `co::thread` returned while
+	///         it was suspended, otherwise no error.
+	std::error_code try_switch_to() const noexcept;
+#endif // CPPCO_NO_EXCEPTIONS
+
+	/// Switches to this `co::thread` without handling stop and failure signals when execution returns.
+	///
+	/// The previously active `co::thread` will resume from where it called this function, just like with
+	/// `switch_to()`, but this saves the signal check on the way back. It may only be used if the calling `co::thread`
+	/// is not going to be stopped, rewound or destroyed while it is suspended in this call, and if no failure is
+	/// going to be propagated to it. Otherwise the behavior is undefined. A `co::thread` in
+	/// `co::stop_mode::cooperative` may be stopped there, if it checks `co::stop_requested()` when this returns.
+	/// If the cothread of a deferred `co::thread` cannot be created here, `std::terminate` is called.
+	void switch_to_fast() const noexcept;
+
 	/// Releases all resources held by this `co::thread`.
 	///
-	/// Also stops the running entry functor.
+	/// Also stops the running entry functor and destroys the `co::local` values of this `co::thread`.
 	void reset();
 
 	/// Sets a new entry functor.
 	///
-	/// Also stops the previous entry functor.
+	/// Also stops the previous entry functor and destroys the `co::local` values of this `co::thread`.
 	///
 	/// \param entry  The new entry functor for this `co::thread`.
-	void reset(entry_t entry);
+	template <typename F, typename = typename std::enable_if<is_entry<typename std::decay<F>::type>::value>::type>
+	void reset(F&& entry);
 
 	/// Rewinds the entry functor's execution to its initial state.
+	///
+	/// The `co::local` values of this `co::thread` are destroyed too.
 	void rewind();
 
 	/// Gets the stack size of this `co::thread`.
@@ -177,6 +665,67 @@ public:
 	/// \param stack_size  The new stack size.
 	void set_stack_size(size_t stack_size) noexcept;
 
+#ifdef CPPCO_STACK_WATERMARK
+	/// Measures how deep the stack of this `co::thread` has been used so far.
+	///
+	/// The high-water mark covers all entry functors that ran on the current cothread, including the ones that ran on it
+	/// before it was reused from a `co::thread_pool`. The stack has to be painted, which holds for the cothreads created
+	/// without an allocator and by `co::thread_pool` and `co::mmap_allocator`.
+	///
+	/// \return The used stack in bytes, or `0` if this `co::thread` has no cothread of its own.
+	size_t stack_high_water() const noexcept;
+#endif // CPPCO_STACK_WATERMARK
+
+#ifdef CPPCO_STATS
+	/// Gets the accounting of this `co::thread`.
+	///
+	/// A moved `co::thread` takes its accounting along, while rewinding or resetting it keeps counting.
+	///
+	/// \return The run time, the number of switches to it and the longest run slice so far.
+	thread_stats stats() const noexcept;
+#endif // CPPCO_STATS
+
+	/// Gets the `co::stop_mode` of this `co::thread`.
+	///
+	/// \return The current stop mode.
+	stop_mode get_stop_mode() const noexcept;
+	/// Sets the `co::stop_mode` of this `co::thread`.
+	///
+	/// \param mode  The new stop mode. It is used the next time this `co::thread` is stopped.
+	void set_stop_mode(stop_mode mode) noexcept;
+
+	/// Checks whether this `co::thread` is being stopped.
+	///
+	/// \return `true` while the entry functor of this `co::thread` is being stopped, `false` otherwise.
+	bool stop_requested() const noexcept;
+
+	/// Checks whether this `co::thread` defers the creation of its cothread.
+	///
+	/// \return `true` if the cothread is created on the first switch to this `co::thread`, `false` otherwise.
+	bool is_deferred() const noexcept;
+	/// Sets whether this `co::thread` defers the creation of its cothread.
+	///
+	/// A deferred `co::thread` creates its cothread, or takes it from its allocator, on the first switch to it instead
+	/// of when its entry functor is set. `reset(F&& entry)`, `rewind()` and `set_stack_size()` leave it without a
+	/// cothread until the next switch if it has none, so a deferred `co::thread` that never runs costs no stack. A
+	/// failure to create the cothread is thrown from the switch as `co::thread_create_failure`.
+	///
+	/// \param deferred  Whether the creation of the cothread is deferred. It is used the next time a cothread is needed.
+	void set_deferred(bool deferred) noexcept;
+
+	/// Gets the `co::stack_allocator` that creates the cothreads of this `co::thread`.
+	///
+	/// \return The allocator, or `nullptr` if `co_create` and `co_delete` are used directly.
+	stack_allocator* get_allocator() const noexcept;
+	/// Sets the `co::stack_allocator` that creates the cothreads of this `co::thread`.
+	///
+	/// A cothread that is already created is returned to the allocator it came from. The new allocator is used the next
+	/// time a cothread is needed.
+	///
+	/// \param allocator  The new allocator, or `nullptr` to call `co_create` and `co_delete` directly. It has to
+	///                   outlive this `co::thread`.
+	void set_allocator(stack_allocator* allocator) noexcept;
+
 	/// Gets the parent `co::thread` of this `co::thread`.
 	///
 	/// It is undefined behavior to get the parent of the main cothread.
@@ -190,14 +739,14 @@ public:
 
 	/// Constructs an empty `co::thread`.
 	///
-	/// It will need an entry functor assigned to it via `reset(entry_t entry)`.
+	/// It will need an entry functor assigned to it via `reset(F&& entry)`.
 	/// The parent is set to be the calling `co::thread`.
 	///
 	/// \param stack_size The stack size. Defaults to `co::thread::default_stack_size`.
 	explicit thread(size_t stack_size = default_stack_size);
 	/// Constructs an empty `co::thread`.
 	///
-	/// It will need an entry functor assigned to it via `reset(entry_t entry)`.
+	/// It will need an entry functor assigned to it via `reset(F&& entry)`.
 	///
 	/// \param parent      The explicitly specified parent for this `co::thread`.
 	/// \param stack_size  The stack size. Defaults to `co::thread::default_stack_size`.
@@ -209,13 +758,64 @@ public:
 	///
 	/// \param entry   The entry functor that will begin execution when the `co::thread` starts running.
 	/// \param parent  The explicitly specified parent for this `co::thread`. Defaults to the calling `co::thread`.
-	explicit thread(entry_t entry, const thread& parent = active());
+	template <typename F, typename = typename std::enable_if<is_entry<typename std::decay<F>::type>::value>::type>
+	explicit thread(F&& entry, const thread& parent = active());
 	/// Constructs a `co::thread` with `entry` as its entry functor.
 	///
 	/// \param entry       The entry functor that will begin execution when the `co::thread` starts running.
 	/// \param stack_size  The stack size.
 	/// \param parent      The explicitly specified parent for this `co::thread`. Defaults to the calling `co::thread`.
-	explicit thread(entry_t entry, size_t stack_size, const thread& parent = active());
+	template <typename F, typename = typename std::enable_if<is_entry<typename std::decay<F>::type>::value>::type>
+	explicit thread(F&& entry, size_t stack_size, const thread& parent = active());
+	/// Constructs a `co::thread` with `entry` as its entry functor and with its cothread taken from `allocator`.
+	///
+	/// \param entry       The entry functor that will begin execution when the `co::thread` starts running.
+	/// \param stack_size  The stack size.
+	/// \param allocator   The allocator of the cothread, e.g. a `co::thread_pool`. It has to outlive this `co::thread`.
+	/// \param parent      The explicitly specified parent for this `co::thread`. Defaults to the calling `co::thread`.
+	template <typename F, typename = typename std::enable_if<is_entry<typename std::decay<F>::type>::value>::type>
+	explicit thread(F&& entry, size_t stack_size, stack_allocator& allocator, const thread& parent = active());
+	/// Constructs a deferred `co::thread` with `entry` as its entry functor.
+	///
+	/// Its cothread is created on the first switch to it, see `set_deferred()`.
+	///
+	/// \param entry       The entry functor that will begin execution when the `co::thread` starts running.
+	/// \param stack_size  The stack size. Defaults to `co::thread::default_stack_size`.
+	/// \param parent      The explicitly specified parent for this `co::thread`. Defaults to the calling `co::thread`.
+	template <typename F, typename = typename std::enable_if<is_entry<typename std::decay<F>::type>::value>::type>
+	thread(deferred_t, F&& entry, size_t stack_size = default_stack_size, const thread& parent = active());
+	/// Constructs a deferred `co::thread` with `entry` as its entry functor and with its cothread taken from `allocator`
+	/// on the first switch to it.
+	///
+	/// \param entry       The entry functor that will begin execution when the `co::thread` starts running.
+	/// \param stack_size  The stack size.
+	/// \param allocator   The allocator of the cothread, e.g. a `co::thread_pool`. It has to outlive this `co::thread`.
+	/// \param parent      The explicitly specified parent for this `co::thread`. Defaults to the calling `co::thread`.
+	template <typename F, typename = typename std::enable_if<is_entry<typename std::decay<F>::type>::value>::type>
+	thread(deferred_t, F&& entry, size_t stack_size, stack_allocator& allocator, const thread& parent = active());
+
+	/// Creates a `co::thread` with `entry` as its entry functor, reporting a failure to create its cothread in `error`
+	/// instead of throwing `co::thread_create_failure`.
+	///
+	/// \param error       Set to `co::errc::create_failure` on failure, cleared otherwise.
+	/// \param entry       The entry functor that will begin execution when the `co::thread` starts running.
+	/// \param stack_size  The stack size. Defaults to `co::thread::default_stack_size`.
+	/// \param parent      The explicitly specified parent for this `co::thread`. Defaults to the calling `co::thread`.
+	/// \return The new `co::thread`, or an empty `co::thread` on failure.
+	template <typename F, typename = typename std::enable_if<is_entry<typename std::decay<F>::type>::value>::type>
+	static thread try_create(std::error_code& error, F&& entry, size_t stack_size = default_stack_size,
+		const thread& parent = active());
+	/// Creates a `co::thread` with its cothread taken from `allocator`, reporting a failure in `error`.
+	///
+	/// \param error       Set to `co::errc::create_failure` on failure, cleared otherwise.
+	/// \param entry       The entry functor that will begin execution when the `co::thread` starts running.
+	/// \param stack_size  The stack size.
+	/// \param allocator   The allocator of the cothread. It has to outlive the `co::thread`.
+	/// \param parent      The explicitly specified parent for this `co::thread`. Defaults to the calling `co::thread`.
+	/// \return The new `co::thread`, or an empty `co::thread` on failure.
+	template <typename F, typename = typename std::enable_if<is_entry<typename std::decay<F>::type>::value>::type>
+	static thread try_create(std::error_code& error, F&& entry, size_t stack_size, stack_allocator& allocator,
+		const thread& parent = active());
 
 	/// Move constructor.
 	thread(thread&& other) noexcept;
@@ -234,28 +834,188 @@ public:
 	explicit thread(cothread_t cothread, private_token_t) noexcept;
 
 private:
+	/// Constructs a `co::thread` with `entry` as its entry functor without creating its cothread yet.
+	///
+	/// `co::basic_thread` applies its policy before it calls `setup_eager()`.
+	template <typename F>
+	thread(F&& entry, size_t stack_size, const thread& parent, private_token_t);
+
 	struct thread_deleter
 	{
+		stack_allocator* allocator;
+		size_t stack_size;
+
+		thread_deleter() noexcept;
+		thread_deleter(stack_allocator* allocator, size_t stack_size) noexcept;
+
 		void operator()(cothread_t p) const noexcept;
+		void discard(cothread_t p) const noexcept;
 	};
 
 	struct thread_status;
 
-	void setup();
+	/// `co::thread::entry_storage` holds a type erased entry functor.
+	///
+	/// While the entry functor runs it is moved out to the stack of the cothread, and it is moved back into the
+	/// `co::thread` when the entry functor is left. So the running entry functor stays in place even if the
+	/// `co::thread` is moved meanwhile.
+	class entry_storage
+	{
+	public:
+		entry_storage() noexcept;
+		template <typename F>
+		explicit entry_storage(F&& entry);
+		entry_storage(entry_storage&& other) noexcept;
+		entry_storage& operator=(entry_storage&& other) noexcept;
+		~entry_storage();
+
+		entry_storage(const entry_storage& other) = delete;
+		entry_storage& operator=(const entry_storage& other) = delete;
+
+		explicit operator bool() const noexcept;
+
+		/// Runs the entry functor of the active `co::thread`.
+		static void run();
+
+		/// Moves a running entry functor back from the stack of an abandoned cothread.
+		void reclaim() noexcept;
+
+	private:
+		struct operations
+		{
+			void (*run)(entry_storage& storage);
+			void (*relocate)(entry_storage& target, entry_storage& source) noexcept;
+			void (*destroy)(entry_storage& storage) noexcept;
+			void (*reclaim)(entry_storage& storage) noexcept;
+		};
+
+		template <typename F>
+		struct inline_operations;
+		template <typename F>
+		struct heap_operations;
+
+		template <typename F>
+		using is_inline = is_inline_entry<F>;
+
+		template <typename F>
+		using operations_type = typename std::conditional<is_inline<F>::value, inline_operations<F>, heap_operations<F>>::type;
+
+		void reset() noexcept;
+
+		alignas(std::max_align_t) unsigned char m_buffer[inline_entry_size];
+		const operations* m_operations;
+		bool m_running;
+	};
+
+	/// `co::thread::local_storage` holds the values of the `co::local`s of a `co::thread`.
+	///
+	/// The slots are indexed by the `co::local`s and allocated when the first value is stored. A slot also holds the key
+	/// of the `co::local` that stored its value, so a value left behind by a destroyed `co::local` is never returned
+	/// for another one that got the same index.
+	class local_storage
+	{
+	public:
+		local_storage() noexcept;
+		local_storage(local_storage&& other) noexcept;
+		local_storage& operator=(local_storage&& other) noexcept;
+		~local_storage();
+
+		local_storage(const local_storage& other) = delete;
+		local_storage& operator=(const local_storage& other) = delete;
+
+		/// \return The value in slot `index` if `key` stored it, otherwise `nullptr`.
+		void* find(size_t index, std::uint64_t key) const noexcept;
+		/// Stores `value` in slot `index`, destroying the value that was there.
+		void store(size_t index, std::uint64_t key, void* value, void (*destroy)(void* value));
+		/// Destroys the value in slot `index` if `key` stored it.
+		void erase(size_t index, std::uint64_t key) noexcept;
+		/// Destroys every value.
+		void clear() noexcept;
+
+	private:
+		struct slot
+		{
+			void* value;
+			std::uint64_t key;
+			void (*destroy)(void* value);
+		};
+
+		std::unique_ptr<slot[]> m_slots;
+		size_t m_size;
+	};
+
+	void setup() const;
+	/// Creates the cothread if there is none yet.
+	///
+	/// \return `false` if the cothread could not be created.
+	bool try_setup() const noexcept;
+	/// Creates the cothread unless this `co::thread` is deferred.
+	void setup_eager();
+	/// Creates the cothread of a deferred `co::thread` on the first switch to it.
+	CPPCO_COLD inline void setup_deferred() const;
 	static void entry_wrapper() noexcept;
 
+	/// Creates a cothread without a `co::stack_allocator`.
+	static cothread_t create_cothread(size_t stack_size, void (*entry)()) noexcept;
+	/// Deletes a cothread that was created by `create_cothread`.
+	static void delete_cothread(cothread_t cothread) noexcept;
+#ifdef CPPCO_STACK_WATERMARK
+	/// Adds a sample to the report of `co::stack_usage_report()`.
+	static void record_stack_usage(cothread_t cothread, size_t stack_size) noexcept;
+#endif // CPPCO_STACK_WATERMARK
+
 	using thread_ptr = std::unique_ptr<void, thread_deleter>;
 
+	/// Identifies the type of a value passed by `switch_to(value)` for the assertions in `co::receive<T>()`.
+	template <typename T>
+	struct transfer_tag
+	{
+		static constexpr char id = 0;
+	};
+
+	/// Switches to this `co::thread` without handling signals.
+	///
+	/// \return The status of the OS thread the switch returned on.
+	thread_status& switch_raw(thread_status& status) const noexcept;
+#ifdef CPPCO_STATS
+	/// Counts a switch to `next`, and ends or starts a sampled run slice.
+	static void account_switch(thread_status& status, const thread& next) noexcept;
+	/// Reads the clock for `account_switch()`.
+	CPPCO_COLD static inline void sample_slice(thread_status& status) noexcept;
+#endif // CPPCO_STATS
+	/// Switches to this `co::thread` with the transferred value already set in `status`.
+	void switch_with(thread_status& status) const;
+	/// Marks that a switch passes no value, in debug builds only.
+	static void drop_transfer(thread_status& status) noexcept;
+	/// Moves the transferred value out of the `co::thread` that passed it.
+	template <typename T>
+	static T take_transfer(thread_status& status);
+
 	cothread_t get_thread() const noexcept;
-	void stop() const noexcept;
+	void stop() noexcept;
+	void abandon() noexcept;
+
+	CPPCO_COLD static inline void handle_signal(thread_status& status);
 
 	static thread_status& status();
+	/// The status of the OS thread that a switch returned on.
+	static thread_status& resumed_status(thread_status& status);
+#ifndef CPPCO_CUSTOM_STATUS
+	CPPCO_COLD static inline thread_status& create_status();
+#endif // CPPCO_CUSTOM_STATUS
 
-	thread_ptr m_thread;
+	mutable thread_ptr m_thread;
 	const thread* m_parent = nullptr;
-	std::unique_ptr<entry_t> m_entry;
+	stack_allocator* m_allocator = nullptr;
+	mutable entry_storage m_entry;
 	size_t m_stack_size = 0;
+	stop_mode m_stop_mode = default_stop_mode;
 	mutable bool m_active = false;
+	bool m_deferred = false;
+	mutable local_storage m_locals;
+#ifdef CPPCO_STATS
+	mutable detail::thread_accounting m_accounting{ this };
+#endif // CPPCO_STATS
 };
 
 struct thread::thread_status
@@ -263,39 +1023,78 @@ struct thread::thread_status
 	thread main;
 	const thread* current_active = nullptr;
 	const thread* current_thread = nullptr;
+#ifdef CPPCO_NO_EXCEPTIONS
+	/// Set when an entry functor returned, to be reported by `try_switch_to()`.
+	bool current_failure = false;
+#else // CPPCO_NO_EXCEPTIONS
 	std::exception_ptr current_exception;
+#endif // CPPCO_NO_EXCEPTIONS
+	/// The value passed by the last switch, see `co::receive<T>()`.
+	void* transfer = nullptr;
+	const void* transfer_type = nullptr;
+#ifdef CPPCO_STATS
+	/// When the sampled run slice of the active `co::thread` began, in `detail::stats_ticks()`.
+	std::uint64_t slice_start = 0;
+	/// The number of switches until the next sampled run slice begins.
+	std::uint32_t sample_countdown = 1;
+	/// The state of the xorshift generator that picks the sampled run slices.
+	std::uint32_t sample_seed = 2463534242u;
+	/// Whether the run slice of the active `co::thread` is sampled.
+	bool slice_sampled = false;
+#endif // CPPCO_STATS
 
 	thread_status() noexcept;
 
+	/// Whether a stop or a failure is signalled to the cothread returning from `co_switch`.
+	bool has_signal() const noexcept;
+
 #ifdef CPPCO_LIBCO_INTEROP
-	struct thread_order;
-	struct registry;
+	/// Maps the cothreads of an OS thread to their `co::thread`s.
+	///
+	/// An open addressing hash table with linear probing. It belongs to the `thread_status` of its OS thread, so it is
+	/// accessed without locks.
+	struct registry
+	{
+		struct slot
+		{
+			cothread_t cothread;
+			thread* pthread;
+		};
+
+		std::vector<slot> slots;
+		size_t size = 0;
+		/// The `co::thread`s of the external cothreads encountered by `co::active()`.
+		std::vector<std::unique_ptr<thread>> external;
+
+		thread* find(cothread_t cothread) const noexcept;
+		void insert(cothread_t cothread, thread* pthread) noexcept;
+		thread& insert_external(cothread_t cothread) noexcept;
+		void exchange(cothread_t cothread, thread* pthread) noexcept;
+		void erase(cothread_t cothread) noexcept;
+		void clear_external() noexcept;
+
+	private:
+		size_t home_index(cothread_t cothread) const noexcept;
+		size_t index_of(cothread_t cothread) const noexcept;
+		/// Deletes `pthread` if it is an external cothread, otherwise does nothing.
+		void remove_external(thread* pthread) noexcept;
+		void grow();
+	};
+
+	registry threads;
 
 	static registry& get_registry();
 #endif // CPPCO_LIBCO_INTEROP
 };
 
+} // namespace co
 
-#ifdef CPPCO_LIBCO_INTEROP
-struct thread::thread_status::thread_order
-{
-	bool operator()(const thread& lhs, const thread& rhs) const noexcept;
-};
+namespace std {
 
-struct thread::thread_status::registry
-{
-	std::recursive_mutex mutex;
-	std::map<cothread_t, thread*> data;
-	std::set<thread, thread_order> external;
-
-	thread* find(cothread_t cothread) noexcept;
-	void insert(cothread_t cothread, thread* pthread) noexcept;
-	void exchange(cothread_t cothread, thread* pthread) noexcept;
-	void erase(cothread_t cothread) noexcept;
-};
-#endif // CPPCO_LIBCO_INTEROP
+template <>
+struct is_error_code_enum<co::errc> : true_type {};
 
-} // namespace co
+} // namespace std
 
 #include "co.ipp"
 
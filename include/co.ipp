@@ -17,380 +17,1691 @@
 
 #include <cassert>
 #include <utility>
+#include <string>
+#ifdef CPPCO_STACK_WATERMARK
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#endif // CPPCO_STACK_WATERMARK
 
 namespace co {
 
+template <typename T>
+constexpr char thread::transfer_tag<T>::id;
+
 #ifdef __GNUC__
 constexpr size_t thread::default_stack_size __attribute__((weak));
 constexpr thread::private_token_t thread::private_token __attribute__((weak));
+constexpr size_t thread_pool::default_max_retained __attribute__((weak));
 #endif // __GNUC__
 
+inline thread::thread_status& thread::resumed_status(thread_status& status)
+{
+#ifdef CPPCO_THREAD_MIGRATION
+	static_cast<void>(status);
+	return thread::status();
+#else // CPPCO_THREAD_MIGRATION
+	return status;
+#endif // CPPCO_THREAD_MIGRATION
+}
+
 #ifndef CPPCO_CUSTOM_STATUS
 inline thread::thread_status& thread::status()
+{
+	// A constant initialized `thread_local` is accessed without the guard of dynamic initialization.
+	static thread_local thread::thread_status* instance = nullptr;
+	if (CPPCO_UNLIKELY(instance == nullptr))
+	{
+		instance = &create_status();
+	}
+	return *instance;
+}
+
+thread::thread_status& thread::create_status()
 {
 	static thread_local std::unique_ptr<thread::thread_status> instance = std::make_unique<thread::thread_status>();
 	return *instance;
 }
 #endif // CPPCO_CUSTOM_STATUS
 
-inline thread::thread_status::thread_status() noexcept
-	: main{ thread(co_active(), private_token) }
-	, current_active{ &main }
+inline thread_pool::thread_pool(size_t max_retained, stack_allocator* upstream) noexcept
+	: m_upstream{ upstream }
+	, m_max_retained{ max_retained }
 {
 }
 
-inline thread_create_failure::thread_create_failure() noexcept
-	: thread_failure("Failed to create co::thread")
+inline thread_pool::~thread_pool()
 {
+	clear();
 }
 
-inline thread_return_failure::thread_return_failure() noexcept
-	: thread_failure("Return from entry function given to co::thread")
+inline cothread_t thread_pool::allocate(size_t stack_size, void (*entry)()) noexcept
 {
+	CPPCO_TRY
+	{
+		auto&& size_class = m_size_classes[stack_size];
+		// Reserve room for every cothread of the size class, so that `deallocate` never has to allocate.
+		size_class.cothreads.reserve(size_class.cothreads.size() + size_class.outstanding + 1);
+		auto cothread = cothread_t{};
+		if (size_class.cothreads.empty())
+		{
+			cothread = create(stack_size, entry);
+			if (cothread == nullptr)
+			{
+				return nullptr;
+			}
+			++size_class.stats.misses;
+		}
+		else
+		{
+			cothread = size_class.cothreads.back();
+			size_class.cothreads.pop_back();
+			m_retained -= stack_size;
+			++size_class.stats.hits;
+			--size_class.stats.retained;
+		}
+		++size_class.outstanding;
+		return cothread;
+	}
+	CPPCO_CATCH(...)
+	{
+		return nullptr;
+	}
 }
 
-#ifdef CPPCO_LIBCO_INTEROP
-inline void init() noexcept
+inline void thread_pool::deallocate(cothread_t cothread, size_t stack_size) noexcept
 {
-	thread::status();
+	auto it = m_size_classes.find(stack_size);
+	assert(it != m_size_classes.end());
+	auto&& size_class = it->second;
+	assert(size_class.outstanding > 0);
+	--size_class.outstanding;
+	if (m_retained + stack_size > m_max_retained)
+	{
+		destroy(cothread, stack_size);
+		return;
+	}
+	assert(size_class.cothreads.size() < size_class.cothreads.capacity());
+	size_class.cothreads.push_back(cothread);
+	m_retained += stack_size;
+	++size_class.stats.retained;
 }
 
-inline bool thread::thread_status::thread_order::operator()(const thread& lhs, const thread& rhs) const noexcept
+inline void thread_pool::discard(cothread_t cothread, size_t stack_size) noexcept
 {
-	return lhs.get_thread() < rhs.get_thread();
+	auto it = m_size_classes.find(stack_size);
+	assert(it != m_size_classes.end());
+	auto&& size_class = it->second;
+	assert(size_class.outstanding > 0);
+	--size_class.outstanding;
+	// An abandoned cothread is suspended in the middle of its entry function, so it cannot be handed out again.
+	if (m_upstream != nullptr)
+	{
+		m_upstream->discard(cothread, stack_size);
+		return;
+	}
+	thread::delete_cothread(cothread);
 }
 
-inline thread::thread_status::registry& thread::thread_status::get_registry()
+inline size_t thread_pool::get_max_retained() const noexcept
 {
-	static registry instance;
-	return instance;
+	return m_max_retained;
 }
 
-inline thread* thread::thread_status::registry::find(cothread_t cothread) noexcept
+inline void thread_pool::set_max_retained(size_t max_retained) noexcept
 {
-	assert(cothread != nullptr);
-	std::lock_guard<std::recursive_mutex> guard(mutex);
-	auto it = data.find(cothread);
-	if (it == data.end())
+	m_max_retained = max_retained;
+	trim(max_retained);
+}
+
+inline size_t thread_pool::get_retained() const noexcept
+{
+	return m_retained;
+}
+
+inline thread_pool::statistics thread_pool::get_statistics(size_t stack_size) const noexcept
+{
+	auto it = m_size_classes.find(stack_size);
+	if (it == m_size_classes.end())
 	{
-		return nullptr;
+		return statistics{};
 	}
-	return it->second;
+	return it->second.stats;
 }
 
-inline void thread::thread_status::registry::insert(cothread_t cothread, thread* pthread) noexcept
+inline void thread_pool::clear() noexcept
 {
-	if (cothread == nullptr)
+	trim(0);
+}
+
+inline cothread_t thread_pool::create(size_t stack_size, void (*entry)()) noexcept
+{
+	if (m_upstream != nullptr)
 	{
-		return;
+		return m_upstream->allocate(stack_size, entry);
 	}
-	std::lock_guard<std::recursive_mutex> guard(mutex);
-	auto success = data.insert(std::make_pair(cothread, pthread));
-	static_cast<void>(success); // Suppress unused variable warning because `assert` does not.
-	assert(success.second == true);
+	return thread::create_cothread(stack_size, entry);
 }
 
-inline void thread::thread_status::registry::exchange(cothread_t cothread, thread* pthread) noexcept
+inline void thread_pool::destroy(cothread_t cothread, size_t stack_size) noexcept
 {
-	if (cothread == nullptr)
+	if (m_upstream != nullptr)
 	{
+		m_upstream->deallocate(cothread, stack_size);
 		return;
 	}
-	std::lock_guard<std::recursive_mutex> guard(mutex);
-	auto it = data.find(cothread);
-	assert(it != data.end());
-	it->second = pthread;
+	thread::delete_cothread(cothread);
 }
 
-inline void thread::thread_status::registry::erase(cothread_t cothread) noexcept
+inline void thread_pool::trim(size_t max_retained) noexcept
 {
-	if (cothread == nullptr)
+	for (auto&& entry : m_size_classes)
 	{
-		return;
+		auto stack_size = entry.first;
+		auto&& size_class = entry.second;
+		while (m_retained > max_retained && !size_class.cothreads.empty())
+		{
+			destroy(size_class.cothreads.back(), stack_size);
+			size_class.cothreads.pop_back();
+			m_retained -= stack_size;
+			--size_class.stats.retained;
+		}
 	}
-	std::lock_guard<std::recursive_mutex> guard(mutex);
-	auto count = data.erase(cothread);
-	static_cast<void>(count); // Suppress unused variable warning because `assert` does not.
-	assert(count == 1);
 }
 
-inline void set_active_as_main() noexcept
+template <typename F>
+struct thread::entry_storage::inline_operations
 {
-	if (co::active().get_thread() == co::main().get_thread())
+	static F& get(entry_storage& storage) noexcept
 	{
-		return;
+		return *static_cast<F*>(static_cast<void*>(storage.m_buffer));
 	}
 
-	auto&& status = thread::status();
-	status.main = thread(co_active(), thread::private_token);
-	status.current_active = &status.main;
-}
+	// While the entry functor is running the buffer holds its address on the stack of the cothread.
+	static F*& get_running(entry_storage& storage) noexcept
+	{
+		return *static_cast<F**>(static_cast<void*>(storage.m_buffer));
+	}
+
+	template <typename G>
+	static void construct(entry_storage& storage, G&& entry)
+	{
+		::new (static_cast<void*>(storage.m_buffer)) F(std::forward<G>(entry));
+	}
 
+	static void run(entry_storage& storage)
+	{
+		// Keep the running entry functor on the stack of the cothread, where it stays in place.
+		F entry(std::move(get(storage)));
+		get(storage).~F();
+		get_running(storage) = &entry;
+		storage.m_running = true;
+		struct restore_guard
+		{
+			F& entry;
 
-inline void clear_external() noexcept
+			~restore_guard()
+			{
+				// The `co::thread` may have been moved since the entry functor was entered.
+				auto&& target = co::active().m_entry;
+				::new (static_cast<void*>(target.m_buffer)) F(std::move(entry));
+				target.m_running = false;
+			}
+		} guard{ entry };
+		entry();
+	}
+
+	static void relocate(entry_storage& target, entry_storage& source) noexcept
+	{
+		if (source.m_running)
+		{
+			get_running(target) = get_running(source);
+			return;
+		}
+		construct(target, std::move(get(source)));
+		get(source).~F();
+	}
+
+	static void destroy(entry_storage& storage) noexcept
+	{
+		if (storage.m_running)
+		{
+			return;
+		}
+		get(storage).~F();
+	}
+
+	static void reclaim(entry_storage& storage) noexcept
+	{
+		if (!storage.m_running)
+		{
+			return;
+		}
+		auto&& entry = *get_running(storage);
+		construct(storage, std::move(entry));
+		entry.~F();
+		storage.m_running = false;
+	}
+
+	static const operations& table() noexcept
+	{
+		static const operations instance = { &run, &relocate, &destroy, &reclaim };
+		return instance;
+	}
+};
+
+template <typename F>
+struct thread::entry_storage::heap_operations
+{
+	static F*& get(entry_storage& storage) noexcept
+	{
+		return *static_cast<F**>(static_cast<void*>(storage.m_buffer));
+	}
+
+	template <typename G>
+	static void construct(entry_storage& storage, G&& entry)
+	{
+		get(storage) = new F(std::forward<G>(entry));
+	}
+
+	static void run(entry_storage& storage)
+	{
+		(*get(storage))();
+	}
+
+	static void relocate(entry_storage& target, entry_storage& source) noexcept
+	{
+		get(target) = get(source);
+	}
+
+	static void destroy(entry_storage& storage) noexcept
+	{
+		delete get(storage);
+	}
+
+	static void reclaim(entry_storage&) noexcept
+	{
+	}
+
+	static const operations& table() noexcept
+	{
+		static const operations instance = { &run, &relocate, &destroy, &reclaim };
+		return instance;
+	}
+};
+
+inline thread::entry_storage::entry_storage() noexcept
+	: m_operations{ nullptr }
+	, m_running{ false }
 {
-	auto&& registry = thread::thread_status::get_registry();
-	std::lock_guard<std::recursive_mutex> guard(registry.mutex);
-	registry.external.clear();
 }
-#endif // CPPCO_LIBCO_INTEROP
 
-inline const thread& active() noexcept
+template <typename F>
+inline thread::entry_storage::entry_storage(F&& entry)
+	: entry_storage()
 {
-	auto&& status = thread::status();
-#ifdef CPPCO_LIBCO_INTEROP
-	auto active_cothread = co_active();
-	if (status.current_active->get_thread() == active_cothread)
+	using operations = operations_type<typename std::decay<F>::type>;
+	operations::construct(*this, std::forward<F>(entry));
+	m_operations = &operations::table();
+}
+
+inline thread::entry_storage::entry_storage(entry_storage&& other) noexcept
+	: m_operations{ other.m_operations }
+	, m_running{ other.m_running }
+{
+	if (m_operations != nullptr)
 	{
-		return *status.current_active;
+		m_operations->relocate(*this, other);
 	}
-	auto&& registry = thread::thread_status::get_registry();
-	std::lock_guard<std::recursive_mutex> guard(registry.mutex);
-	auto* cothread = registry.find(active_cothread);
-	if (cothread != nullptr)
+	other.m_operations = nullptr;
+	other.m_running = false;
+}
+
+inline thread::entry_storage& thread::entry_storage::operator=(entry_storage&& other) noexcept
+{
+	if (this != &other)
 	{
-		status.current_active = cothread;
-		return *status.current_active;
+		reset();
+		m_operations = other.m_operations;
+		m_running = other.m_running;
+		if (m_operations != nullptr)
+		{
+			m_operations->relocate(*this, other);
+		}
+		other.m_operations = nullptr;
+		other.m_running = false;
 	}
-	auto success = registry.external.insert(thread(active_cothread, thread::private_token));
-	assert(success.second == true);
-	assert(registry.find(active_cothread) == &*success.first);
-	status.current_active = &*success.first;
-	return *status.current_active;
-#else // CPPCO_LIBCO_INTEROP
-	assert(status.current_active->get_thread() == co_active());
-	return *status.current_active;
-#endif // CPPCO_LIBCO_INTEROP
+	return *this;
 }
 
-inline const thread& main() noexcept
+inline thread::entry_storage::~entry_storage()
 {
-	return thread::status().main;
+	reset();
 }
 
-inline cothread_t thread::get_thread() const noexcept
+inline thread::entry_storage::operator bool() const noexcept
 {
-	return m_thread.get();
+	return m_operations != nullptr;
 }
 
-inline size_t thread::get_stack_size() const noexcept
+inline void thread::entry_storage::run()
 {
-	return m_stack_size;
+	auto&& storage = co::active().m_entry;
+	assert(storage);
+	storage.m_operations->run(storage);
 }
-inline void thread::set_stack_size(size_t stack_size) noexcept
+
+inline void thread::entry_storage::reclaim() noexcept
 {
-	m_stack_size = stack_size;
-	if (!*this)
+	if (m_operations != nullptr)
 	{
-		return;
+		m_operations->reclaim(*this);
 	}
-	stop();
-#ifdef CPPCO_LIBCO_INTEROP
-	thread_status::get_registry().erase(get_thread());
-#endif // CPPCO_LIBCO_INTEROP
-	m_thread.reset();
-	setup();
 }
 
-inline void thread::set_parent(const thread& parent) noexcept
+inline void thread::entry_storage::reset() noexcept
 {
-	m_parent = &parent;
+	if (m_operations != nullptr)
+	{
+		m_operations->destroy(*this);
+	}
+	m_operations = nullptr;
+	m_running = false;
 }
 
-inline const thread& thread::get_parent() const noexcept
+inline thread::local_storage::local_storage() noexcept
+	: m_size{ 0 }
 {
-	return *m_parent;
 }
 
-inline void thread::thread_deleter::operator()(cothread_t p) const noexcept
+inline thread::local_storage::local_storage(local_storage&& other) noexcept
+	: m_slots{ std::move(other.m_slots) }
+	, m_size{ std::exchange(other.m_size, 0) }
 {
-	assert(p);
-	co_delete(p);
 }
 
-inline void thread::reset()
+inline thread::local_storage& thread::local_storage::operator=(local_storage&& other) noexcept
 {
-	stop();
-	m_entry = nullptr;
-#ifdef CPPCO_LIBCO_INTEROP
-	thread_status::get_registry().erase(get_thread());
-#endif // CPPCO_LIBCO_INTEROP
-	m_thread.reset();
+	clear();
+	m_slots = std::move(other.m_slots);
+	m_size = std::exchange(other.m_size, 0);
+	return *this;
 }
 
-inline void thread::reset(thread::entry_t entry)
+inline thread::local_storage::~local_storage()
 {
-	stop();
-	m_entry = std::make_unique<entry_t>(std::move(entry));
-	setup();
+	clear();
 }
 
-inline void thread::rewind()
+inline void* thread::local_storage::find(size_t index, std::uint64_t key) const noexcept
 {
-	stop();
-	setup();
+	if (index >= m_size || m_slots[index].key != key)
+	{
+		return nullptr;
+	}
+	return m_slots[index].value;
 }
 
-inline void thread::switch_to() const
+inline void thread::local_storage::store(size_t index, std::uint64_t key, void* value, void (*destroy)(void* value))
 {
-	auto* thread = get_thread();
-	assert(thread != nullptr);
-	status().current_active = this;
-	co_switch(thread);
-	// If the current thread variable is set while switch_to is called then it's the stop function that's issuing the call and the entry function stack has to be destroyed. Propagate an exception to achieve that.
- 	if (status().current_thread)
+	if (index >= m_size)
 	{
-		throw thread_stopping();
+		auto size = std::max(index + 1, m_size * 2);
+		std::unique_ptr<slot[]> slots(new slot[size]());
+		std::copy(m_slots.get(), m_slots.get() + m_size, slots.get());
+		m_slots = std::move(slots);
+		m_size = size;
 	}
-	// If there is an active exception then this is the callback to the failure handling cothread. Rethrow the exception.
-	if (auto exception = std::exchange(status().current_exception, nullptr))
+	auto previous = m_slots[index];
+	m_slots[index] = slot{ value, key, destroy };
+	if (previous.value != nullptr)
 	{
-		std::rethrow_exception(exception);
+		previous.destroy(previous.value);
 	}
 }
 
-inline void thread::stop() const noexcept
+inline void thread::local_storage::erase(size_t index, std::uint64_t key) noexcept
 {
-	if (!*this || m_parent == nullptr)
+	if (index >= m_size || m_slots[index].key != key || m_slots[index].value == nullptr)
 	{
 		return;
 	}
-	assert(status().current_thread == nullptr);
-	status().current_thread = &active();
-	switch_to();
-}
-
-inline thread::thread(size_t stack_size)
-	: thread(active(), stack_size) 
-{
-}
-
-inline thread::thread(const thread& parent, size_t stack_size)
-	: m_parent{ &parent }
-	, m_stack_size{ stack_size }
-{
+	auto previous = std::exchange(m_slots[index], slot{ nullptr, 0, nullptr });
+	previous.destroy(previous.value);
 }
 
-inline thread::~thread()
+inline void thread::local_storage::clear() noexcept
 {
-	stop();
-#ifdef CPPCO_LIBCO_INTEROP
-	thread_status::get_registry().erase(get_thread());
-#endif // CPPCO_LIBCO_INTEROP
-	if (m_parent == nullptr)
+	// The destructors of the values may use `co::local`s themselves, so the slots are detached first.
+	auto slots = std::move(m_slots);
+	auto size = std::exchange(m_size, 0);
+	for (auto i = size; i > 0; --i)
 	{
-		m_thread.release(); // `cppco` does not own external cothreads.
+		auto&& entry = slots[i - 1];
+		if (entry.value != nullptr)
+		{
+			entry.destroy(entry.value);
+		}
 	}
-
 }
 
-inline thread::thread(thread&& other) noexcept
-	: m_thread{ std::move(other.m_thread) }
-	, m_parent{ std::exchange(other.m_parent, &co::active()) }
-	, m_entry{ std::move(other.m_entry) }
-	, m_stack_size{ std::exchange(other.m_stack_size, default_stack_size) }
-	, m_active{ std::exchange(other.m_active, false) }
+inline thread::thread_status::thread_status() noexcept
+	: main{ co_active(), private_token }
+	, current_active{ &main }
 {
 #ifdef CPPCO_LIBCO_INTEROP
-	thread_status::get_registry().exchange(get_thread(), this);
+	threads.insert(main.get_thread(), &main);
 #endif // CPPCO_LIBCO_INTEROP
 }
 
-inline thread& thread::operator=(thread&& other) noexcept
+inline bool thread::thread_status::has_signal() const noexcept
 {
-	m_thread = std::move(other.m_thread);
-	m_parent = std::exchange(other.m_parent, &co::active());
-	m_entry = std::move(other.m_entry);
-	m_stack_size = std::exchange(other.m_stack_size, default_stack_size);
-	m_active = std::exchange(other.m_active, false);
-#ifdef CPPCO_LIBCO_INTEROP
-	thread_status::get_registry().exchange(get_thread(), this);
-#endif // CPPCO_LIBCO_INTEROP
-	return *this;
+	// Bitwise or, so that the common path has a single branch.
+#ifdef CPPCO_NO_EXCEPTIONS
+	return (current_thread != nullptr) | current_failure;
+#else // CPPCO_NO_EXCEPTIONS
+	return (current_thread != nullptr) | (current_exception != nullptr);
+#endif // CPPCO_NO_EXCEPTIONS
 }
 
-inline thread::thread(cothread_t cothread, thread::private_token_t) noexcept
-	: m_thread{ cothread }
-	, m_active{ true }
+inline thread_create_failure::thread_create_failure() noexcept
+	: thread_failure("Failed to create co::thread")
 {
-#ifdef CPPCO_LIBCO_INTEROP
-	thread_status::get_registry().insert(get_thread(), this);
-#endif // CPPCO_LIBCO_INTEROP
 }
 
-inline thread::thread(thread::entry_t entry, const thread& parent)
-	: thread(std::move(entry), default_stack_size, parent)
+inline thread_return_failure::thread_return_failure() noexcept
+	: thread_failure("Return from entry function given to co::thread")
 {
 }
 
-inline thread::thread(thread::entry_t entry, size_t stack_size, const thread& parent)
-	: m_parent{ &parent }
-	, m_entry{ std::make_unique<entry_t>(std::move(entry)) }
-	, m_stack_size{ stack_size }
-{
-	setup();
-}
+namespace detail {
 
-inline void thread::setup()
+class error_category : public std::error_category
 {
-	if (!m_thread)
+public:
+	const char* name() const noexcept override
 	{
-		auto cothread = cothread_t{};
-		auto int_stack_size = static_cast<unsigned int>(m_stack_size);
-#ifdef CPPCO_FLB_LIBCO
-		size_t real_stack_size;
-		cothread = co_create(int_stack_size, &entry_wrapper, &real_stack_size);
-#else // CPPCO_FLB_LIBCO
-		cothread = co_create(int_stack_size, &entry_wrapper);
-#endif // CPPCO_FLB_LIBCO
-#ifdef CPPCO_LIBCO_INTEROP
-		auto&& registry = thread_status::get_registry();
-		std::lock_guard<std::recursive_mutex> guard(registry.mutex);
-		registry.erase(get_thread());
-#endif // CPPCO_LIBCO_INTEROP
-		m_thread.reset(cothread);
-#ifdef CPPCO_LIBCO_INTEROP
-		registry.insert(get_thread(), this);
-#endif // CPPCO_LIBCO_INTEROP
+		return "cppco";
 	}
-	if (m_thread == nullptr)
+
+	std::string message(int condition) const override
 	{
-		status().current_thread = nullptr;
-		throw thread_create_failure();
+		switch (static_cast<errc>(condition))
+		{
+		case errc::create_failure:
+			return "Failed to create co::thread";
+		case errc::return_failure:
+			return "Return from entry function given to co::thread";
+		}
+		return "Unknown cppco error";
 	}
+};
+
+#ifdef CPPCO_NO_EXCEPTIONS
+template <typename E>
+inline void abort_with(const E& failure) noexcept
+{
+	std::fputs(failure.what(), stderr);
+	std::fputc('\n', stderr);
+	std::abort();
 }
+#endif // CPPCO_NO_EXCEPTIONS
 
-inline thread::operator bool() const noexcept
+} // namespace detail
+
+inline const std::error_category& error_category() noexcept
 {
-	return static_cast<bool>(m_active);
+	static const detail::error_category category;
+	return category;
 }
 
-inline void thread::entry_wrapper() noexcept
+inline std::error_code make_error_code(errc error) noexcept
 {
-	while (true) // Reuse
-	{
-		co::active().m_active = true;
+	return std::error_code(static_cast<int>(error), error_category());
+}
+
+#ifdef CPPCO_LIBCO_INTEROP
+inline void init() noexcept
+{
+	thread::status();
+}
+
+inline thread::thread_status::registry& thread::thread_status::get_registry()
+{
+	return status().threads;
+}
+
+inline size_t thread::thread_status::registry::home_index(cothread_t cothread) const noexcept
+{
+	// The low bits of cothread addresses are mostly zero because of alignment, so the address is scrambled first.
+	auto hash = reinterpret_cast<std::uintptr_t>(cothread);
+	hash *= static_cast<std::uintptr_t>(0x9E3779B97F4A7C15ull);
+	hash ^= hash >> (sizeof(hash) * 4);
+	return static_cast<size_t>(hash) & (slots.size() - 1);
+}
+
+inline size_t thread::thread_status::registry::index_of(cothread_t cothread) const noexcept
+{
+	// The slot of `cothread`, or the empty slot where it would be inserted.
+	auto mask = slots.size() - 1;
+	auto index = home_index(cothread);
+	while (slots[index].cothread != nullptr && slots[index].cothread != cothread)
+	{
+		index = (index + 1) & mask;
+	}
+	return index;
+}
+
+inline thread* thread::thread_status::registry::find(cothread_t cothread) const noexcept
+{
+	assert(cothread != nullptr);
+	if (slots.empty())
+	{
+		return nullptr;
+	}
+	return slots[index_of(cothread)].pthread;
+}
+
+inline void thread::thread_status::registry::insert(cothread_t cothread, thread* pthread) noexcept
+{
+	if (cothread == nullptr)
+	{
+		return;
+	}
+	if ((size + 1) * 2 > slots.size())
+	{
+		grow();
+	}
+	auto&& slot = slots[index_of(cothread)];
+	if (slot.cothread != nullptr)
+	{
+		// The address of a deleted cothread was reused. The entry of an external one goes away with it, the stale entry
+		// of an owned `co::thread` is overwritten.
+		remove_external(slot.pthread);
+		slot.pthread = pthread;
+		return;
+	}
+	slot.cothread = cothread;
+	slot.pthread = pthread;
+	++size;
+}
+
+inline thread& thread::thread_status::registry::insert_external(cothread_t cothread) noexcept
+{
+	assert(find(cothread) == nullptr);
+	external.push_back(std::unique_ptr<thread>(new thread(cothread, private_token)));
+	insert(cothread, external.back().get());
+	return *external.back();
+}
+
+inline void thread::thread_status::registry::exchange(cothread_t cothread, thread* pthread) noexcept
+{
+	if (cothread == nullptr)
+	{
+		return;
+	}
+	assert(!slots.empty());
+	auto&& slot = slots[index_of(cothread)];
+	assert(slot.cothread == cothread);
+	slot.pthread = pthread;
+}
+
+inline void thread::thread_status::registry::erase(cothread_t cothread) noexcept
+{
+	if (cothread == nullptr)
+	{
+		return;
+	}
+	assert(!slots.empty());
+	auto hole = index_of(cothread);
+	if (slots[hole].cothread == nullptr)
+	{
+		// The entry was already taken over and erased by a cothread at the same address.
+		return;
+	}
+	// Shift the following entries of the probe sequence back instead of leaving a tombstone.
+	auto mask = slots.size() - 1;
+	for (auto index = (hole + 1) & mask; slots[index].cothread != nullptr; index = (index + 1) & mask)
+	{
+		auto home = home_index(slots[index].cothread);
+		if (((index - home) & mask) >= ((index - hole) & mask))
+		{
+			slots[hole] = slots[index];
+			hole = index;
+		}
+	}
+	slots[hole] = slot{};
+	--size;
+}
+
+inline void thread::thread_status::registry::clear_external() noexcept
+{
+	for (auto&& pthread : external)
+	{
+		if (find(pthread->get_thread()) == pthread.get())
+		{
+			erase(pthread->get_thread());
+		}
+	}
+	external.clear();
+}
+
+inline void thread::thread_status::registry::remove_external(thread* pthread) noexcept
+{
+	// `pthread` is only compared, as it may point to a destroyed owned `co::thread`.
+	auto it = external.begin();
+	while (it != external.end() && it->get() != pthread)
+	{
+		++it;
+	}
+	if (it == external.end())
+	{
+		return;
+	}
+	auto&& status = thread::status();
+	if (status.current_active == pthread)
+	{
+		status.current_active = &status.main; // Corrected by the next `co::active()`.
+	}
+	std::swap(*it, external.back());
+	external.pop_back();
+}
+
+inline void thread::thread_status::registry::grow()
+{
+	auto old_slots = std::move(slots);
+	slots.assign(old_slots.empty() ? 16 : old_slots.size() * 2, slot{});
+	for (auto&& old_slot : old_slots)
+	{
+		if (old_slot.cothread != nullptr)
+		{
+			slots[index_of(old_slot.cothread)] = old_slot;
+		}
+	}
+}
+
+inline void set_active_as_main() noexcept
+{
+	if (co::active().get_thread() == co::main().get_thread())
+	{
+		return;
+	}
+
+	auto&& status = thread::status();
+	status.main = thread(co_active(), thread::private_token);
+	status.current_active = &status.main;
+}
+
+
+inline void clear_external() noexcept
+{
+	auto&& status = thread::status();
+	status.threads.clear_external();
+	status.current_active = &status.main; // Corrected by the next `co::active()`.
+}
+#endif // CPPCO_LIBCO_INTEROP
+
+inline const thread& active() noexcept
+{
+	auto&& status = thread::status();
+#ifdef CPPCO_LIBCO_INTEROP
+	auto active_cothread = co_active();
+	if (status.current_active->get_thread() == active_cothread)
+	{
+		return *status.current_active;
+	}
+	auto* cothread = status.threads.find(active_cothread);
+	if (cothread == nullptr)
+	{
+		cothread = &status.threads.insert_external(active_cothread);
+	}
+	status.current_active = cothread;
+	return *status.current_active;
+#else // CPPCO_LIBCO_INTEROP
+	assert(status.current_active->get_thread() == co_active());
+	return *status.current_active;
+#endif // CPPCO_LIBCO_INTEROP
+}
+
+inline const thread& main() noexcept
+{
+	return thread::status().main;
+}
+
+inline cothread_t thread::get_thread() const noexcept
+{
+	return m_thread.get();
+}
+
+inline size_t thread::get_stack_size() const noexcept
+{
+	return m_stack_size;
+}
+inline void thread::set_stack_size(size_t stack_size) noexcept
+{
+	m_stack_size = stack_size;
+	if (!*this)
+	{
+		return;
+	}
+	stop();
+#ifdef CPPCO_LIBCO_INTEROP
+	thread_status::get_registry().erase(get_thread());
+#endif // CPPCO_LIBCO_INTEROP
+	m_thread.reset();
+	setup_eager();
+}
+
+inline bool thread::is_deferred() const noexcept
+{
+	return m_deferred;
+}
+
+inline void thread::set_deferred(bool deferred) noexcept
+{
+	m_deferred = deferred;
+}
+
+inline stack_allocator* thread::get_allocator() const noexcept
+{
+	return m_allocator;
+}
+
+inline void thread::set_allocator(stack_allocator* allocator) noexcept
+{
+	m_allocator = allocator;
+}
+
+inline void thread::set_parent(const thread& parent) noexcept
+{
+	m_parent = &parent;
+}
+
+inline const thread& thread::get_parent() const noexcept
+{
+	return *m_parent;
+}
+
+inline thread::thread_deleter::thread_deleter() noexcept
+	: thread_deleter(nullptr, 0)
+{
+}
+
+inline thread::thread_deleter::thread_deleter(stack_allocator* allocator, size_t stack_size) noexcept
+	: allocator{ allocator }
+	, stack_size{ stack_size }
+{
+}
+
+inline void thread::thread_deleter::operator()(cothread_t p) const noexcept
+{
+	assert(p);
+	CPPCO_TRACE_EVENT(reset, p, nullptr);
+#ifdef CPPCO_STACK_WATERMARK
+	record_stack_usage(p, stack_size);
+#endif // CPPCO_STACK_WATERMARK
+	if (allocator != nullptr)
+	{
+		allocator->deallocate(p, stack_size);
+		return;
+	}
+	delete_cothread(p);
+}
+
+inline void thread::thread_deleter::discard(cothread_t p) const noexcept
+{
+	assert(p);
+	CPPCO_TRACE_EVENT(reset, p, nullptr);
+#ifdef CPPCO_STACK_WATERMARK
+	record_stack_usage(p, stack_size);
+#endif // CPPCO_STACK_WATERMARK
+	if (allocator != nullptr)
+	{
+		allocator->discard(p, stack_size);
+		return;
+	}
+	delete_cothread(p);
+}
+
+inline void thread::reset()
+{
+	stop();
+	m_locals.clear();
+	m_entry = entry_storage();
+#ifdef CPPCO_LIBCO_INTEROP
+	thread_status::get_registry().erase(get_thread());
+#endif // CPPCO_LIBCO_INTEROP
+	m_thread.reset();
+}
+
+template <typename F, typename>
+inline void thread::reset(F&& entry)
+{
+	stop();
+	m_locals.clear();
+	m_entry = entry_storage(std::forward<F>(entry));
+	setup_eager();
+}
+
+inline void thread::rewind()
+{
+	stop();
+	m_locals.clear();
+	setup_eager();
+}
+
+inline void thread::switch_to() const
+{
+	auto&& status = thread::status();
+	drop_transfer(status);
+	switch_with(status);
+}
+
+template <typename T, typename U>
+inline T thread::switch_to(U&& value) const
+{
+	static_assert(!std::is_lvalue_reference<U>::value, "co::thread::switch_to moves the value, pass an rvalue");
+	static_assert(!std::is_const<typename std::remove_reference<U>::type>::value,
+		"co::thread::switch_to moves the value, it cannot be const");
+	auto&& status = thread::status();
+	status.transfer = static_cast<void*>(std::addressof(value));
+	status.transfer_type = &transfer_tag<typename std::decay<U>::type>::id;
+	switch_with(status);
+	return take_transfer<T>(resumed_status(status));
+}
+
+#ifndef CPPCO_NO_EXCEPTIONS
+inline void thread::throw_to(std::exception_ptr exception) const
+{
+	assert(exception != nullptr);
+	auto&& status = thread::status();
+	assert(status.current_exception == nullptr);
+	status.current_exception = std::move(exception);
+	drop_transfer(status);
+	switch_with(status);
+}
+#endif // CPPCO_NO_EXCEPTIONS
+
+inline void thread::drop_transfer(thread_status& status) noexcept
+{
+#ifndef NDEBUG
+	// The receiver clears the value it takes, this only lets the assertions of `co::receive<T>()` see a stale one.
+	status.transfer = nullptr;
+#else // NDEBUG
+	static_cast<void>(status);
+#endif // NDEBUG
+}
+
+template <typename T>
+inline T thread::take_transfer(thread_status& status)
+{
+	assert(status.transfer != nullptr);
+	assert(status.transfer_type == &transfer_tag<T>::id);
+	auto* value = static_cast<T*>(std::exchange(status.transfer, nullptr));
+	return std::move(*value);
+}
+
+template <>
+inline void thread::take_transfer<void>(thread_status& status)
+{
+	drop_transfer(status);
+}
+
+template <typename T>
+inline T receive()
+{
+	return thread::take_transfer<T>(thread::status());
+}
+
+inline thread::thread_status& thread::switch_raw(thread_status& status) const noexcept
+{
+	auto* cothread = get_thread();
+	assert(cothread != nullptr);
+	CPPCO_TRACE_EVENT(switch_to, status.current_active->get_thread(), cothread);
+#ifdef CPPCO_STATS
+	account_switch(status, *this);
+#endif // CPPCO_STATS
+	status.current_active = this;
+	co_switch(cothread);
+	return resumed_status(status);
+}
+
+#ifdef CPPCO_STATS
+inline void thread::account_switch(thread_status& status, const thread& next) noexcept
+{
+	next.m_accounting.add_switch();
+	if (CPPCO_UNLIKELY(--status.sample_countdown == 0 || status.slice_sampled))
+	{
+		sample_slice(status);
+	}
+}
+
+void thread::sample_slice(thread_status& status) noexcept
+{
+	auto now = detail::stats_ticks();
+	if (status.slice_sampled)
+	{
+		// The time stamp counters of the cores may be slightly apart, and the OS thread may have moved between them.
+		status.current_active->m_accounting.add_slice(now > status.slice_start ? now - status.slice_start : 0);
+	}
+	status.slice_sampled = status.sample_countdown == 0;
+	if (status.slice_sampled)
+	{
+		status.slice_start = now;
+		// The distance to the next sample is random, so a periodic pattern of switches cannot skew the sample.
+		auto seed = status.sample_seed;
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+		status.sample_seed = seed;
+		status.sample_countdown = 1 + seed % (2 * CPPCO_STATS_SAMPLE_PERIOD - 1);
+	}
+}
+#endif // CPPCO_STATS
+
+inline void thread::switch_with(thread_status& status) const
+{
+	if (CPPCO_UNLIKELY(!m_thread))
+	{
+		setup_deferred();
+	}
+	auto&& resumed = switch_raw(status);
+	if (CPPCO_UNLIKELY(resumed.has_signal()))
+	{
+		handle_signal(resumed);
+	}
+}
+
+#ifdef CPPCO_NO_EXCEPTIONS
+inline std::error_code thread::try_switch_to() const noexcept
+{
+	if (CPPCO_UNLIKELY(!m_thread))
+	{
+		assert(m_deferred);
+		if (!try_setup())
+		{
+			return make_error_code(errc::create_failure);
+		}
+	}
+	auto&& status = thread::status();
+	drop_transfer(status);
+	auto&& resumed = switch_raw(status);
+	if (CPPCO_UNLIKELY(std::exchange(resumed.current_failure, false)))
+	{
+		return make_error_code(errc::return_failure);
+	}
+	return std::error_code();
+}
+#endif // CPPCO_NO_EXCEPTIONS
+
+inline void thread::switch_to_fast() const noexcept
+{
+	if (CPPCO_UNLIKELY(!m_thread))
+	{
+		setup_deferred();
+	}
+	auto&& status = thread::status();
+	drop_transfer(status);
+	auto&& resumed = switch_raw(status);
+	static_cast<void>(resumed); // Suppress unused variable warning because `assert` does not.
+	assert(!resumed.has_signal() || (resumed.current_thread != nullptr && resumed.current_active->m_stop_mode == stop_mode::cooperative));
+}
+
+void thread::handle_signal(thread_status& status)
+{
+#ifdef CPPCO_NO_EXCEPTIONS
+	// Only cooperative entry functions are stopped by switching to them, and they return by themselves.
+	if (status.current_thread)
+	{
+		return;
+	}
+	status.current_failure = false;
+	detail::abort_with(thread_return_failure());
+#else // CPPCO_NO_EXCEPTIONS
+	// If the current thread variable is set while switch_to is called then it's the stop function that's issuing the call and the entry function stack has to be destroyed. Propagate an exception to achieve that.
+	if (status.current_thread)
+	{
+		// A cooperative entry function returns by itself once it sees `stop_requested()`.
+		if (status.current_active->m_stop_mode == stop_mode::cooperative)
+		{
+			return;
+		}
+		throw thread_stopping();
+	}
+	// If there is an active exception then this is the callback to the failure handling cothread. Rethrow the exception.
+	std::rethrow_exception(std::exchange(status.current_exception, nullptr));
+#endif // CPPCO_NO_EXCEPTIONS
+}
+
+inline void thread::stop() noexcept
+{
+	if (!*this || m_parent == nullptr)
+	{
+		return;
+	}
+	CPPCO_TRACE_EVENT(stop, get_thread(), nullptr);
+#ifdef CPPCO_NO_EXCEPTIONS
+	// Without exceptions the stack cannot be unwound, and abandoning it instead would skip its destructors silently.
+	if (m_stop_mode == stop_mode::unwind)
+	{
+		std::fputs("co::stop_mode::unwind needs exceptions\n", stderr);
+		std::abort();
+	}
+	if (m_stop_mode == stop_mode::abandon)
+#else // CPPCO_NO_EXCEPTIONS
+	if (m_stop_mode == stop_mode::abandon)
+#endif // CPPCO_NO_EXCEPTIONS
+	{
+		abandon();
+		return;
+	}
+	auto&& status = thread::status();
+	assert(status.current_thread == nullptr);
+	status.current_thread = &active();
+	switch_to();
+}
+
+inline void thread::abandon() noexcept
+{
+	m_entry.reclaim();
+	m_active = false;
+#ifdef CPPCO_LIBCO_INTEROP
+	thread_status::get_registry().erase(get_thread());
+#endif // CPPCO_LIBCO_INTEROP
+	m_thread.get_deleter().discard(m_thread.release());
+}
+
+inline stop_mode thread::get_stop_mode() const noexcept
+{
+	return m_stop_mode;
+}
+
+inline void thread::set_stop_mode(stop_mode mode) noexcept
+{
+	m_stop_mode = mode;
+}
+
+inline bool thread::stop_requested() const noexcept
+{
+	auto&& status = thread::status();
+	return status.current_thread != nullptr && status.current_active == this;
+}
+
+inline bool stop_requested() noexcept
+{
+	return active().stop_requested();
+}
+
+inline thread::thread(size_t stack_size)
+	: thread(active(), stack_size) 
+{
+}
+
+inline thread::thread(const thread& parent, size_t stack_size)
+	: m_parent{ &parent }
+	, m_stack_size{ stack_size }
+{
+}
+
+inline thread::~thread()
+{
+	stop();
+	if (m_parent == nullptr)
+	{
+		// `cppco` does not own external cothreads. Their registry entries go away together with the `thread_status`.
+		m_thread.release();
+		return;
+	}
+#ifdef CPPCO_LIBCO_INTEROP
+	thread_status::get_registry().erase(get_thread());
+#endif // CPPCO_LIBCO_INTEROP
+}
+
+inline thread::thread(thread&& other) noexcept
+	: m_thread{ std::move(other.m_thread) }
+	, m_parent{ std::exchange(other.m_parent, &co::active()) }
+	, m_allocator{ std::exchange(other.m_allocator, nullptr) }
+	, m_entry{ std::move(other.m_entry) }
+	, m_stack_size{ std::exchange(other.m_stack_size, default_stack_size) }
+	, m_stop_mode{ std::exchange(other.m_stop_mode, default_stop_mode) }
+	, m_active{ std::exchange(other.m_active, false) }
+	, m_deferred{ std::exchange(other.m_deferred, false) }
+	, m_locals{ std::move(other.m_locals) }
+{
+#ifdef CPPCO_STATS
+	m_accounting.take(other.m_accounting);
+#endif // CPPCO_STATS
+#ifdef CPPCO_LIBCO_INTEROP
+	thread_status::get_registry().exchange(get_thread(), this);
+#endif // CPPCO_LIBCO_INTEROP
+}
+
+inline thread& thread::operator=(thread&& other) noexcept
+{
+	if (this == &other)
+	{
+		return *this;
+	}
+	// The cothread held so far is released like in the destructor before the one of `other` is taken over.
+	stop();
+	if (m_parent == nullptr)
+	{
+		m_thread.release();
+	}
+#ifdef CPPCO_LIBCO_INTEROP
+	else
+	{
+		thread_status::get_registry().erase(get_thread());
+	}
+#endif // CPPCO_LIBCO_INTEROP
+	m_locals.clear();
+	m_thread.reset();
+	m_thread = std::move(other.m_thread);
+	m_parent = std::exchange(other.m_parent, &co::active());
+	m_allocator = std::exchange(other.m_allocator, nullptr);
+	m_entry = std::move(other.m_entry);
+	m_stack_size = std::exchange(other.m_stack_size, default_stack_size);
+	m_stop_mode = std::exchange(other.m_stop_mode, default_stop_mode);
+	m_active = std::exchange(other.m_active, false);
+	m_deferred = std::exchange(other.m_deferred, false);
+	m_locals = std::move(other.m_locals);
+#ifdef CPPCO_STATS
+	m_accounting.take(other.m_accounting);
+#endif // CPPCO_STATS
+#ifdef CPPCO_LIBCO_INTEROP
+	thread_status::get_registry().exchange(get_thread(), this);
+#endif // CPPCO_LIBCO_INTEROP
+	return *this;
+}
+
+inline thread::thread(cothread_t cothread, thread::private_token_t) noexcept
+	: m_thread{ cothread }
+	, m_active{ true }
+{
+}
+
+template <typename F, typename>
+inline thread::thread(F&& entry, const thread& parent)
+	: thread(std::forward<F>(entry), default_stack_size, parent)
+{
+}
+
+template <typename F, typename>
+inline thread::thread(F&& entry, size_t stack_size, const thread& parent)
+	: m_parent{ &parent }
+	, m_entry{ std::forward<F>(entry) }
+	, m_stack_size{ stack_size }
+{
+	setup();
+}
+
+template <typename F, typename>
+inline thread::thread(F&& entry, size_t stack_size, stack_allocator& allocator, const thread& parent)
+	: m_parent{ &parent }
+	, m_allocator{ &allocator }
+	, m_entry{ std::forward<F>(entry) }
+	, m_stack_size{ stack_size }
+{
+	setup();
+}
+
+template <typename F>
+inline thread::thread(F&& entry, size_t stack_size, const thread& parent, private_token_t)
+	: m_parent{ &parent }
+	, m_entry{ std::forward<F>(entry) }
+	, m_stack_size{ stack_size }
+{
+}
+
+template <typename F, typename>
+inline thread::thread(deferred_t, F&& entry, size_t stack_size, const thread& parent)
+	: m_parent{ &parent }
+	, m_entry{ std::forward<F>(entry) }
+	, m_stack_size{ stack_size }
+	, m_deferred{ true }
+{
+}
+
+template <typename F, typename>
+inline thread::thread(deferred_t, F&& entry, size_t stack_size, stack_allocator& allocator, const thread& parent)
+	: m_parent{ &parent }
+	, m_allocator{ &allocator }
+	, m_entry{ std::forward<F>(entry) }
+	, m_stack_size{ stack_size }
+	, m_deferred{ true }
+{
+}
+
+template <typename F, typename>
+inline thread thread::try_create(std::error_code& error, F&& entry, size_t stack_size, const thread& parent)
+{
+	thread result(parent, stack_size);
+	result.m_entry = entry_storage(std::forward<F>(entry));
+	if (!result.try_setup())
+	{
+		result.m_entry = entry_storage();
+		error = make_error_code(errc::create_failure);
+		return result;
+	}
+	error.clear();
+	return result;
+}
+
+template <typename F, typename>
+inline thread thread::try_create(std::error_code& error, F&& entry, size_t stack_size, stack_allocator& allocator,
+	const thread& parent)
+{
+	thread result(parent, stack_size);
+	result.m_allocator = &allocator;
+	result.m_entry = entry_storage(std::forward<F>(entry));
+	if (!result.try_setup())
+	{
+		result.m_entry = entry_storage();
+		error = make_error_code(errc::create_failure);
+		return result;
+	}
+	error.clear();
+	return result;
+}
+
+inline void thread::setup() const
+{
+	if (!try_setup())
+	{
+		CPPCO_THROW(thread_create_failure());
+	}
+}
+
+inline void thread::setup_eager()
+{
+	if (!m_deferred)
+	{
+		setup();
+	}
+}
+
+void thread::setup_deferred() const
+{
+	// Only a deferred `co::thread` with an entry functor may be switched to without a cothread.
+	assert(m_deferred && m_entry);
+	setup();
+}
+
+inline bool thread::try_setup() const noexcept
+{
+	if (!m_thread)
+	{
+		auto cothread = cothread_t{};
+		if (m_allocator != nullptr)
+		{
+			cothread = m_allocator->allocate(m_stack_size, &entry_wrapper);
+		}
+		else
+		{
+			cothread = create_cothread(m_stack_size, &entry_wrapper);
+		}
+		m_thread = thread_ptr(cothread, thread_deleter(m_allocator, m_stack_size));
+		if (m_thread)
+		{
+			CPPCO_TRACE_EVENT(create, cothread, nullptr);
+		}
+#ifdef CPPCO_LIBCO_INTEROP
+		// A deferred `co::thread` is set up from the `const` switch functions.
+		thread_status::get_registry().insert(get_thread(), const_cast<thread*>(this));
+#endif // CPPCO_LIBCO_INTEROP
+	}
+	if (m_thread == nullptr)
+	{
+		status().current_thread = nullptr;
+		return false;
+	}
+	return true;
+}
+
+inline cothread_t thread::create_cothread(size_t stack_size, void (*entry)()) noexcept
+{
+	auto int_stack_size = static_cast<unsigned int>(stack_size);
+#ifdef CPPCO_STACK_WATERMARK
+	// `co_create` hides where the stack is, so the cothread is derived from memory that is painted first.
+	auto* memory = std::malloc(int_stack_size);
+	if (memory == nullptr)
+	{
+		return nullptr;
+	}
+	paint_stack(memory, int_stack_size);
+	auto cothread = co_derive(memory, int_stack_size, entry);
+	if (cothread != memory)
+	{
+		// `delete_cothread` frees the memory from the address of the cothread.
+		assert(cothread == nullptr);
+		std::free(memory);
+		return nullptr;
+	}
+	return cothread;
+#elif defined(CPPCO_FLB_LIBCO) // CPPCO_STACK_WATERMARK
+	size_t real_stack_size;
+	return co_create(int_stack_size, entry, &real_stack_size);
+#else // CPPCO_FLB_LIBCO
+	return co_create(int_stack_size, entry);
+#endif // CPPCO_STACK_WATERMARK
+}
+
+inline void thread::delete_cothread(cothread_t cothread) noexcept
+{
+#ifdef CPPCO_STACK_WATERMARK
+	std::free(cothread);
+#else // CPPCO_STACK_WATERMARK
+	co_delete(cothread);
+#endif // CPPCO_STACK_WATERMARK
+}
+
+#ifdef CPPCO_STACK_WATERMARK
+namespace detail {
+
+/// The pattern painted on the stacks, one word at a time.
+constexpr std::uint64_t stack_paint = 0xC0DEC0DEC0DEC0DEull;
+/// The number of painted words that mark the beginning of the unused part of a stack. The contexts that `co_derive`
+/// puts at the bottom of a stack have gaps that it never writes to, e.g. the floating point area of a `ucontext_t`, so
+/// the run is longer than those.
+constexpr size_t stack_paint_run = 1024 / sizeof(std::uint64_t);
+
+struct stack_usage_registry
+{
+	std::mutex mutex;
+	std::map<size_t, stack_usage> usage;
+
+	static stack_usage_registry& instance()
+	{
+		static stack_usage_registry registry;
+		return registry;
+	}
+};
+
+} // namespace detail
+
+inline void paint_stack(void* memory, size_t size) noexcept
+{
+	auto* words = static_cast<std::uint64_t*>(memory);
+	std::fill(words, words + size / sizeof(std::uint64_t), detail::stack_paint);
+}
+
+inline size_t stack_high_water(cothread_t cothread, size_t stack_size) noexcept
+{
+	// The stack grows down towards the cothread. Its bottom holds the context of the cothread, which is skipped by
+	// looking for the first run of painted words. The first word above the run that was written to is the deepest
+	// point the stack reached.
+	const auto* words = static_cast<const std::uint64_t*>(cothread);
+	auto count = stack_size / sizeof(std::uint64_t);
+	auto run = size_t{ 0 };
+	auto i = size_t{ 0 };
+	for (; i < count && run < detail::stack_paint_run; ++i)
+	{
+		run = words[i] == detail::stack_paint ? run + 1 : 0;
+	}
+	if (run < detail::stack_paint_run)
+	{
+		return stack_size;
+	}
+	while (i < count && words[i] == detail::stack_paint)
+	{
+		++i;
+	}
+	return stack_size - i * sizeof(std::uint64_t);
+}
+
+inline std::vector<stack_usage> stack_usage_report()
+{
+	auto&& registry = detail::stack_usage_registry::instance();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	auto report = std::vector<stack_usage>();
+	report.reserve(registry.usage.size());
+	for (auto&& entry : registry.usage)
+	{
+		report.push_back(entry.second);
+	}
+	return report;
+}
+
+inline void reset_stack_usage_report() noexcept
+{
+	auto&& registry = detail::stack_usage_registry::instance();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	registry.usage.clear();
+}
+
+inline void thread::record_stack_usage(cothread_t cothread, size_t stack_size) noexcept
+{
+	if (stack_size == 0)
+	{
+		// The main cothread and the external ones have no stack of their own.
+		return;
+	}
+	auto high_water = co::stack_high_water(cothread, stack_size);
+	auto&& registry = detail::stack_usage_registry::instance();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	CPPCO_TRY
+	{
+		auto&& usage = registry.usage[stack_size];
+		usage.stack_size = stack_size;
+		++usage.samples;
+		usage.max_high_water = std::max(usage.max_high_water, high_water);
+		usage.total_high_water += high_water;
+	}
+	CPPCO_CATCH(const std::bad_alloc&)
+	{
+		// The sample is dropped, the report is only a measurement.
+	}
+}
+
+inline size_t thread::stack_high_water() const noexcept
+{
+	if (!m_thread || m_stack_size == 0)
+	{
+		return 0;
+	}
+	return co::stack_high_water(get_thread(), m_stack_size);
+}
+#endif // CPPCO_STACK_WATERMARK
+
+#ifdef CPPCO_STATS
+namespace detail {
+
+struct stats_registry
+{
+	std::mutex mutex;
+	thread_accounting* head = nullptr;
+	/// The reference point that converts the ticks to nanoseconds.
+	std::uint64_t start_ticks = stats_ticks();
+	std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+	static stats_registry& instance()
+	{
+		static stats_registry registry;
+		return registry;
+	}
+};
+
+inline std::uint64_t stats_ticks() noexcept
+{
+#ifdef CPPCO_STATS_TSC
+	return __rdtsc();
+#else // CPPCO_STATS_TSC
+	auto time = std::chrono::steady_clock::now().time_since_epoch();
+	return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count());
+#endif // CPPCO_STATS_TSC
+}
+
+inline std::chrono::nanoseconds stats_duration(std::uint64_t ticks) noexcept
+{
+#ifdef CPPCO_STATS_TSC
+	// The frequency of the time stamp counter is measured against `std::chrono::steady_clock` since the first
+	// `co::thread` was constructed, so it gets more precise the longer the process runs.
+	auto&& registry = stats_registry::instance();
+	auto elapsed_ticks = stats_ticks() - registry.start_ticks;
+	auto elapsed_time = std::chrono::steady_clock::now() - registry.start_time;
+	auto elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed_time).count();
+	if (elapsed_ticks == 0 || elapsed_ns <= 0)
+	{
+		return std::chrono::nanoseconds(0);
+	}
+	auto ns = static_cast<double>(ticks) * static_cast<double>(elapsed_ns) / static_cast<double>(elapsed_ticks);
+	return std::chrono::nanoseconds(static_cast<std::chrono::nanoseconds::rep>(ns));
+#else // CPPCO_STATS_TSC
+	return std::chrono::nanoseconds(static_cast<std::chrono::nanoseconds::rep>(ticks));
+#endif // CPPCO_STATS_TSC
+}
+
+inline thread_accounting::thread_accounting(const thread* owner) noexcept
+	: m_owner{ owner }
+	, m_previous{ nullptr }
+	, m_next{ nullptr }
+	, m_run_ticks{ 0 }
+	, m_switches{ 0 }
+	, m_longest_ticks{ 0 }
+{
+	auto&& registry = stats_registry::instance();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	m_next = registry.head;
+	if (m_next != nullptr)
+	{
+		m_next->m_previous = this;
+	}
+	registry.head = this;
+}
+
+inline thread_accounting::~thread_accounting()
+{
+	auto&& registry = stats_registry::instance();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	(m_previous == nullptr ? registry.head : m_previous->m_next) = m_next;
+	if (m_next != nullptr)
+	{
+		m_next->m_previous = m_previous;
+	}
+}
+
+inline void thread_accounting::add_slice(std::uint64_t ticks) noexcept
+{
+	static_assert(CPPCO_STATS_SAMPLE_PERIOD >= 1, "CPPCO_STATS_SAMPLE_PERIOD has to be at least 1");
+	// Only the OS thread running the `co::thread` writes, so there is no need for read-modify-write operations.
+	m_run_ticks.store(m_run_ticks.load(std::memory_order_relaxed) + ticks * CPPCO_STATS_SAMPLE_PERIOD,
+		std::memory_order_relaxed);
+	if (ticks > m_longest_ticks.load(std::memory_order_relaxed))
+	{
+		m_longest_ticks.store(ticks, std::memory_order_relaxed);
+	}
+}
+
+inline void thread_accounting::add_switch() noexcept
+{
+	m_switches.store(m_switches.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+inline void thread_accounting::take(thread_accounting& other) noexcept
+{
+	m_run_ticks.store(other.m_run_ticks.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+	m_switches.store(other.m_switches.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+	m_longest_ticks.store(other.m_longest_ticks.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+inline thread_stats thread_accounting::get() const noexcept
+{
+	thread_stats stats;
+	stats.run_time = stats_duration(m_run_ticks.load(std::memory_order_relaxed));
+	stats.switches = m_switches.load(std::memory_order_relaxed);
+	stats.longest_slice = stats_duration(m_longest_ticks.load(std::memory_order_relaxed));
+	return stats;
+}
+
+} // namespace detail
+
+inline std::vector<thread_stats_entry> stats_snapshot()
+{
+	auto&& registry = detail::stats_registry::instance();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	auto snapshot = std::vector<thread_stats_entry>();
+	for (auto* accounting = registry.head; accounting != nullptr; accounting = accounting->m_next)
+	{
+		thread_stats_entry entry;
+		entry.owner = accounting->m_owner;
+		entry.stats = accounting->get();
+		snapshot.push_back(entry);
+	}
+	return snapshot;
+}
+
+inline thread_stats thread::stats() const noexcept
+{
+	return m_accounting.get();
+}
+#endif // CPPCO_STATS
+
+inline thread::operator bool() const noexcept
+{
+	return static_cast<bool>(m_active);
+}
+
+inline void thread::entry_wrapper() noexcept
+{
+	while (true) // Reuse
+	{
+		co::active().m_active = true;
+		auto failed = false;
+#ifdef CPPCO_NO_EXCEPTIONS
+		entry_storage::run();
+		// Handling entry function return, unless a cooperative entry function returned because it was stopped.
+		if (thread::status().current_thread == nullptr)
+		{
+			thread::status().current_failure = true;
+			failed = true;
+		}
+#else // CPPCO_NO_EXCEPTIONS
 		try
 		{
-			(*co::active().m_entry)();
-			// Handling entry function return
-			throw thread_return_failure();
+			entry_storage::run();
+			// Handling entry function return, unless a cooperative entry function returned because it was stopped.
+			if (thread::status().current_thread == nullptr)
+			{
+				throw thread_return_failure();
+			}
 		}
 		catch (const thread_stopping&)
 		{
-			assert(status().current_thread != nullptr);
-			auto&& stopping_thread = *std::exchange(status().current_thread, nullptr);
-			co::active().m_active = false;
-			status().current_active = &stopping_thread;
-			co_switch(stopping_thread.get_thread()); // Stop
 		}
 		catch (...)
 		{
-			assert(status().current_exception == nullptr);
-			status().current_exception = std::current_exception();
-			co::active().m_active = false;
-			status().current_active = co::active().m_parent;
-			co_switch(status().current_active->get_thread()); // Failure
+			auto&& status = thread::status();
+			// Exceptions escaping a cooperative entry function while it is being stopped are dropped.
+			if (status.current_thread == nullptr)
+			{
+				assert(status.current_exception == nullptr);
+				status.current_exception = std::current_exception();
+				failed = true;
+			}
+		}
+#endif // CPPCO_NO_EXCEPTIONS
+		// Switch away only after the handlers have finished, so no exception is left in flight on this stack.
+		auto&& status = thread::status();
+		auto&& finished_thread = co::active();
+		finished_thread.m_active = false;
+		if (failed)
+		{
+#ifdef CPPCO_STATS
+			account_switch(status, *finished_thread.m_parent);
+#endif // CPPCO_STATS
+			status.current_active = finished_thread.m_parent;
+			CPPCO_TRACE_EVENT(failure, finished_thread.get_thread(), status.current_active->get_thread());
+			co_switch(status.current_active->get_thread()); // Failure
+		}
+		else
+		{
+			assert(status.current_thread != nullptr);
+#ifdef CPPCO_STATS
+			account_switch(status, *status.current_thread);
+#endif // CPPCO_STATS
+			status.current_active = std::exchange(status.current_thread, nullptr);
+			CPPCO_TRACE_EVENT(switch_to, finished_thread.get_thread(), status.current_active->get_thread());
+			co_switch(status.current_active->get_thread()); // Stop
 		}
 	}
 }
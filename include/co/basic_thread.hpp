@@ -0,0 +1,148 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+/// \file basic_thread.hpp
+/// `co::thread`s whose features are chosen at compile time by a policy type.
+///
+/// The compile options of `co.hpp` apply to every `co::thread` in the program. A `co::basic_thread` wraps a `co::thread`
+/// that its policy sets up before any cothread is created, so the settings of the cothreads of one type are fixed in
+/// one place, while they still switch to and from any other `co::thread`, e.g. their parent. A `co::basic_thread`
+/// switches exactly like a `co::thread`, no policy makes switching faster.
+///
+/// The options of `co.hpp` that change how every cothread is tracked or switched, like `CPPCO_LIBCO_INTEROP`, cannot be
+/// chosen by a policy, as `co::active()` and all other modules work with the same `co::thread` type.
+
+#ifndef CO_BASIC_THREAD_HPP_INCLUDE_GUARD
+#define CO_BASIC_THREAD_HPP_INCLUDE_GUARD
+
+#include "../co.hpp"
+#include <cstddef>
+#include <type_traits>
+
+namespace co {
+
+/// `co::default_thread_policy` is the policy with the behavior of a plain `co::thread`.
+///
+/// Policies derive from it and hide the members they change.
+struct default_thread_policy
+{
+	/// Whether entry functors that do not fit `co::thread::inline_entry_size` may be allocated on the heap. If it is
+	/// `false`, such entry functors are rejected at compile time.
+	static constexpr bool heap_entry = true;
+	/// The `co::stop_mode` the cothreads are stopped with.
+	static constexpr stop_mode stop = default_stop_mode;
+	/// Whether the cothreads are created on the first switch, see `co::thread::set_deferred()`.
+	static constexpr bool deferred = false;
+	/// The default stack size.
+	static constexpr size_t stack_size = thread::default_stack_size;
+
+	/// Gets the `co::stack_allocator` of the cothreads.
+	///
+	/// \return The allocator, or `nullptr` to call `co_create` and `co_delete` directly.
+	static stack_allocator* allocator() noexcept
+	{
+		return nullptr;
+	}
+};
+
+/// `co::basic_thread<Policy>` is a `co::thread` set up by `Policy`.
+///
+/// It has the members of `co::thread`, and the settings of the policy can still be changed at run time through them,
+/// except for `heap_entry`. The `co::thread` is not a public base, so it cannot be moved out or reset past the policy.
+/// `get()` gives access to it for everything that takes a `const co::thread&`, like being the parent of a cothread.
+template <typename Policy>
+class basic_thread : private thread
+{
+public:
+	using policy_type = Policy;
+
+	using thread::entry_t;
+	using thread::is_entry;
+	using thread::inline_entry_size;
+	using thread::is_inline_entry;
+	using thread::default_stack_size;
+
+	/// Constructs an empty `co::basic_thread`.
+	///
+	/// \param stack_size  The stack size. Defaults to `Policy::stack_size`.
+	/// \param parent      The explicitly specified parent. Defaults to the calling `co::thread`.
+	explicit basic_thread(size_t stack_size = Policy::stack_size, const thread& parent = active());
+
+	/// Constructs a `co::basic_thread` with `entry` as its entry functor.
+	///
+	/// \param entry       The entry functor that will begin execution when the `co::basic_thread` starts running.
+	/// \param stack_size  The stack size. Defaults to `Policy::stack_size`.
+	/// \param parent      The explicitly specified parent. Defaults to the calling `co::thread`.
+	template <typename F, typename = typename std::enable_if<is_entry<typename std::decay<F>::type>::value>::type>
+	explicit basic_thread(F&& entry, size_t stack_size = Policy::stack_size, const thread& parent = active());
+
+	using thread::operator bool;
+	using thread::switch_to;
+#ifndef CPPCO_NO_EXCEPTIONS
+	using thread::throw_to;
+#else // CPPCO_NO_EXCEPTIONS
+	using thread::try_switch_to;
+#endif // CPPCO_NO_EXCEPTIONS
+	using thread::switch_to_fast;
+	using thread::rewind;
+	using thread::get_stack_size;
+	using thread::set_stack_size;
+#ifdef CPPCO_STACK_WATERMARK
+	using thread::stack_high_water;
+#endif // CPPCO_STACK_WATERMARK
+#ifdef CPPCO_STATS
+	using thread::stats;
+#endif // CPPCO_STATS
+	using thread::get_stop_mode;
+	using thread::set_stop_mode;
+	using thread::stop_requested;
+	using thread::is_deferred;
+	using thread::set_deferred;
+	using thread::get_allocator;
+	using thread::set_allocator;
+	using thread::get_parent;
+	using thread::set_parent;
+	using thread::reset;
+
+	/// Gets the `co::thread` of this `co::basic_thread`.
+	///
+	/// \return The `co::thread`. It is the one `co::active()` returns while this `co::basic_thread` is running.
+	const thread& get() const noexcept;
+
+	/// Sets a new entry functor.
+	///
+	/// Also stops the previous entry functor and destroys the `co::local` values of this `co::basic_thread`.
+	///
+	/// \param entry  The new entry functor. It has to be stored inline unless `Policy::heap_entry` is `true`.
+	template <typename F, typename = typename std::enable_if<is_entry<typename std::decay<F>::type>::value>::type>
+	void reset(F&& entry);
+
+	/// Move constructor.
+	basic_thread(basic_thread&& other) noexcept = default;
+	/// Move assignment operator.
+	basic_thread& operator=(basic_thread&& other) noexcept = default;
+
+	basic_thread(const basic_thread& other) = delete;
+	basic_thread& operator=(const basic_thread& other) = delete;
+
+private:
+	void apply_policy() noexcept;
+};
+
+} // namespace co
+
+#include "basic_thread.ipp"
+
+#endif // CO_BASIC_THREAD_HPP_INCLUDE_GUARD
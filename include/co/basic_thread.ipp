@@ -0,0 +1,68 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+
+#ifndef CO_BASIC_THREAD_IPP_INCLUDE_GUARD
+#define CO_BASIC_THREAD_IPP_INCLUDE_GUARD
+
+#include <utility>
+
+namespace co {
+
+template <typename Policy>
+inline basic_thread<Policy>::basic_thread(size_t stack_size, const thread& parent)
+	: thread(parent, stack_size)
+{
+	apply_policy();
+}
+
+template <typename Policy>
+template <typename F, typename>
+inline basic_thread<Policy>::basic_thread(F&& entry, size_t stack_size, const thread& parent)
+	: thread(std::forward<F>(entry), stack_size, parent, private_token)
+{
+	static_assert(Policy::heap_entry || is_inline_entry<typename std::decay<F>::type>::value,
+		"co::basic_thread: the policy does not allow entry functors on the heap");
+	apply_policy();
+	setup_eager();
+}
+
+template <typename Policy>
+template <typename F, typename>
+inline void basic_thread<Policy>::reset(F&& entry)
+{
+	static_assert(Policy::heap_entry || is_inline_entry<typename std::decay<F>::type>::value,
+		"co::basic_thread: the policy does not allow entry functors on the heap");
+	thread::reset(std::forward<F>(entry));
+}
+
+template <typename Policy>
+inline const thread& basic_thread<Policy>::get() const noexcept
+{
+	return *this;
+}
+
+template <typename Policy>
+inline void basic_thread<Policy>::apply_policy() noexcept
+{
+	// No cothread exists yet, so the settings apply to the first one.
+	set_allocator(Policy::allocator());
+	set_stop_mode(Policy::stop);
+	set_deferred(Policy::deferred);
+}
+
+} // namespace co
+
+#endif // CO_BASIC_THREAD_IPP_INCLUDE_GUARD
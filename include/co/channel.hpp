@@ -0,0 +1,120 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+/// \file channel.hpp
+/// A bounded channel between two cothreads.
+///
+/// A `co::channel` passes values from a sending cothread to a receiving one. It only switches between them when the
+/// sender finds the buffer full or the receiver finds it empty, so a buffer of `n` values costs two switches per `n`
+/// values instead of two per value.
+
+#ifndef CO_CHANNEL_HPP_INCLUDE_GUARD
+#define CO_CHANNEL_HPP_INCLUDE_GUARD
+
+#include "../co.hpp"
+#include <memory>
+#include <type_traits>
+
+#ifdef CPPCO_NO_EXCEPTIONS
+#error "co::channel requires exceptions, it cannot be used with CPPCO_NO_EXCEPTIONS"
+#endif // CPPCO_NO_EXCEPTIONS
+
+namespace co {
+
+/// `co::channel<T>` is a fixed capacity ring buffer of `T` between a sender and a receiver cothread.
+///
+/// A blocked end switches to the other end: the cothread that last used it, or the one set by `set_sender()` or
+/// `set_receiver()`. If the other end is not known yet, it switches to its parent. A resumed end checks its condition
+/// again, so it is safe to resume it for an unrelated reason.
+///
+/// A channel with a capacity of `0` is unbuffered: `send()` hands the value over directly and returns once the receiver
+/// has taken it.
+///
+/// Both ends have to run on the OS thread that created the channel.
+template <typename T>
+class channel
+{
+public:
+	using value_type = T;
+
+	/// Constructs a channel.
+	///
+	/// \param capacity  The number of values buffered before the sender blocks. It is rounded up to a power of two.
+	///                  `0` selects an unbuffered channel.
+	explicit channel(size_t capacity);
+	/// Destroys the values that were not received.
+	~channel();
+
+	channel(const channel& other) = delete;
+	channel& operator=(const channel& other) = delete;
+
+	/// Sets the cothread that blocked receives switch to until the sender has used the channel.
+	void set_sender(const thread& sender) noexcept;
+	/// Sets the cothread that blocked sends switch to until the receiver has used the channel.
+	void set_receiver(const thread& receiver) noexcept;
+
+	/// Sends a value, blocking while the buffer is full.
+	void send(const T& value);
+	/// Sends a value, blocking while the buffer is full.
+	void send(T&& value);
+	/// Sends `count` values, blocking each time the buffer fills up.
+	void send_batch(const T* values, size_t count);
+	/// Ends the sequence. The receiver gets the values that are still buffered, then `recv()` returns `false`.
+	void close() noexcept;
+
+	/// Receives a value, blocking while the buffer is empty.
+	///
+	/// \return `true` if a value was received, `false` if the channel is closed and empty.
+	bool recv(T& value);
+	/// Receives the buffered values, up to `max_count`, blocking only while the buffer is empty.
+	///
+	/// \return The number of values received, `0` only if the channel is closed and empty.
+	size_t recv_batch(T* values, size_t max_count);
+
+	/// Gets the number of values the buffer holds.
+	size_t get_capacity() const noexcept;
+	/// Gets the number of buffered values.
+	size_t size() const noexcept;
+	/// Checks whether `close()` was called.
+	bool closed() const noexcept;
+
+private:
+	using slot = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+	template <typename U>
+	void push(U&& value);
+	void hand_over(T& value);
+	T* front() noexcept;
+	void pop() noexcept;
+
+	static const thread& other_end(const thread* end) noexcept;
+	bool full() const noexcept;
+
+	std::unique_ptr<slot[]> m_buffer;
+	size_t m_mask;
+	size_t m_head = 0;
+	size_t m_tail = 0;
+	/// The value offered by `send()` on an unbuffered channel.
+	T* m_offer = nullptr;
+	const thread* m_sender = nullptr;
+	const thread* m_receiver = nullptr;
+	bool m_closed = false;
+};
+
+} // namespace co
+
+#include "channel.ipp"
+
+#endif // CO_CHANNEL_HPP_INCLUDE_GUARD
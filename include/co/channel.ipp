@@ -0,0 +1,247 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+#ifndef CO_CHANNEL_IPP_INCLUDE_GUARD
+#define CO_CHANNEL_IPP_INCLUDE_GUARD
+
+#include <cassert>
+#include <new>
+#include <utility>
+
+namespace co {
+
+template <typename T>
+inline channel<T>::channel(size_t capacity)
+	: m_mask{ 0 }
+{
+	if (capacity > 0)
+	{
+		auto rounded = size_t{ 1 };
+		while (rounded < capacity)
+		{
+			rounded *= 2;
+		}
+		m_buffer.reset(new slot[rounded]);
+		m_mask = rounded - 1;
+	}
+}
+
+template <typename T>
+inline channel<T>::~channel()
+{
+	while (m_head != m_tail)
+	{
+		pop();
+	}
+}
+
+template <typename T>
+inline void channel<T>::set_sender(const thread& sender) noexcept
+{
+	m_sender = &sender;
+}
+
+template <typename T>
+inline void channel<T>::set_receiver(const thread& receiver) noexcept
+{
+	m_receiver = &receiver;
+}
+
+template <typename T>
+inline void channel<T>::send(const T& value)
+{
+	assert(!m_closed);
+	m_sender = &active();
+	if (m_buffer == nullptr)
+	{
+		auto copy = T(value);
+		hand_over(copy);
+		return;
+	}
+	push(value);
+}
+
+template <typename T>
+inline void channel<T>::send(T&& value)
+{
+	assert(!m_closed);
+	m_sender = &active();
+	if (m_buffer == nullptr)
+	{
+		hand_over(value);
+		return;
+	}
+	push(std::move(value));
+}
+
+template <typename T>
+inline void channel<T>::send_batch(const T* values, size_t count)
+{
+	assert(!m_closed);
+	m_sender = &active();
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (m_buffer == nullptr)
+		{
+			auto copy = T(values[i]);
+			hand_over(copy);
+		}
+		else
+		{
+			push(values[i]);
+		}
+	}
+}
+
+template <typename T>
+inline void channel<T>::close() noexcept
+{
+	m_closed = true;
+}
+
+template <typename T>
+inline bool channel<T>::recv(T& value)
+{
+	return recv_batch(&value, 1) == 1;
+}
+
+template <typename T>
+inline size_t channel<T>::recv_batch(T* values, size_t max_count)
+{
+	m_receiver = &active();
+	if (max_count == 0)
+	{
+		return 0;
+	}
+	if (m_buffer == nullptr)
+	{
+		while (m_offer == nullptr)
+		{
+			if (m_closed)
+			{
+				return 0;
+			}
+			other_end(m_sender).switch_to();
+		}
+		values[0] = std::move(*m_offer);
+		m_offer = nullptr;
+		return 1;
+	}
+	while (m_head == m_tail)
+	{
+		if (m_closed)
+		{
+			return 0;
+		}
+		other_end(m_sender).switch_to();
+	}
+	auto count = size_t{ 0 };
+	while (count < max_count && m_head != m_tail)
+	{
+		values[count++] = std::move(*front());
+		pop();
+	}
+	return count;
+}
+
+template <typename T>
+inline size_t channel<T>::get_capacity() const noexcept
+{
+	return m_buffer == nullptr ? 0 : m_mask + 1;
+}
+
+template <typename T>
+inline size_t channel<T>::size() const noexcept
+{
+	return m_tail - m_head;
+}
+
+template <typename T>
+inline bool channel<T>::closed() const noexcept
+{
+	return m_closed;
+}
+
+template <typename T>
+template <typename U>
+inline void channel<T>::push(U&& value)
+{
+	while (full())
+	{
+		other_end(m_receiver).switch_to();
+	}
+	new (&m_buffer[m_tail & m_mask]) T(std::forward<U>(value));
+	++m_tail;
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 12
+#pragma GCC diagnostic push
+// The offered value lives on the stack of the sender, which waits here until the receiver took it.
+#pragma GCC diagnostic ignored "-Wdangling-pointer"
+#endif // GCC 12
+template <typename T>
+inline void channel<T>::hand_over(T& value)
+{
+	// The receiver moves the value straight from the sender's stack, nothing is buffered.
+	m_offer = &value;
+	try
+	{
+		while (m_offer != nullptr)
+		{
+			other_end(m_receiver).switch_to();
+		}
+	}
+	catch (...)
+	{
+		m_offer = nullptr;
+		throw;
+	}
+}
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 12
+#pragma GCC diagnostic pop
+#endif // GCC 12
+
+template <typename T>
+inline T* channel<T>::front() noexcept
+{
+	return reinterpret_cast<T*>(&m_buffer[m_head & m_mask]);
+}
+
+template <typename T>
+inline void channel<T>::pop() noexcept
+{
+	front()->~T();
+	++m_head;
+}
+
+template <typename T>
+inline const thread& channel<T>::other_end(const thread* end) noexcept
+{
+	if (end != nullptr)
+	{
+		return *end;
+	}
+	return active().get_parent();
+}
+
+template <typename T>
+inline bool channel<T>::full() const noexcept
+{
+	return m_tail - m_head > m_mask;
+}
+
+} // namespace co
+
+#endif // CO_CHANNEL_IPP_INCLUDE_GUARD
@@ -0,0 +1,172 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+/// \file executor.hpp
+/// A work stealing executor that runs `co::thread`s on a pool of OS threads.
+///
+/// Tasks of a `co::executor` migrate between OS threads, so everything that includes this header has to be compiled
+/// with `CPPCO_THREAD_MIGRATION` defined.
+
+#ifndef CO_EXECUTOR_HPP_INCLUDE_GUARD
+#define CO_EXECUTOR_HPP_INCLUDE_GUARD
+
+#ifndef CPPCO_THREAD_MIGRATION
+#error "co::executor requires CPPCO_THREAD_MIGRATION to be defined"
+#endif // CPPCO_THREAD_MIGRATION
+
+#include "../co.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#ifdef CPPCO_NO_EXCEPTIONS
+#error "co::executor requires exceptions, it cannot be used with CPPCO_NO_EXCEPTIONS"
+#endif // CPPCO_NO_EXCEPTIONS
+
+namespace co {
+
+/// `co::executor` runs tasks on one worker OS thread per core.
+///
+/// Each worker has its own run queue. A worker runs the tasks of its own queue in FIFO order, and once that is empty
+/// it steals a task from the back of the queue of another worker. A task that calls `co::executor::yield()` goes to
+/// the back of the queue of the worker it ran on, so it may be resumed by another worker. The parent of a task is
+/// always the main cothread of the worker that runs it, so failures propagate to that worker, and the first one is
+/// rethrown by `wait()`.
+///
+/// A task is only put in a run queue after it has switched away, so a task never runs on two OS threads at once.
+class executor
+{
+	struct task;
+	struct worker;
+
+public:
+	/// Finished tasks a worker keeps for reuse by `spawn()` calls from its own tasks.
+	static constexpr size_t max_cached_tasks = 256;
+
+	/// Starts the workers.
+	///
+	/// \param workers     The number of worker OS threads. `0` selects `std::thread::hardware_concurrency()`.
+	/// \param stack_size  The stack size of the tasks.
+	explicit executor(size_t workers = 0, size_t stack_size = thread::default_stack_size);
+	/// Waits for every task to finish, then stops the workers. Failures that were not collected by `wait()` are
+	/// discarded.
+	~executor();
+
+	executor(const executor& other) = delete;
+	executor& operator=(const executor& other) = delete;
+
+	/// Creates a runnable task. It can be called from any OS thread.
+	///
+	/// Called from a task the new task goes to the queue of the calling worker, otherwise the workers get the new tasks
+	/// in turn.
+	///
+	/// \param entry  The entry functor of the task. The task finishes when it returns.
+	/// \throw co::thread_create_failure if the cothread of the task could not be created.
+	/// \throw std::bad_alloc if the task could not be queued.
+	template <typename F, typename = typename std::enable_if<thread::is_entry<typename std::decay<F>::type>::value>::type>
+	void spawn(F&& entry);
+
+	/// Blocks the calling OS thread until every task has finished.
+	///
+	/// It may not be called from a task of this executor.
+	///
+	/// \throw The exception of the first task that failed since the last call, if any.
+	void wait();
+
+	/// Gets the number of worker OS threads.
+	size_t get_worker_count() const noexcept;
+
+	/// Gives up the worker to the other runnable tasks. The active task may resume on another worker.
+	///
+	/// It may only be called from a task of a `co::executor`.
+	static void yield();
+
+	/// Gets the executor whose task is active on the calling OS thread.
+	///
+	/// \return The executor, or `nullptr` if the calling OS thread is not a worker.
+	static executor* current() noexcept;
+
+private:
+	template <typename F>
+	struct task_entry;
+
+	/// Does nothing. It replaces the entry functor of a finished task to release the captures of its entry functor.
+	struct idle_entry
+	{
+		void operator()() const noexcept {}
+	};
+
+	static worker*& current_worker() noexcept;
+
+	task* acquire();
+	void enqueue(task* t);
+	void notify() noexcept;
+	task* dequeue(worker& self) noexcept;
+	void run(worker& self) noexcept;
+	void execute(worker& self, task* t) noexcept;
+	void retire(worker& self, task* t) noexcept;
+	/// Counts a task as finished and wakes `wait()` when it was the last one.
+	void finish_one() noexcept;
+
+	size_t m_stack_size;
+	std::vector<std::unique_ptr<worker>> m_workers;
+	std::atomic<size_t> m_next_worker{ 0 };
+	std::atomic<size_t> m_queued{ 0 };
+	std::atomic<size_t> m_sleeping{ 0 };
+	std::atomic<size_t> m_pending{ 0 };
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_idle;
+	std::exception_ptr m_failure;
+	bool m_stopping = false;
+};
+
+struct executor::task
+{
+	thread cothread;
+	bool finished = false;
+
+	explicit task(size_t stack_size);
+};
+
+struct executor::worker
+{
+	executor* owner;
+	size_t index;
+	std::mutex mutex;
+	std::deque<task*> queue;
+	std::vector<task*> cache;
+	std::thread os_thread;
+
+	worker(executor& executor, size_t index);
+};
+
+template <typename F>
+struct executor::task_entry
+{
+	task* ptask;
+	F entry;
+
+	void operator()();
+};
+
+} // namespace co
+
+#include "executor.ipp"
+
+#endif // CO_EXECUTOR_HPP_INCLUDE_GUARD
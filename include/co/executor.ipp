@@ -0,0 +1,323 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+#ifndef CO_EXECUTOR_IPP_INCLUDE_GUARD
+#define CO_EXECUTOR_IPP_INCLUDE_GUARD
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace co {
+
+#ifdef __GNUC__
+constexpr size_t executor::max_cached_tasks __attribute__((weak));
+#endif // __GNUC__
+
+inline executor::task::task(size_t stack_size)
+	: cothread{ stack_size }
+{
+}
+
+inline executor::worker::worker(executor& executor, size_t index)
+	: owner{ &executor }
+	, index{ index }
+{
+	cache.reserve(max_cached_tasks);
+}
+
+template <typename F>
+inline void executor::task_entry<F>::operator()()
+{
+	entry();
+	ptask->finished = true;
+	// The worker stops the finished task, which must not unwind the stack with an exception.
+	ptask->cothread.set_stop_mode(stop_mode::cooperative);
+	active().get_parent().switch_to();
+	assert(stop_requested());
+}
+
+inline executor::executor(size_t workers, size_t stack_size)
+	: m_stack_size{ stack_size }
+{
+	if (workers == 0)
+	{
+		workers = std::max<size_t>(1, std::thread::hardware_concurrency());
+	}
+	m_workers.reserve(workers);
+	for (size_t i = 0; i < workers; ++i)
+	{
+		m_workers.push_back(std::unique_ptr<worker>(new worker(*this, i)));
+	}
+	try
+	{
+		for (auto&& w : m_workers)
+		{
+			auto* pworker = w.get();
+			w->os_thread = std::thread([this, pworker]()
+			{
+				run(*pworker);
+			});
+		}
+	}
+	catch (...)
+	{
+		{
+			std::lock_guard<std::mutex> guard(m_mutex);
+			m_stopping = true;
+		}
+		m_wake.notify_all();
+		for (auto&& w : m_workers)
+		{
+			if (w->os_thread.joinable())
+			{
+				w->os_thread.join();
+			}
+		}
+		throw;
+	}
+}
+
+inline executor::~executor()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_idle.wait(lock, [this]()
+		{
+			return m_pending.load() == 0;
+		});
+		m_stopping = true;
+	}
+	m_wake.notify_all();
+	for (auto&& w : m_workers)
+	{
+		w->os_thread.join();
+	}
+}
+
+template <typename F, typename>
+inline void executor::spawn(F&& entry)
+{
+	auto* t = acquire();
+	try
+	{
+		t->cothread.reset(task_entry<typename std::decay<F>::type>{ t, std::forward<F>(entry) });
+	}
+	catch (...)
+	{
+		delete t;
+		throw;
+	}
+	t->finished = false;
+	m_pending.fetch_add(1);
+	try
+	{
+		enqueue(t);
+	}
+	catch (...)
+	{
+		delete t;
+		finish_one();
+		throw;
+	}
+}
+
+inline void executor::wait()
+{
+	assert(current() != this);
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle.wait(lock, [this]()
+	{
+		return m_pending.load() == 0;
+	});
+	if (m_failure != nullptr)
+	{
+		std::rethrow_exception(std::exchange(m_failure, nullptr));
+	}
+}
+
+inline size_t executor::get_worker_count() const noexcept
+{
+	return m_workers.size();
+}
+
+inline void executor::yield()
+{
+	assert(current_worker() != nullptr);
+	// The worker puts the task back into its queue once it has switched away.
+	active().get_parent().switch_to();
+}
+
+inline executor* executor::current() noexcept
+{
+	auto* self = current_worker();
+	return self != nullptr ? self->owner : nullptr;
+}
+
+inline executor::worker*& executor::current_worker() noexcept
+{
+	static thread_local worker* instance = nullptr;
+	return instance;
+}
+
+inline executor::task* executor::acquire()
+{
+	auto* self = current_worker();
+	if (self != nullptr && self->owner == this && !self->cache.empty())
+	{
+		auto* t = self->cache.back();
+		self->cache.pop_back();
+		return t;
+	}
+	return new task(m_stack_size);
+}
+
+inline void executor::enqueue(task* t)
+{
+	auto* self = current_worker();
+	if (self == nullptr || self->owner != this)
+	{
+		self = m_workers[m_next_worker.fetch_add(1, std::memory_order_relaxed) % m_workers.size()].get();
+	}
+	{
+		std::lock_guard<std::mutex> guard(self->mutex);
+		self->queue.push_back(t);
+		m_queued.fetch_add(1);
+	}
+	notify();
+}
+
+inline void executor::notify() noexcept
+{
+	// Pairs with the increment of `m_sleeping` in `run()`: either the sleeper sees the new task, or it is woken here.
+	if (m_sleeping.load() > 0)
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_wake.notify_one();
+	}
+}
+
+inline executor::task* executor::dequeue(worker& self) noexcept
+{
+	{
+		std::lock_guard<std::mutex> guard(self.mutex);
+		if (!self.queue.empty())
+		{
+			auto* t = self.queue.front();
+			self.queue.pop_front();
+			m_queued.fetch_sub(1);
+			return t;
+		}
+	}
+	// Steal from the back, where the tasks that are least likely to run soon on their own worker are.
+	for (size_t i = 1; i < m_workers.size(); ++i)
+	{
+		auto&& victim = *m_workers[(self.index + i) % m_workers.size()];
+		std::lock_guard<std::mutex> guard(victim.mutex);
+		if (!victim.queue.empty())
+		{
+			auto* t = victim.queue.back();
+			victim.queue.pop_back();
+			m_queued.fetch_sub(1);
+			return t;
+		}
+	}
+	return nullptr;
+}
+
+inline void executor::run(worker& self) noexcept
+{
+	current_worker() = &self;
+	while (true)
+	{
+		auto* t = dequeue(self);
+		if (t != nullptr)
+		{
+			execute(self, t);
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (m_stopping)
+		{
+			break;
+		}
+		m_sleeping.fetch_add(1);
+		m_wake.wait(lock, [this]()
+		{
+			return m_queued.load() > 0 || m_stopping;
+		});
+		m_sleeping.fetch_sub(1);
+	}
+	for (auto* t : self.cache)
+	{
+		delete t;
+	}
+	self.cache.clear();
+	current_worker() = nullptr;
+}
+
+inline void executor::execute(worker& self, task* t) noexcept
+{
+	// The task may have run on another worker before, its parent has to be the main cothread of this one.
+	t->cothread.set_parent(active());
+	try
+	{
+		t->cothread.switch_to();
+		if (!t->finished)
+		{
+			// If the task cannot be queued again, then it fails with `std::bad_alloc` as if it threw that.
+			enqueue(t);
+			return;
+		}
+	}
+	catch (...)
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		if (m_failure == nullptr)
+		{
+			m_failure = std::current_exception();
+		}
+	}
+	retire(self, t);
+}
+
+inline void executor::retire(worker& self, task* t) noexcept
+{
+	if (self.cache.size() < max_cached_tasks)
+	{
+		// Stops the task and releases its entry functor. The cothread is kept for the next `spawn()`.
+		t->cothread.reset(idle_entry());
+		t->cothread.set_stop_mode(default_stop_mode);
+		self.cache.push_back(t);
+	}
+	else
+	{
+		delete t;
+	}
+	finish_one();
+}
+
+inline void executor::finish_one() noexcept
+{
+	if (m_pending.fetch_sub(1) == 1)
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_idle.notify_all();
+	}
+}
+
+} // namespace co
+
+#endif // CO_EXECUTOR_IPP_INCLUDE_GUARD
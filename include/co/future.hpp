@@ -0,0 +1,182 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+
+/// \file future.hpp
+/// A single threaded promise and future pair for the result of the work of another cothread.
+///
+/// A cothread that waits for a `co::future` is suspended until the result is set, and it is resumed once when that
+/// happens. Both ends have to be used on the same OS thread, so they share their state without locks or atomics.
+
+#ifndef CO_FUTURE_HPP_INCLUDE_GUARD
+#define CO_FUTURE_HPP_INCLUDE_GUARD
+
+#include "../co.hpp"
+#include "scheduler.hpp"
+#include <exception>
+#include <type_traits>
+
+#ifdef CPPCO_NO_EXCEPTIONS
+#error "co::future requires exceptions, it cannot be used with CPPCO_NO_EXCEPTIONS"
+#endif // CPPCO_NO_EXCEPTIONS
+
+namespace co {
+
+template <typename T>
+class future;
+template <typename T>
+class promise;
+
+/// `co::broken_promise` is the exception of a `co::future` whose `co::promise` was destroyed without a result.
+class broken_promise : public thread_failure
+{
+public:
+	broken_promise() noexcept;
+};
+
+namespace detail {
+
+/// The storage of the value of a `co::future_state<T>`.
+template <typename T>
+class future_value
+{
+public:
+	future_value() noexcept = default;
+	~future_value();
+
+	future_value(const future_value& other) = delete;
+	future_value& operator=(const future_value& other) = delete;
+
+	template <typename... Args>
+	void emplace(Args&&... args);
+	T take();
+
+private:
+	alignas(T) unsigned char m_buffer[sizeof(T)];
+	bool m_constructed = false;
+};
+
+template <>
+class future_value<void>
+{
+public:
+	void emplace() noexcept;
+	void take() noexcept;
+};
+
+/// The state shared by a `co::promise` and its `co::future`. It is reference counted without atomics.
+template <typename T>
+struct future_state
+{
+	future_value<T> value;
+	std::exception_ptr exception;
+	/// The waiting task, if the waiting cothread is a task of a `co::scheduler`.
+	scheduler::handle waiting_task;
+	/// The waiting cothread, if it is not a task of a `co::scheduler`.
+	const thread* waiting_thread = nullptr;
+	unsigned int references = 1;
+	bool ready = false;
+	bool retrieved = false;
+
+	static void release(future_state* state) noexcept;
+};
+
+} // namespace detail
+
+/// `co::future<T>` receives the result of a `co::promise<T>`.
+///
+/// `get()` suspends the calling cothread until the result is set. If the calling cothread is a task of
+/// `co::scheduler::current()`, it is suspended with `co::suspend()` and resumed with `co::resume()`. Otherwise it
+/// switches to its parent, and `co::promise::set_value()` switches back to it directly. Then `set_value()` returns only
+/// once the cothread that set the value is switched to again.
+///
+/// A `co::future` is movable but not copyable, and `get()` can only be called once.
+template <typename T>
+class future
+{
+public:
+	/// Constructs a `co::future` without a shared state.
+	future() noexcept = default;
+	future(future&& other) noexcept;
+	future& operator=(future&& other) noexcept;
+	~future();
+
+	future(const future& other) = delete;
+	future& operator=(const future& other) = delete;
+
+	/// Checks whether this `co::future` has a shared state, that is whether `get()` may be called.
+	bool valid() const noexcept;
+	/// Checks whether the result is set, so `get()` returns without suspending.
+	bool ready() const noexcept;
+
+	/// Waits for the result and takes it. The `co::future` has no shared state afterwards.
+	///
+	/// The main cothread cannot wait without a `co::scheduler`, as it has no parent to switch to.
+	///
+	/// \return The value set by the `co::promise`.
+	/// \throw The exception set by the `co::promise`, or `co::broken_promise`.
+	T get();
+
+private:
+	friend class promise<T>;
+
+	explicit future(detail::future_state<T>* state) noexcept;
+
+	detail::future_state<T>* m_state = nullptr;
+};
+
+/// `co::promise<T>` sets the result of a `co::future<T>`.
+///
+/// Destroying a `co::promise` whose result has not been set sets `co::broken_promise` as its exception. A waiting
+/// task is resumed then, while a waiting cothread that is not a task sees it the next time it is switched to.
+template <typename T>
+class promise
+{
+public:
+	/// Constructs a `co::promise` with a new shared state.
+	promise();
+	promise(promise&& other) noexcept;
+	promise& operator=(promise&& other) noexcept;
+	~promise();
+
+	promise(const promise& other) = delete;
+	promise& operator=(const promise& other) = delete;
+
+	/// Gets the `co::future` of this `co::promise`. It may only be called once.
+	future<T> get_future() noexcept;
+
+	/// Sets the value and resumes the waiting cothread.
+	///
+	/// \param args  The arguments `T` is constructed from. None for `co::promise<void>`.
+	template <typename... Args>
+	void set_value(Args&&... args);
+	/// Sets the exception and resumes the waiting cothread.
+	///
+	/// A waiting cothread that is not a task of a `co::scheduler` gets the exception thrown by `co::thread::throw_to()`.
+	///
+	/// \param exception  The exception that `co::future::get()` throws. It must not be `nullptr`.
+	void set_exception(std::exception_ptr exception);
+
+private:
+	void finish(bool broken);
+
+	detail::future_state<T>* m_state;
+};
+
+} // namespace co
+
+#include "future.ipp"
+
+#endif // CO_FUTURE_HPP_INCLUDE_GUARD
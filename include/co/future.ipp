@@ -0,0 +1,258 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+
+#ifndef CO_FUTURE_IPP_INCLUDE_GUARD
+#define CO_FUTURE_IPP_INCLUDE_GUARD
+
+#include <cassert>
+#include <new>
+#include <utility>
+
+namespace co {
+
+inline broken_promise::broken_promise() noexcept
+	: thread_failure("co::promise destroyed without a result")
+{
+}
+
+namespace detail {
+
+template <typename T>
+inline future_value<T>::~future_value()
+{
+	if (m_constructed)
+	{
+		static_cast<T*>(static_cast<void*>(m_buffer))->~T();
+	}
+}
+
+template <typename T>
+template <typename... Args>
+inline void future_value<T>::emplace(Args&&... args)
+{
+	assert(!m_constructed);
+	::new (static_cast<void*>(m_buffer)) T(std::forward<Args>(args)...);
+	m_constructed = true;
+}
+
+template <typename T>
+inline T future_value<T>::take()
+{
+	assert(m_constructed);
+	return std::move(*static_cast<T*>(static_cast<void*>(m_buffer)));
+}
+
+inline void future_value<void>::emplace() noexcept
+{
+}
+
+inline void future_value<void>::take() noexcept
+{
+}
+
+template <typename T>
+inline void future_state<T>::release(future_state* state) noexcept
+{
+	if (state != nullptr && --state->references == 0)
+	{
+		delete state;
+	}
+}
+
+} // namespace detail
+
+template <typename T>
+inline future<T>::future(detail::future_state<T>* state) noexcept
+	: m_state{ state }
+{
+}
+
+template <typename T>
+inline future<T>::future(future&& other) noexcept
+	: m_state{ std::exchange(other.m_state, nullptr) }
+{
+}
+
+template <typename T>
+inline future<T>& future<T>::operator=(future&& other) noexcept
+{
+	if (this != &other)
+	{
+		detail::future_state<T>::release(std::exchange(m_state, std::exchange(other.m_state, nullptr)));
+	}
+	return *this;
+}
+
+template <typename T>
+inline future<T>::~future()
+{
+	detail::future_state<T>::release(m_state);
+}
+
+template <typename T>
+inline bool future<T>::valid() const noexcept
+{
+	return m_state != nullptr;
+}
+
+template <typename T>
+inline bool future<T>::ready() const noexcept
+{
+	return m_state != nullptr && m_state->ready;
+}
+
+template <typename T>
+inline T future<T>::get()
+{
+	assert(m_state != nullptr);
+	struct state_guard
+	{
+		detail::future_state<T>* state;
+
+		~state_guard()
+		{
+			// The waiting cothread may be stopped while it is suspended, the promise must not resume it then.
+			state->waiting_task = scheduler::handle();
+			state->waiting_thread = nullptr;
+			detail::future_state<T>::release(state);
+		}
+	} guard = { std::exchange(m_state, nullptr) };
+	auto&& state = *guard.state;
+	if (!state.ready)
+	{
+		auto task = active_task();
+		if (task)
+		{
+			state.waiting_task = task;
+			do
+			{
+				suspend();
+			} while (!state.ready);
+		}
+		else
+		{
+			auto&& self = active();
+			assert(&self != &main());
+			state.waiting_thread = &self;
+			auto&& parent = self.get_parent();
+			do
+			{
+				parent.switch_to();
+			} while (!state.ready);
+		}
+	}
+	if (state.exception != nullptr)
+	{
+		std::rethrow_exception(state.exception);
+	}
+	return state.value.take();
+}
+
+template <typename T>
+inline promise<T>::promise()
+	: m_state{ new detail::future_state<T>() }
+{
+}
+
+template <typename T>
+inline promise<T>::promise(promise&& other) noexcept
+	: m_state{ std::exchange(other.m_state, nullptr) }
+{
+}
+
+template <typename T>
+inline promise<T>& promise<T>::operator=(promise&& other) noexcept
+{
+	if (this != &other)
+	{
+		// The previous state is broken by the destructor of `discarded`.
+		promise discarded(std::move(*this));
+		m_state = std::exchange(other.m_state, nullptr);
+	}
+	return *this;
+}
+
+template <typename T>
+inline promise<T>::~promise()
+{
+	if (m_state != nullptr && !m_state->ready)
+	{
+		m_state->exception = std::make_exception_ptr(broken_promise());
+		finish(true);
+	}
+	detail::future_state<T>::release(m_state);
+}
+
+template <typename T>
+inline future<T> promise<T>::get_future() noexcept
+{
+	assert(m_state != nullptr);
+	assert(!m_state->retrieved);
+	m_state->retrieved = true;
+	++m_state->references;
+	return future<T>(m_state);
+}
+
+template <typename T>
+template <typename... Args>
+inline void promise<T>::set_value(Args&&... args)
+{
+	assert(m_state != nullptr);
+	assert(!m_state->ready);
+	m_state->value.emplace(std::forward<Args>(args)...);
+	finish(false);
+}
+
+template <typename T>
+inline void promise<T>::set_exception(std::exception_ptr exception)
+{
+	assert(m_state != nullptr);
+	assert(!m_state->ready);
+	assert(exception != nullptr);
+	m_state->exception = std::move(exception);
+	finish(false);
+}
+
+template <typename T>
+inline void promise<T>::finish(bool broken)
+{
+	auto&& state = *m_state;
+	state.ready = true;
+	if (state.waiting_task)
+	{
+		resume(std::exchange(state.waiting_task, scheduler::handle()));
+		return;
+	}
+	auto* waiting = std::exchange(state.waiting_thread, nullptr);
+	// A broken promise is found in a destructor, which may run while the stack is unwound, so it does not switch.
+	if (waiting == nullptr || broken)
+	{
+		return;
+	}
+	if (state.exception != nullptr)
+	{
+		// The waiting cothread throws the exception from the `switch_to()` it waits in, like the failure of a child.
+		waiting->throw_to(std::exchange(state.exception, nullptr));
+	}
+	else
+	{
+		waiting->switch_to();
+	}
+}
+
+} // namespace co
+
+#endif // CO_FUTURE_IPP_INCLUDE_GUARD
@@ -0,0 +1,182 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+/// \file generator.hpp
+/// A generator on top of `co::thread`.
+///
+/// A `co::generator` runs a producer functor on its own `co::thread`. The producer hands values to the consumer one at
+/// a time by reference, so nothing is copied between them.
+
+#ifndef CO_GENERATOR_HPP_INCLUDE_GUARD
+#define CO_GENERATOR_HPP_INCLUDE_GUARD
+
+#include "../co.hpp"
+#include <cstddef>
+#include <iterator>
+
+#ifdef CPPCO_NO_EXCEPTIONS
+#error "co::generator requires exceptions, it cannot be used with CPPCO_NO_EXCEPTIONS"
+#endif // CPPCO_NO_EXCEPTIONS
+
+namespace co {
+
+/// `co::generator<T>` yields values of type `T` from a producer functor to the consumer.
+///
+/// The producer is called with a `co::generator<T>::sink&`, and every call of the sink suspends the producer until the
+/// consumer asks for the next value. The consumer sees the yielded object itself, which stays valid until the next call
+/// of `next()`. This also holds for temporaries, as the producer is suspended inside the full expression that yields
+/// them.
+///
+/// An exception escaping the producer is propagated to the consumer by the `co::thread` failure handling, and ends the
+/// sequence. Destroying or rewinding a generator that has not finished unwinds the stack of the producer.
+///
+/// A `co::generator` keeps its cothread for its whole lifetime, `rewind()` restarts the producer on the same stack.
+/// Its producer runs on behalf of the cothread that calls `next()`, so a generator can be consumed from any cothread of
+/// the OS thread that created it.
+template <typename T>
+class generator
+{
+	static_assert(!std::is_reference<T>::value, "co::generator yields references to T, T must not be a reference");
+
+public:
+	using value_type = typename std::remove_cv<T>::type;
+	using reference = T&;
+	using pointer = T*;
+
+	/// `co::generator<T>::sink` yields values from the producer of a `co::generator<T>`.
+	class sink
+	{
+	public:
+		sink(const sink& other) = delete;
+		sink& operator=(const sink& other) = delete;
+
+		/// Yields `value` to the consumer and suspends the producer until the next value is requested.
+		void operator()(reference value);
+		/// Yields the temporary `value` to the consumer and suspends the producer until the next value is requested.
+		void operator()(value_type&& value);
+
+	private:
+		friend class generator;
+
+		explicit sink(generator& owner) noexcept;
+
+		generator* m_owner;
+	};
+
+	/// `co::generator<T>::iterator` is an input iterator over the values of a `co::generator<T>`.
+	class iterator
+	{
+	public:
+		using iterator_category = std::input_iterator_tag;
+		using value_type = generator::value_type;
+		using difference_type = std::ptrdiff_t;
+		using pointer = generator::pointer;
+		using reference = generator::reference;
+
+		/// Constructs the end iterator.
+		iterator() noexcept = default;
+
+		reference operator*() const noexcept;
+		pointer operator->() const noexcept;
+		/// Resumes the producer for the next value.
+		iterator& operator++();
+		/// Resumes the producer for the next value. The returned iterator refers to the same generator.
+		iterator operator++(int);
+
+		friend bool operator==(const iterator& lhs, const iterator& rhs) noexcept
+		{
+			return lhs.m_owner == rhs.m_owner;
+		}
+		friend bool operator!=(const iterator& lhs, const iterator& rhs) noexcept
+		{
+			return !(lhs == rhs);
+		}
+
+	private:
+		friend class generator;
+
+		explicit iterator(generator* owner) noexcept;
+
+		generator* m_owner = nullptr;
+	};
+
+	/// `co::generator<T>::is_producer<F>` checks whether a decayed `F` can be used as a producer functor.
+	template <typename F, typename = void>
+	struct is_producer : std::false_type {};
+	template <typename F>
+	struct is_producer<F, decltype(std::declval<F&>()(std::declval<sink&>()), void())> : std::true_type {};
+
+	/// Constructs a generator. The producer does not run until the first value is requested.
+	///
+	/// \param producer    The producer functor. It is called with a `co::generator<T>::sink&`.
+	/// \param stack_size  The stack size of the producer.
+	/// \throw co::thread_create_failure if the cothread could not be created.
+	template <typename F, typename = typename std::enable_if<is_producer<typename std::decay<F>::type>::value>::type>
+	explicit generator(F&& producer, size_t stack_size = thread::default_stack_size);
+	/// Constructs a generator whose cothread is taken from `allocator`.
+	///
+	/// \param producer    The producer functor. It is called with a `co::generator<T>::sink&`.
+	/// \param stack_size  The stack size of the producer.
+	/// \param allocator   The allocator of the cothread, e.g. a `co::thread_pool`. It has to outlive the generator.
+	/// \throw co::thread_create_failure if the cothread could not be created.
+	template <typename F, typename = typename std::enable_if<is_producer<typename std::decay<F>::type>::value>::type>
+	generator(F&& producer, size_t stack_size, stack_allocator& allocator);
+
+	generator(const generator& other) = delete;
+	generator& operator=(const generator& other) = delete;
+
+	/// Resumes the producer until it yields the next value or returns.
+	///
+	/// \return `true` if a value was yielded, `false` if the sequence has ended.
+	/// \throw The exception that escaped the producer.
+	bool next();
+	/// Gets the value yielded by the last successful call of `next()`.
+	reference value() const noexcept;
+	/// Checks whether the sequence has ended.
+	bool done() const noexcept;
+	/// Restarts the producer from the beginning on the same cothread. A producer that is suspended is unwound first.
+	void rewind();
+
+	/// Resumes the producer for the first value. A generator can be iterated once, unless it is rewound in between.
+	iterator begin();
+	/// Gets the end iterator.
+	iterator end() noexcept;
+
+private:
+	template <typename F>
+	struct producer_entry;
+
+	void yield(pointer value);
+
+	thread m_thread;
+	pointer m_current = nullptr;
+	bool m_done = false;
+};
+
+template <typename T>
+template <typename F>
+struct generator<T>::producer_entry
+{
+	generator* owner;
+	F producer;
+
+	void operator()();
+};
+
+} // namespace co
+
+#include "generator.ipp"
+
+#endif // CO_GENERATOR_HPP_INCLUDE_GUARD
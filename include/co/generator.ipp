@@ -0,0 +1,172 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+#ifndef CO_GENERATOR_IPP_INCLUDE_GUARD
+#define CO_GENERATOR_IPP_INCLUDE_GUARD
+
+#include <cassert>
+#include <memory>
+#include <utility>
+
+namespace co {
+
+template <typename T>
+inline generator<T>::sink::sink(generator& owner) noexcept
+	: m_owner{ &owner }
+{
+}
+
+template <typename T>
+inline void generator<T>::sink::operator()(reference value)
+{
+	m_owner->yield(std::addressof(value));
+}
+
+template <typename T>
+inline void generator<T>::sink::operator()(value_type&& value)
+{
+	m_owner->yield(std::addressof(value));
+}
+
+template <typename T>
+inline generator<T>::iterator::iterator(generator* owner) noexcept
+	: m_owner{ owner }
+{
+}
+
+template <typename T>
+inline typename generator<T>::reference generator<T>::iterator::operator*() const noexcept
+{
+	return m_owner->value();
+}
+
+template <typename T>
+inline typename generator<T>::pointer generator<T>::iterator::operator->() const noexcept
+{
+	return std::addressof(m_owner->value());
+}
+
+template <typename T>
+inline typename generator<T>::iterator& generator<T>::iterator::operator++()
+{
+	if (!m_owner->next())
+	{
+		m_owner = nullptr;
+	}
+	return *this;
+}
+
+template <typename T>
+inline typename generator<T>::iterator generator<T>::iterator::operator++(int)
+{
+	auto result = *this;
+	++*this;
+	return result;
+}
+
+template <typename T>
+template <typename F>
+inline void generator<T>::producer_entry<F>::operator()()
+{
+	sink output(*owner);
+	producer(output);
+	owner->m_current = nullptr;
+	owner->m_done = true;
+	// Nothing is left to unwind, the next stop lets the entry functor return.
+	owner->m_thread.set_stop_mode(stop_mode::cooperative);
+	owner->m_thread.get_parent().switch_to();
+	assert(stop_requested());
+}
+
+template <typename T>
+template <typename F, typename>
+inline generator<T>::generator(F&& producer, size_t stack_size)
+	: m_thread{ producer_entry<typename std::decay<F>::type>{ this, std::forward<F>(producer) }, stack_size }
+{
+}
+
+template <typename T>
+template <typename F, typename>
+inline generator<T>::generator(F&& producer, size_t stack_size, stack_allocator& allocator)
+	: m_thread{ producer_entry<typename std::decay<F>::type>{ this, std::forward<F>(producer) }, stack_size, allocator }
+{
+}
+
+template <typename T>
+inline bool generator<T>::next()
+{
+	if (m_done)
+	{
+		return false;
+	}
+	m_current = nullptr;
+	// The producer returns to whichever cothread consumes it.
+	m_thread.set_parent(active());
+	try
+	{
+		m_thread.switch_to();
+	}
+	catch (...)
+	{
+		m_done = true;
+		throw;
+	}
+	return !m_done;
+}
+
+template <typename T>
+inline typename generator<T>::reference generator<T>::value() const noexcept
+{
+	assert(m_current != nullptr);
+	return *m_current;
+}
+
+template <typename T>
+inline bool generator<T>::done() const noexcept
+{
+	return m_done;
+}
+
+template <typename T>
+inline void generator<T>::rewind()
+{
+	m_thread.rewind();
+	m_thread.set_stop_mode(default_stop_mode);
+	m_current = nullptr;
+	m_done = false;
+}
+
+template <typename T>
+inline typename generator<T>::iterator generator<T>::begin()
+{
+	return next() ? iterator(this) : iterator();
+}
+
+template <typename T>
+inline typename generator<T>::iterator generator<T>::end() noexcept
+{
+	return iterator();
+}
+
+template <typename T>
+inline void generator<T>::yield(pointer value)
+{
+	m_current = value;
+	m_thread.get_parent().switch_to();
+}
+
+} // namespace co
+
+#endif // CO_GENERATOR_IPP_INCLUDE_GUARD
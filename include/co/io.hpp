@@ -0,0 +1,161 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+/// \file io.hpp
+/// Non-blocking I/O for the tasks of a `co::scheduler` on Linux.
+///
+/// `co::io::read()`, `write()`, `accept()` and `connect()` behave like the system calls of the same name, except that
+/// instead of failing with `EAGAIN` inside a task they suspend the task until an epoll `co::io::reactor` sees the file
+/// descriptor become ready. The other tasks of the scheduler keep running in the meantime.
+///
+/// The file descriptors have to be in non-blocking mode. Outside of the tasks of a scheduler driven by
+/// `co::io::reactor::run()` the functions don't wait, they fail with `EAGAIN` like the system calls.
+
+#ifndef CO_IO_HPP_INCLUDE_GUARD
+#define CO_IO_HPP_INCLUDE_GUARD
+
+#ifndef __linux__
+#error "co::io requires epoll, which is only available on Linux"
+#endif // __linux__
+
+#include "scheduler.hpp"
+#include "timer.hpp"
+#include <cstdint>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <vector>
+
+#ifdef CPPCO_NO_EXCEPTIONS
+#error "co::io requires exceptions, it cannot be used with CPPCO_NO_EXCEPTIONS"
+#endif // CPPCO_NO_EXCEPTIONS
+
+namespace co {
+namespace io {
+
+/// `co::io::reactor` parks tasks of a `co::scheduler` on file descriptors and resumes them when they are ready.
+///
+/// File descriptors are registered with epoll in edge triggered mode the first time a task waits on them, and stay
+/// registered until `co::io::close()`, so they have to be closed with it. A single `epoll_wait` collects up to
+/// `max_events` events, so the cost of the system call is shared by every task that became ready in the meantime.
+///
+/// A reactor belongs to the OS thread that created it. At most one task may wait for reading and one for writing on
+/// each file descriptor.
+class reactor
+{
+public:
+	/// The number of events a single `poll()` handles at most.
+	static constexpr size_t max_events = 256;
+
+	/// Creates the epoll instance.
+	///
+	/// \throw std::system_error if `epoll_create1` fails.
+	reactor();
+	~reactor();
+
+	reactor(const reactor& other) = delete;
+	reactor& operator=(const reactor& other) = delete;
+
+	/// Runs the tasks of `scheduler`, polling whenever none of them is runnable.
+	///
+	/// Returns once every task has finished, or when the remaining tasks are suspended without waiting on a file
+	/// descriptor. If a task fails, its exception is rethrown from here.
+	///
+	/// \throw std::system_error if `epoll_wait` fails.
+	void run(scheduler& scheduler);
+	/// Runs the tasks of `scheduler` like `run(scheduler)`, and expires the timers of `timers` in between.
+	///
+	/// `epoll_wait` times out at the next deadline of `timers`, so sleeping tasks and deadlines of I/O operations are
+	/// served by the same loop. It returns once every task has finished, or when the remaining tasks are suspended
+	/// without waiting on a file descriptor or an armed timer.
+	///
+	/// \throw std::system_error if `epoll_wait` fails.
+	void run(scheduler& scheduler, timer_wheel& timers);
+
+	/// Waits for events once and resumes the tasks whose file descriptors are ready.
+	///
+	/// \param timeout  The timeout of `epoll_wait` in milliseconds, `-1` waits indefinitely.
+	/// \return The number of events received.
+	/// \throw std::system_error if `epoll_wait` fails.
+	size_t poll(int timeout);
+
+	/// Suspends the active task until `fd` is ready.
+	///
+	/// \param fd      The file descriptor.
+	/// \param events  `EPOLLIN` to wait for reading or `EPOLLOUT` to wait for writing.
+	/// \return `false` with `errno` set if `fd` could not be registered.
+	bool wait(int fd, std::uint32_t events);
+
+	/// Forgets `fd` before it is closed. Tasks waiting on it are resumed.
+	void forget(int fd) noexcept;
+
+	/// Gets the number of tasks waiting on a file descriptor.
+	size_t waiting() const noexcept;
+
+	/// Gets the reactor whose `run()` is executing on the calling OS thread.
+	///
+	/// \return The innermost running reactor, or `nullptr` if there is none.
+	static reactor* current() noexcept;
+
+private:
+	struct descriptor
+	{
+		scheduler::handle reader;
+		scheduler::handle writer;
+		bool registered = false;
+	};
+
+	struct current_guard;
+
+	static reactor*& current_instance() noexcept;
+
+	descriptor& get_descriptor(int fd);
+	void wake(scheduler::handle& waiter) noexcept;
+
+	int m_epoll;
+	std::vector<descriptor> m_descriptors;
+	epoll_event m_events[max_events];
+	size_t m_waiting = 0;
+};
+
+/// Reads from `fd` like `::read()`, suspending the active task while no data is available.
+ssize_t read(int fd, void* buffer, size_t size);
+/// Reads from `fd` like `co::io::read()`, but fails with `ETIMEDOUT` instead of waiting past `deadline`.
+///
+/// `deadline` has to be armed for the active task on the `co::timer_wheel` passed to `co::io::reactor::run()`.
+ssize_t read(int fd, void* buffer, size_t size, const timer_wheel::timer& deadline);
+/// Writes to `fd` like `::write()`, suspending the active task while `fd` cannot take data.
+ssize_t write(int fd, const void* buffer, size_t size);
+/// Writes to `fd` like `co::io::write()`, but fails with `ETIMEDOUT` instead of waiting past `deadline`.
+ssize_t write(int fd, const void* buffer, size_t size, const timer_wheel::timer& deadline);
+/// Accepts a connection like `::accept4()`, suspending the active task while none is pending.
+///
+/// The accepted socket is created in non-blocking mode, ready for `co::io`.
+int accept(int fd, sockaddr* address, socklen_t* length);
+/// Accepts a connection like `co::io::accept()`, but fails with `ETIMEDOUT` instead of waiting past `deadline`.
+int accept(int fd, sockaddr* address, socklen_t* length, const timer_wheel::timer& deadline);
+/// Connects a socket like `::connect()`, suspending the active task until the connection is established.
+int connect(int fd, const sockaddr* address, socklen_t length);
+/// Connects a socket like `co::io::connect()`, but fails with `ETIMEDOUT` instead of waiting past `deadline`.
+int connect(int fd, const sockaddr* address, socklen_t length, const timer_wheel::timer& deadline);
+/// Closes `fd` like `::close()`, after removing it from the running reactor.
+int close(int fd);
+
+} // namespace io
+} // namespace co
+
+#include "io.ipp"
+
+#endif // CO_IO_HPP_INCLUDE_GUARD
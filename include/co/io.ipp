@@ -0,0 +1,367 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+#ifndef CO_IO_IPP_INCLUDE_GUARD
+#define CO_IO_IPP_INCLUDE_GUARD
+
+#include <cassert>
+#include <algorithm>
+#include <cerrno>
+#include <limits>
+#include <system_error>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace co {
+namespace io {
+
+#ifdef __GNUC__
+constexpr size_t reactor::max_events __attribute__((weak));
+#endif // __GNUC__
+
+inline reactor::reactor()
+	: m_epoll{ epoll_create1(EPOLL_CLOEXEC) }
+{
+	if (m_epoll < 0)
+	{
+		throw std::system_error(errno, std::generic_category(), "epoll_create1");
+	}
+}
+
+inline reactor::~reactor()
+{
+	assert(m_waiting == 0);
+	::close(m_epoll);
+}
+
+struct reactor::current_guard
+{
+	reactor* previous;
+
+	~current_guard()
+	{
+		current_instance() = previous;
+	}
+};
+
+inline void reactor::run(scheduler& scheduler)
+{
+	current_guard guard = { std::exchange(current_instance(), this) };
+	while (true)
+	{
+		scheduler.run();
+		if (scheduler.size() == 0 || m_waiting == 0)
+		{
+			return;
+		}
+		poll(-1);
+	}
+}
+
+inline void reactor::run(scheduler& scheduler, timer_wheel& timers)
+{
+	current_guard guard = { std::exchange(current_instance(), this) };
+	timer_wheel::current_guard timers_guard = { std::exchange(timer_wheel::current_instance(), &timers) };
+	while (true)
+	{
+		timers.advance(timer_wheel::clock::now());
+		scheduler.run();
+		if (scheduler.size() == 0 || (m_waiting == 0 && timers.empty()))
+		{
+			return;
+		}
+		auto wait = timers.time_until_next(timer_wheel::clock::now());
+		auto timeout = -1;
+		if (wait != timer_wheel::clock::duration::max())
+		{
+			// Rounded up to whole milliseconds, so the timers are due when `epoll_wait` times out.
+			auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(wait);
+			if (milliseconds < wait)
+			{
+				++milliseconds;
+			}
+			timeout = static_cast<int>(std::min<std::chrono::milliseconds::rep>(milliseconds.count(), std::numeric_limits<int>::max()));
+		}
+		poll(timeout);
+	}
+}
+
+inline size_t reactor::poll(int timeout)
+{
+	auto count = epoll_wait(m_epoll, m_events, static_cast<int>(max_events), timeout);
+	if (count < 0)
+	{
+		if (errno == EINTR)
+		{
+			return 0;
+		}
+		throw std::system_error(errno, std::generic_category(), "epoll_wait");
+	}
+	for (int i = 0; i < count; ++i)
+	{
+		auto&& event = m_events[i];
+		auto&& fd = m_descriptors[static_cast<size_t>(event.data.fd)];
+		// Errors and hang ups wake both directions, the retried call reports them.
+		if ((event.events & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP)) != 0)
+		{
+			wake(fd.reader);
+		}
+		if ((event.events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) != 0)
+		{
+			wake(fd.writer);
+		}
+	}
+	return static_cast<size_t>(count);
+}
+
+inline bool reactor::wait(int fd, std::uint32_t events)
+{
+	assert(events == EPOLLIN || events == EPOLLOUT);
+	auto task = active_task();
+	assert(task);
+	auto&& descriptor = get_descriptor(fd);
+	if (!descriptor.registered)
+	{
+		auto event = epoll_event{};
+		event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+		event.data.fd = fd;
+		if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &event) != 0)
+		{
+			return false;
+		}
+		descriptor.registered = true;
+	}
+	auto&& waiter = events == EPOLLIN ? descriptor.reader : descriptor.writer;
+	assert(!waiter);
+	waiter = task;
+	++m_waiting;
+	struct waiter_guard
+	{
+		reactor* self;
+		int fd;
+		std::uint32_t events;
+
+		// The task may be resumed by someone else, or stopped while it waits. `m_descriptors` may have grown since.
+		~waiter_guard()
+		{
+			auto&& descriptor = self->m_descriptors[static_cast<size_t>(fd)];
+			auto&& waiter = events == EPOLLIN ? descriptor.reader : descriptor.writer;
+			if (waiter)
+			{
+				waiter = scheduler::handle();
+				--self->m_waiting;
+			}
+		}
+	} guard = { this, fd, events };
+	suspend();
+	return true;
+}
+
+inline void reactor::forget(int fd) noexcept
+{
+	if (fd < 0 || static_cast<size_t>(fd) >= m_descriptors.size())
+	{
+		return;
+	}
+	auto&& descriptor = m_descriptors[static_cast<size_t>(fd)];
+	if (descriptor.registered)
+	{
+		epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+		descriptor.registered = false;
+	}
+	wake(descriptor.reader);
+	wake(descriptor.writer);
+}
+
+inline size_t reactor::waiting() const noexcept
+{
+	return m_waiting;
+}
+
+inline reactor* reactor::current() noexcept
+{
+	return current_instance();
+}
+
+inline reactor*& reactor::current_instance() noexcept
+{
+	static thread_local reactor* instance = nullptr;
+	return instance;
+}
+
+inline reactor::descriptor& reactor::get_descriptor(int fd)
+{
+	assert(fd >= 0);
+	auto index = static_cast<size_t>(fd);
+	if (index >= m_descriptors.size())
+	{
+		m_descriptors.resize(index + 1);
+	}
+	return m_descriptors[index];
+}
+
+inline void reactor::wake(scheduler::handle& waiter) noexcept
+{
+	if (waiter)
+	{
+		resume(std::exchange(waiter, scheduler::handle()));
+		--m_waiting;
+	}
+}
+
+namespace detail {
+
+/// Waits until `fd` is ready, or returns `false` with `errno` set if the caller can't wait or `deadline` expired.
+inline bool wait(int fd, std::uint32_t events, const timer_wheel::timer* deadline)
+{
+	auto expired = [deadline]()
+	{
+		if (deadline != nullptr && deadline->expired())
+		{
+			errno = ETIMEDOUT;
+			return true;
+		}
+		return false;
+	};
+	auto* current = reactor::current();
+	if (current == nullptr || !active_task())
+	{
+		return false;
+	}
+	return !expired() && current->wait(fd, events) && !expired();
+}
+
+inline bool would_block(int error) noexcept
+{
+	return error == EAGAIN || error == EWOULDBLOCK;
+}
+
+inline ssize_t read(int fd, void* buffer, size_t size, const timer_wheel::timer* deadline)
+{
+	while (true)
+	{
+		auto result = ::read(fd, buffer, size);
+		if (result >= 0 || (errno != EINTR && (!would_block(errno) || !wait(fd, EPOLLIN, deadline))))
+		{
+			return result;
+		}
+	}
+}
+
+inline ssize_t write(int fd, const void* buffer, size_t size, const timer_wheel::timer* deadline)
+{
+	while (true)
+	{
+		auto result = ::write(fd, buffer, size);
+		if (result >= 0 || (errno != EINTR && (!would_block(errno) || !wait(fd, EPOLLOUT, deadline))))
+		{
+			return result;
+		}
+	}
+}
+
+inline int accept(int fd, sockaddr* address, socklen_t* length, const timer_wheel::timer* deadline)
+{
+	while (true)
+	{
+		auto result = ::accept4(fd, address, length, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (result >= 0 || (errno != EINTR && (!would_block(errno) || !wait(fd, EPOLLIN, deadline))))
+		{
+			return result;
+		}
+	}
+}
+
+inline int connect(int fd, const sockaddr* address, socklen_t length, const timer_wheel::timer* deadline)
+{
+	auto result = ::connect(fd, address, length);
+	if (result == 0 || errno != EINPROGRESS)
+	{
+		return result;
+	}
+	if (!wait(fd, EPOLLOUT, deadline))
+	{
+		return -1;
+	}
+	auto error = 0;
+	auto error_length = static_cast<socklen_t>(sizeof(error));
+	if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &error_length) != 0)
+	{
+		return -1;
+	}
+	if (error != 0)
+	{
+		errno = error;
+		return -1;
+	}
+	return 0;
+}
+
+} // namespace detail
+
+inline ssize_t read(int fd, void* buffer, size_t size)
+{
+	return detail::read(fd, buffer, size, nullptr);
+}
+
+inline ssize_t read(int fd, void* buffer, size_t size, const timer_wheel::timer& deadline)
+{
+	return detail::read(fd, buffer, size, &deadline);
+}
+
+inline ssize_t write(int fd, const void* buffer, size_t size)
+{
+	return detail::write(fd, buffer, size, nullptr);
+}
+
+inline ssize_t write(int fd, const void* buffer, size_t size, const timer_wheel::timer& deadline)
+{
+	return detail::write(fd, buffer, size, &deadline);
+}
+
+inline int accept(int fd, sockaddr* address, socklen_t* length)
+{
+	return detail::accept(fd, address, length, nullptr);
+}
+
+inline int accept(int fd, sockaddr* address, socklen_t* length, const timer_wheel::timer& deadline)
+{
+	return detail::accept(fd, address, length, &deadline);
+}
+
+inline int connect(int fd, const sockaddr* address, socklen_t length)
+{
+	return detail::connect(fd, address, length, nullptr);
+}
+
+inline int connect(int fd, const sockaddr* address, socklen_t length, const timer_wheel::timer& deadline)
+{
+	return detail::connect(fd, address, length, &deadline);
+}
+
+inline int close(int fd)
+{
+	if (auto* current = reactor::current())
+	{
+		current->forget(fd);
+	}
+	return ::close(fd);
+}
+
+} // namespace io
+} // namespace co
+
+#endif // CO_IO_IPP_INCLUDE_GUARD
@@ -0,0 +1,112 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+
+/// \file local.hpp
+/// Storage that is local to a `co::thread`.
+///
+/// `thread_local` variables are per OS thread, so every cothread on the same OS thread shares them. A `co::local` has a
+/// separate value for each `co::thread` instead, kept in a small array of slots in the `co::thread` itself. Accessing it
+/// costs a load of the active `co::thread` from the thread local status and an indexed load from its slots.
+
+#ifndef CO_LOCAL_HPP_INCLUDE_GUARD
+#define CO_LOCAL_HPP_INCLUDE_GUARD
+
+#include "../co.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace co {
+
+/// `co::local<T>` has a separate value of type `T` for each `co::thread`.
+///
+/// The value of a `co::thread` is default constructed the first time it is accessed while that `co::thread` is active,
+/// and it is destroyed when the `co::thread` is reset, rewound or destroyed. The values of the main cothread live as
+/// long as the `cppco` status of the OS thread.
+///
+/// Each `co::local` takes a slot index that is given back when it is destroyed. Destroying a `co::local` does not
+/// destroy the values it left in other `co::thread`s, they are destroyed together with the rest of the values of those
+/// `co::thread`s, or when a new `co::local` stores a value in the same slot. So `T` must not refer to a destroyed
+/// `co::local`.
+template <typename T>
+class local
+{
+public:
+	/// Constructs a `co::local` without any values.
+	local();
+	/// Destructor.
+	~local();
+
+	local(const local& other) = delete;
+	local& operator=(const local& other) = delete;
+
+	/// Gets the value of the active `co::thread`.
+	///
+	/// \return The value, which is default constructed if the active `co::thread` has none yet.
+	T& get() const;
+	/// Gets the value of the active `co::thread` without constructing it.
+	///
+	/// \return A pointer to the value, or `nullptr` if the active `co::thread` has none.
+	T* find() const noexcept;
+	/// Replaces the value of the active `co::thread`.
+	///
+	/// \param args  The arguments of the constructor of the new value.
+	/// \return The new value.
+	template <typename... Args>
+	T& emplace(Args&&... args) const;
+	/// Destroys the value of the active `co::thread`, if it has one.
+	void reset() const noexcept;
+
+	/// \return The value of the active `co::thread`, see `get()`.
+	T& operator*() const;
+	/// \return A pointer to the value of the active `co::thread`, see `get()`.
+	T* operator->() const;
+
+private:
+	static void destroy(void* value) noexcept;
+
+	size_t m_index;
+	std::uint64_t m_key;
+};
+
+namespace detail {
+
+/// `co::detail::local_registry` hands out the slot indices and keys of the `co::local`s.
+class local_registry
+{
+public:
+	static local_registry& instance();
+
+	void acquire(size_t& index, std::uint64_t& key);
+	void release(size_t index) noexcept;
+
+private:
+	local_registry() noexcept;
+
+	std::mutex m_mutex;
+	std::vector<size_t> m_free;
+	size_t m_next_index;
+	std::uint64_t m_next_key;
+};
+
+} // namespace detail
+
+} // namespace co
+
+#include "local.ipp"
+
+#endif // CO_LOCAL_HPP_INCLUDE_GUARD
@@ -0,0 +1,131 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+
+#ifndef CO_LOCAL_IPP_INCLUDE_GUARD
+#define CO_LOCAL_IPP_INCLUDE_GUARD
+
+#include <memory>
+#include <utility>
+
+namespace co {
+
+namespace detail {
+
+inline local_registry& local_registry::instance()
+{
+	static local_registry registry;
+	return registry;
+}
+
+inline local_registry::local_registry() noexcept
+	: m_next_index{ 0 }
+	, m_next_key{ 1 }
+{
+}
+
+inline void local_registry::acquire(size_t& index, std::uint64_t& key)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	// Reserve room for the index up front, so that `release` never has to allocate.
+	m_free.reserve(m_next_index + 1);
+	if (m_free.empty())
+	{
+		index = m_next_index++;
+	}
+	else
+	{
+		// Reuse released indices to keep the slot arrays small.
+		index = m_free.back();
+		m_free.pop_back();
+	}
+	// Keys are never reused, so a value left behind in a slot is never mistaken for the value of a new `co::local`.
+	key = m_next_key++;
+}
+
+inline void local_registry::release(size_t index) noexcept
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_free.push_back(index);
+}
+
+} // namespace detail
+
+template <typename T>
+inline local<T>::local()
+{
+	detail::local_registry::instance().acquire(m_index, m_key);
+}
+
+template <typename T>
+inline local<T>::~local()
+{
+	detail::local_registry::instance().release(m_index);
+}
+
+template <typename T>
+inline T& local<T>::get() const
+{
+	auto* value = find();
+	if (CPPCO_UNLIKELY(value == nullptr))
+	{
+		return emplace();
+	}
+	return *value;
+}
+
+template <typename T>
+inline T* local<T>::find() const noexcept
+{
+	return static_cast<T*>(active().m_locals.find(m_index, m_key));
+}
+
+template <typename T>
+template <typename... Args>
+inline T& local<T>::emplace(Args&&... args) const
+{
+	std::unique_ptr<T> value(new T(std::forward<Args>(args)...));
+	// The active `co::thread` is looked up after the constructor, which may have switched away and back.
+	active().m_locals.store(m_index, m_key, value.get(), &destroy);
+	return *value.release();
+}
+
+template <typename T>
+inline void local<T>::reset() const noexcept
+{
+	active().m_locals.erase(m_index, m_key);
+}
+
+template <typename T>
+inline T& local<T>::operator*() const
+{
+	return get();
+}
+
+template <typename T>
+inline T* local<T>::operator->() const
+{
+	return &get();
+}
+
+template <typename T>
+inline void local<T>::destroy(void* value) noexcept
+{
+	delete static_cast<T*>(value);
+}
+
+} // namespace co
+
+#endif // CO_LOCAL_IPP_INCLUDE_GUARD
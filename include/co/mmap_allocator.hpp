@@ -0,0 +1,84 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+/// \file mmap_allocator.hpp
+/// A `co::stack_allocator` that maps every stack separately, with a guard page below it.
+
+#ifndef CO_MMAP_ALLOCATOR_HPP_INCLUDE_GUARD
+#define CO_MMAP_ALLOCATOR_HPP_INCLUDE_GUARD
+
+#if !defined(__unix__) && !defined(__APPLE__)
+#error "co::mmap_allocator requires mmap"
+#endif // !__unix__ && !__APPLE__
+
+#include "../co.hpp"
+
+namespace co {
+
+/// `co::mmap_allocator` reserves the stacks of cothreads with `mmap` and hands them to `libco` via `co_derive`.
+///
+/// The stacks are mapped without reserving swap space, so a stack only takes memory for the pages that are touched,
+/// whatever its size. `guard_pages` pages below each stack are mapped `PROT_NONE`, so a stack overflow faults instead of
+/// overwriting the neighbouring memory. Every stack is unmapped when its cothread is released. Combine it with a
+/// `co::thread_pool` as upstream to reuse the mappings.
+///
+/// Each guarded stack takes two memory mappings. On Linux the number of mappings of a process is limited by
+/// `vm.max_map_count`, which is 65530 by default, so guard pages have to be turned off or the limit raised for more than
+/// about 30000 cothreads. Without guard pages the kernel merges neighbouring stacks into a single mapping.
+///
+/// This requires a `libco` backend that places the cothread at the start of the memory given to `co_derive`, which all
+/// of them do except the Windows fiber one. A `co::mmap_allocator` is not thread safe and it has to outlive the
+/// `co::thread`s that use it.
+class mmap_allocator final : public stack_allocator
+{
+public:
+	/// Constructs a `co::mmap_allocator`.
+	///
+	/// \param guard_pages  The number of inaccessible pages below each stack.
+	explicit mmap_allocator(size_t guard_pages = 1) noexcept;
+
+	mmap_allocator(const mmap_allocator& other) = delete;
+	mmap_allocator& operator=(const mmap_allocator& other) = delete;
+
+	/// Maps a stack of `stack_size` bytes, rounded up to whole pages, and derives a cothread from its first `stack_size`
+	/// bytes.
+	cothread_t allocate(size_t stack_size, void (*entry)()) noexcept override;
+	void deallocate(cothread_t cothread, size_t stack_size) noexcept override;
+	void discard(cothread_t cothread, size_t stack_size) noexcept override;
+
+	/// Gets the size of the guard below each stack.
+	///
+	/// \return The size in bytes.
+	size_t get_guard_size() const noexcept;
+	/// Gets the address space currently reserved for stacks and their guards.
+	///
+	/// \return The size in bytes.
+	size_t get_reserved() const noexcept;
+
+	/// Gets the page size of the system.
+	static size_t page_size() noexcept;
+
+private:
+	size_t mapping_size(size_t stack_size) const noexcept;
+
+	size_t m_guard_size;
+	size_t m_reserved = 0;
+};
+
+} // namespace co
+
+#include "mmap_allocator.ipp"
+
+#endif // CO_MMAP_ALLOCATOR_HPP_INCLUDE_GUARD
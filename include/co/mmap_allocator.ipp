@@ -0,0 +1,109 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+#ifndef CO_MMAP_ALLOCATOR_IPP_INCLUDE_GUARD
+#define CO_MMAP_ALLOCATOR_IPP_INCLUDE_GUARD
+
+#include <cassert>
+#include <limits>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace co {
+
+inline mmap_allocator::mmap_allocator(size_t guard_pages) noexcept
+	: m_guard_size{ guard_pages * page_size() }
+{
+}
+
+inline cothread_t mmap_allocator::allocate(size_t stack_size, void (*entry)()) noexcept
+{
+	auto size = mapping_size(stack_size);
+	if (stack_size > std::numeric_limits<unsigned int>::max())
+	{
+		return nullptr;
+	}
+	auto flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+	flags |= MAP_NORESERVE;
+#endif // MAP_NORESERVE
+#ifdef MAP_STACK
+	flags |= MAP_STACK;
+#endif // MAP_STACK
+	auto* base = static_cast<char*>(mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, -1, 0));
+	if (base == MAP_FAILED)
+	{
+		return nullptr;
+	}
+	if (m_guard_size > 0 && mprotect(base, m_guard_size, PROT_NONE) != 0)
+	{
+		munmap(base, size);
+		return nullptr;
+	}
+	auto* memory = base + m_guard_size;
+#ifdef CPPCO_STACK_WATERMARK
+	paint_stack(memory, stack_size);
+#endif // CPPCO_STACK_WATERMARK
+	auto cothread = co_derive(memory, static_cast<unsigned int>(stack_size), entry);
+	if (cothread != memory)
+	{
+		// `deallocate` finds the mapping from the address of the cothread.
+		assert(cothread == nullptr);
+		munmap(base, size);
+		return nullptr;
+	}
+	m_reserved += size;
+	return cothread;
+}
+
+inline void mmap_allocator::deallocate(cothread_t cothread, size_t stack_size) noexcept
+{
+	assert(cothread != nullptr);
+	auto size = mapping_size(stack_size);
+	munmap(static_cast<char*>(cothread) - m_guard_size, size);
+	m_reserved -= size;
+}
+
+inline void mmap_allocator::discard(cothread_t cothread, size_t stack_size) noexcept
+{
+	// The objects left on an abandoned stack are never destroyed, so unmapping it is all that is left to do.
+	deallocate(cothread, stack_size);
+}
+
+inline size_t mmap_allocator::get_guard_size() const noexcept
+{
+	return m_guard_size;
+}
+
+inline size_t mmap_allocator::get_reserved() const noexcept
+{
+	return m_reserved;
+}
+
+inline size_t mmap_allocator::page_size() noexcept
+{
+	static const auto size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	return size;
+}
+
+inline size_t mmap_allocator::mapping_size(size_t stack_size) const noexcept
+{
+	auto page = page_size();
+	return (stack_size + page - 1) / page * page + m_guard_size;
+}
+
+} // namespace co
+
+#endif // CO_MMAP_ALLOCATOR_IPP_INCLUDE_GUARD
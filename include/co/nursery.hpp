@@ -0,0 +1,126 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+
+/// \file nursery.hpp
+/// A scope that runs child cothreads and joins or cancels them together.
+///
+/// A `co::nursery` owns the `co::thread`s it spawns, and the cothread that owns the nursery is their parent. `join()`
+/// switches between the children until all of them have finished. If one of them fails, its exception reaches the
+/// owner the way the failure of any child does, and the nursery cancels the remaining children before it rethrows it.
+
+#ifndef CO_NURSERY_HPP_INCLUDE_GUARD
+#define CO_NURSERY_HPP_INCLUDE_GUARD
+
+#include "../co.hpp"
+#include <cstddef>
+#include <deque>
+#include <type_traits>
+#include <vector>
+
+namespace co {
+
+/// `co::nursery` spawns child `co::thread`s, waits for all of them and tears them down in bulk.
+///
+/// The cothread that constructs the nursery owns it. Only the owner may call `join()` and `cancel()`, while children
+/// may also spawn siblings. A child gives the other children a turn by switching to its parent, which returns to
+/// `join()`.
+///
+/// A child that finishes switches back to the owner once, and its cothread is released without switching to it again,
+/// by abandoning its stack after the entry functor has returned. Cancelling stops the unfinished children with the
+/// stop mode given to the constructor, so `co::stop_mode::abandon` tears them down without any switches, at the cost of
+/// not running the destructors on their stacks.
+///
+/// A `co::nursery` is neither copyable nor movable, as its children refer to it.
+class nursery
+{
+public:
+	/// Constructs an empty nursery owned by the calling cothread.
+	///
+	/// \param stack_size   The stack size of the children.
+	/// \param cancel_mode  The stop mode that unfinished children are cancelled with.
+	/// \param allocator    The allocator of the cothreads of the children, or `nullptr` to use `co_create` directly. It
+	///                     has to outlive the nursery.
+	explicit nursery(size_t stack_size = thread::default_stack_size, stop_mode cancel_mode = default_stop_mode,
+		stack_allocator* allocator = nullptr);
+	/// Destructor. Cancels the children that have not finished.
+	~nursery();
+
+	nursery(const nursery& other) = delete;
+	nursery& operator=(const nursery& other) = delete;
+
+	/// Spawns a child. It does not run until `join()` switches to it.
+	///
+	/// \param entry  The entry functor of the child.
+	/// \throw co::thread_create_failure if the cothread of the child cannot be created.
+	template <typename F, typename = typename std::enable_if<thread::is_entry<typename std::decay<F>::type>::value>::type>
+	void spawn(F&& entry);
+
+	/// Runs the children until all of them have finished, including the ones spawned meanwhile.
+	///
+	/// \throw The exception of the first child that fails, after the other children are cancelled.
+	void join();
+
+	/// Stops every child that has not finished and releases all of them in one pass.
+	void cancel() noexcept;
+
+	/// Gets the number of children that have not finished.
+	size_t size() const noexcept;
+
+	/// Gets the owner of the nursery, which is the parent of its children.
+	const thread& get_owner() const noexcept;
+
+private:
+	struct child
+	{
+		thread cothread;
+		bool finished;
+
+		child(const thread& parent, size_t stack_size);
+	};
+
+	template <typename F>
+	struct child_entry
+	{
+		nursery* owner;
+		child* self;
+		F entry;
+
+		void operator()();
+	};
+
+	/// Called by a child whose entry functor has returned. It does not return.
+	void finish(child& self);
+	/// Releases the cothreads of the children that finished and moves the children to `m_free`.
+	void release_finished() noexcept;
+
+	const thread* m_owner;
+	size_t m_stack_size;
+	stop_mode m_cancel_mode;
+	stack_allocator* m_allocator;
+	/// Children never move, so a deque keeps their addresses while more are spawned.
+	std::deque<child> m_children;
+	/// The children that have not been released yet.
+	std::vector<child*> m_running;
+	/// The released children, whose `co::thread`s are reused by `spawn()`.
+	std::vector<child*> m_free;
+	size_t m_unfinished;
+};
+
+} // namespace co
+
+#include "nursery.ipp"
+
+#endif // CO_NURSERY_HPP_INCLUDE_GUARD
@@ -0,0 +1,176 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+
+#ifndef CO_NURSERY_IPP_INCLUDE_GUARD
+#define CO_NURSERY_IPP_INCLUDE_GUARD
+
+#include <cassert>
+#include <utility>
+
+namespace co {
+
+inline nursery::child::child(const thread& parent, size_t stack_size)
+	: cothread{ parent, stack_size }
+	, finished{ false }
+{
+}
+
+template <typename F>
+inline void nursery::child_entry<F>::operator()()
+{
+	entry();
+	owner->finish(*self);
+}
+
+inline nursery::nursery(size_t stack_size, stop_mode cancel_mode, stack_allocator* allocator)
+	: m_owner{ &active() }
+	, m_stack_size{ stack_size }
+	, m_cancel_mode{ cancel_mode }
+	, m_allocator{ allocator }
+	, m_unfinished{ 0 }
+{
+}
+
+inline nursery::~nursery()
+{
+	cancel();
+}
+
+template <typename F, typename>
+inline void nursery::spawn(F&& entry)
+{
+	// Reserve up front, so that neither list has to allocate once the child exists.
+	m_running.reserve(m_running.size() + 1);
+	m_free.reserve(m_children.size() + 1);
+	child* self = nullptr;
+	if (m_free.empty())
+	{
+		m_children.emplace_back(*m_owner, m_stack_size);
+		self = &m_children.back();
+		self->cothread.set_allocator(m_allocator);
+	}
+	else
+	{
+		self = m_free.back();
+		m_free.pop_back();
+	}
+	self->finished = false;
+	self->cothread.set_stop_mode(m_cancel_mode);
+	CPPCO_TRY
+	{
+		self->cothread.reset(child_entry<typename std::decay<F>::type>{ this, self, std::forward<F>(entry) });
+	}
+	CPPCO_CATCH(...)
+	{
+		m_free.push_back(self);
+		CPPCO_RETHROW;
+	}
+	m_running.push_back(self);
+	++m_unfinished;
+}
+
+inline void nursery::join()
+{
+	assert(&active() == m_owner);
+	CPPCO_TRY
+	{
+		// Each pass switches to every child that has not finished once. Children may finish during the turn of another
+		// child, so the flag is checked right before the switch.
+		auto i = size_t{ 0 };
+		while (m_unfinished > 0)
+		{
+			if (i == m_running.size())
+			{
+				release_finished();
+				i = 0;
+				continue;
+			}
+			auto* next = m_running[i++];
+			if (!next->finished)
+			{
+				next->cothread.switch_to();
+			}
+		}
+	}
+	CPPCO_CATCH(...)
+	{
+		cancel();
+		CPPCO_RETHROW;
+	}
+	release_finished();
+}
+
+inline void nursery::cancel() noexcept
+{
+	// Children that are being stopped may spawn siblings while their stacks unwind, those are stopped too.
+	while (!m_running.empty())
+	{
+		auto running = std::move(m_running);
+		m_running.clear();
+		for (auto* stopped : running)
+		{
+			stopped->cothread.reset();
+		}
+	}
+	m_unfinished = 0;
+	m_free.clear();
+	m_children.clear();
+}
+
+inline size_t nursery::size() const noexcept
+{
+	return m_unfinished;
+}
+
+inline const thread& nursery::get_owner() const noexcept
+{
+	return *m_owner;
+}
+
+inline void nursery::finish(child& self)
+{
+	self.finished = true;
+	--m_unfinished;
+	// The entry functor has returned, so there is nothing left to unwind on the stack of the child. Abandoning it
+	// releases the cothread without switching to it again.
+	self.cothread.set_stop_mode(stop_mode::abandon);
+	while (true)
+	{
+		m_owner->switch_to();
+	}
+}
+
+inline void nursery::release_finished() noexcept
+{
+	auto kept = size_t{ 0 };
+	for (auto* running : m_running)
+	{
+		if (running->finished)
+		{
+			running->cothread.reset();
+			m_free.push_back(running);
+		}
+		else
+		{
+			m_running[kept++] = running;
+		}
+	}
+	m_running.resize(kept);
+}
+
+} // namespace co
+
+#endif // CO_NURSERY_IPP_INCLUDE_GUARD
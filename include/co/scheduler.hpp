@@ -0,0 +1,224 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+/// \file scheduler.hpp
+/// A single threaded run queue scheduler on top of `co::thread`.
+///
+/// A `co::scheduler` runs tasks, each on its own `co::thread`. A task gives up the processor with `co::yield()` or
+/// `co::suspend()`, and execution is handed directly to the next runnable task, without a round trip through the
+/// cothread that called `co::scheduler::run()`.
+
+#ifndef CO_SCHEDULER_HPP_INCLUDE_GUARD
+#define CO_SCHEDULER_HPP_INCLUDE_GUARD
+
+#include "../co.hpp"
+#include <cstdint>
+
+namespace co {
+
+/// `co::scheduler` runs tasks on `co::thread`s in priority order.
+///
+/// Runnable tasks are kept in an intrusive FIFO queue per priority, and a bit mask of the non-empty queues makes every
+/// scheduling decision O(1). Tasks of the same priority take turns, a runnable task of a higher priority always runs
+/// before the ones of a lower priority.
+///
+/// Finished tasks keep their node and their cothread for the next `spawn()`, so neither switching nor spawning
+/// allocates once the scheduler has warmed up, provided the entry functor fits `co::thread::inline_entry_size`.
+///
+/// A `co::scheduler` belongs to the cothread that constructs it. `run()` has to be called there, and that cothread
+/// becomes the parent of every task, so a failing task propagates its exception out of `run()`.
+class scheduler
+{
+	struct task;
+
+public:
+	using priority_t = unsigned int;
+
+	/// The number of priorities. Priorities range from `0` (lowest) to `priority_count - 1` (highest).
+	static constexpr priority_t priority_count = 32;
+	/// The priority of tasks spawned without an explicit priority.
+	static constexpr priority_t default_priority = priority_count / 2;
+
+	/// `co::scheduler::handle` refers to a task of a `co::scheduler`.
+	///
+	/// A handle stays safe to use after its task has finished, resuming it then has no effect.
+	class handle
+	{
+	public:
+		handle() noexcept = default;
+
+		/// Checks whether this handle refers to a task at all.
+		explicit operator bool() const noexcept;
+
+		friend bool operator==(const handle& lhs, const handle& rhs) noexcept;
+		friend bool operator!=(const handle& lhs, const handle& rhs) noexcept;
+
+	private:
+		friend class scheduler;
+		friend void resume(handle task) noexcept;
+
+		handle(task* ptask, std::uint64_t generation) noexcept;
+
+		task* m_task = nullptr;
+		std::uint64_t m_generation = 0;
+	};
+
+	/// Constructs a scheduler driven by the calling cothread.
+	///
+	/// \param stack_size  The stack size of the tasks.
+	explicit scheduler(size_t stack_size = thread::default_stack_size);
+	/// Destroys the remaining tasks, unwinding the stacks of the ones that have started.
+	///
+	/// It may not be called from a task of this scheduler.
+	~scheduler();
+
+	scheduler(const scheduler& other) = delete;
+	scheduler& operator=(const scheduler& other) = delete;
+
+	/// Creates a runnable task.
+	///
+	/// \param entry     The entry functor of the task. The task finishes when it returns.
+	/// \param priority  The priority of the task.
+	/// \return The handle of the new task.
+	/// \throw co::thread_create_failure if the cothread of the task could not be created.
+	template <typename F, typename = typename std::enable_if<thread::is_entry<typename std::decay<F>::type>::value>::type>
+	handle spawn(F&& entry, priority_t priority = default_priority);
+
+	/// Runs tasks until none of them is runnable.
+	///
+	/// Tasks that are suspended at that point stay suspended, `run()` can be called again after resuming them.
+	/// If a task fails, then the task is finished and its exception is rethrown from here.
+	void run();
+
+	/// Moves the active task to the back of the queue of its priority and runs the next runnable task.
+	///
+	/// Returns immediately if no other task of the same or higher priority is runnable.
+	void yield();
+
+	/// Suspends the active task until `resume()` is called with its handle.
+	///
+	/// If the active task has been resumed since it last suspended, this returns immediately instead.
+	void suspend();
+
+	/// Makes a suspended task runnable.
+	///
+	/// If the task is running or runnable, then its next `suspend()` returns immediately. Finished tasks are ignored.
+	///
+	/// \param task  The handle of the task.
+	void resume(handle task) noexcept;
+
+	/// Gets the handle of the active task.
+	///
+	/// \return The handle, or an empty handle if no task of this scheduler is active.
+	handle active_task() const noexcept;
+
+	/// Gets the number of tasks that have not finished yet.
+	size_t size() const noexcept;
+
+	/// Gets the scheduler whose `run()` is executing on the calling OS thread.
+	///
+	/// \return The innermost running scheduler, or `nullptr` if there is none.
+	static scheduler* current() noexcept;
+
+private:
+	enum class task_state
+	{
+		free,
+		runnable,
+		running,
+		suspended,
+		finished,
+	};
+
+	template <typename F>
+	struct task_entry;
+
+	/// Does nothing. It replaces the entry functor of a finished task to release the captures of its entry functor.
+	struct idle_entry
+	{
+		void operator()() const noexcept {}
+	};
+
+	struct run_queue
+	{
+		task* head = nullptr;
+		task* tail = nullptr;
+	};
+
+	static scheduler*& current_instance() noexcept;
+	static priority_t highest_priority(std::uint32_t mask) noexcept;
+
+	task& acquire();
+	void release(task& t) noexcept;
+	void push(task& t) noexcept;
+	task* pop() noexcept;
+	void transfer(task* next);
+	void finish();
+	void reap() noexcept;
+
+	const thread* m_loop;
+	size_t m_stack_size;
+	std::vector<std::unique_ptr<task>> m_tasks;
+	task* m_free = nullptr;
+	task* m_finished = nullptr;
+	task* m_current = nullptr;
+	run_queue m_queues[priority_count];
+	std::uint32_t m_mask = 0;
+	size_t m_size = 0;
+};
+
+struct scheduler::task
+{
+	thread cothread;
+	scheduler* owner;
+	task* next = nullptr;
+	std::uint64_t generation = 0;
+	priority_t priority = default_priority;
+	task_state state = task_state::free;
+	bool resume_pending = false;
+
+	task(scheduler& scheduler, const thread& parent, size_t stack_size);
+};
+
+template <typename F>
+struct scheduler::task_entry
+{
+	task* ptask;
+	F entry;
+
+	void operator()();
+};
+
+/// `co::yield()` yields the active task of `co::scheduler::current()`.
+void yield();
+
+/// `co::suspend()` suspends the active task of `co::scheduler::current()`.
+void suspend();
+
+/// `co::active_task()` gets the handle of the active task of `co::scheduler::current()`.
+///
+/// \return The handle, or an empty handle if there is no active task.
+scheduler::handle active_task() noexcept;
+
+/// `co::resume()` makes a suspended task runnable.
+///
+/// \param task  The handle of the task. It may belong to any `co::scheduler` of the calling OS thread.
+void resume(scheduler::handle task) noexcept;
+
+} // namespace co
+
+#include "scheduler.ipp"
+
+#endif // CO_SCHEDULER_HPP_INCLUDE_GUARD
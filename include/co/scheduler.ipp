@@ -0,0 +1,382 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+#ifndef CO_SCHEDULER_IPP_INCLUDE_GUARD
+#define CO_SCHEDULER_IPP_INCLUDE_GUARD
+
+#include <cassert>
+#include <utility>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif // _MSC_VER
+
+namespace co {
+
+#ifdef __GNUC__
+constexpr scheduler::priority_t scheduler::priority_count __attribute__((weak));
+constexpr scheduler::priority_t scheduler::default_priority __attribute__((weak));
+#endif // __GNUC__
+
+inline scheduler::handle::handle(task* ptask, std::uint64_t generation) noexcept
+	: m_task{ ptask }
+	, m_generation{ generation }
+{
+}
+
+inline scheduler::handle::operator bool() const noexcept
+{
+	return m_task != nullptr;
+}
+
+inline bool operator==(const scheduler::handle& lhs, const scheduler::handle& rhs) noexcept
+{
+	return lhs.m_task == rhs.m_task && lhs.m_generation == rhs.m_generation;
+}
+
+inline bool operator!=(const scheduler::handle& lhs, const scheduler::handle& rhs) noexcept
+{
+	return !(lhs == rhs);
+}
+
+inline scheduler::task::task(scheduler& scheduler, const thread& parent, size_t stack_size)
+	: cothread{ parent, stack_size }
+	, owner{ &scheduler }
+{
+}
+
+template <typename F>
+inline void scheduler::task_entry<F>::operator()()
+{
+	entry();
+	ptask->owner->finish();
+}
+
+inline scheduler::scheduler(size_t stack_size)
+	: m_loop{ &active() }
+	, m_stack_size{ stack_size }
+{
+}
+
+inline scheduler::~scheduler()
+{
+	assert(m_current == nullptr);
+	// Stop every task while the scheduler is still intact, the unwinding stacks may refer to it.
+	for (auto&& t : m_tasks)
+	{
+		t->cothread.reset();
+	}
+}
+
+template <typename F, typename>
+inline scheduler::handle scheduler::spawn(F&& entry, priority_t priority)
+{
+	assert(priority < priority_count);
+	auto&& t = acquire();
+	CPPCO_TRY
+	{
+		t.cothread.reset(task_entry<typename std::decay<F>::type>{ &t, std::forward<F>(entry) });
+	}
+	CPPCO_CATCH(...)
+	{
+		release(t);
+		CPPCO_RETHROW;
+	}
+	t.priority = priority;
+	t.resume_pending = false;
+	++m_size;
+	push(t);
+	return handle(&t, t.generation);
+}
+
+inline void scheduler::run()
+{
+	assert(&active() == m_loop);
+	assert(m_current == nullptr);
+	struct current_guard
+	{
+		scheduler* previous;
+
+		~current_guard()
+		{
+			current_instance() = previous;
+		}
+	} guard = { std::exchange(current_instance(), this) };
+	while (true)
+	{
+		reap();
+		auto* next = pop();
+		if (next == nullptr)
+		{
+			return;
+		}
+		next->state = task_state::running;
+		m_current = next;
+		CPPCO_TRY
+		{
+			next->cothread.switch_to();
+		}
+		CPPCO_CATCH(...)
+		{
+			// The failed task is the one that was running, which is not necessarily the one switched to above.
+			auto&& failed = *std::exchange(m_current, nullptr);
+			--m_size;
+			release(failed);
+			CPPCO_RETHROW;
+		}
+		assert(m_current == nullptr);
+	}
+}
+
+inline void scheduler::yield()
+{
+	assert(m_current != nullptr);
+	auto&& self = *m_current;
+	if (m_mask == 0 || highest_priority(m_mask) < self.priority)
+	{
+		return;
+	}
+	push(self);
+	transfer(pop());
+}
+
+inline void scheduler::suspend()
+{
+	assert(m_current != nullptr);
+	auto&& self = *m_current;
+	if (std::exchange(self.resume_pending, false))
+	{
+		return;
+	}
+	self.state = task_state::suspended;
+	transfer(pop());
+}
+
+inline void scheduler::resume(handle task) noexcept
+{
+	auto* t = task.m_task;
+	if (t == nullptr || t->generation != task.m_generation)
+	{
+		return;
+	}
+	switch (t->state)
+	{
+	case task_state::suspended:
+		push(*t);
+		break;
+	case task_state::runnable:
+	case task_state::running:
+		t->resume_pending = true;
+		break;
+	case task_state::free:
+	case task_state::finished:
+		break;
+	}
+}
+
+inline scheduler::handle scheduler::active_task() const noexcept
+{
+	if (m_current == nullptr)
+	{
+		return handle();
+	}
+	return handle(m_current, m_current->generation);
+}
+
+inline size_t scheduler::size() const noexcept
+{
+	return m_size;
+}
+
+inline scheduler* scheduler::current() noexcept
+{
+	return current_instance();
+}
+
+inline scheduler*& scheduler::current_instance() noexcept
+{
+	static thread_local scheduler* instance = nullptr;
+	return instance;
+}
+
+inline scheduler::priority_t scheduler::highest_priority(std::uint32_t mask) noexcept
+{
+	assert(mask != 0);
+#if defined(__GNUC__)
+	return static_cast<priority_t>(31 - __builtin_clz(mask));
+#elif defined(_MSC_VER)
+	unsigned long index;
+	_BitScanReverse(&index, mask);
+	return static_cast<priority_t>(index);
+#else
+	auto priority = priority_t{ 31 };
+	while ((mask & (std::uint32_t{ 1 } << priority)) == 0)
+	{
+		--priority;
+	}
+	return priority;
+#endif
+}
+
+inline scheduler::task& scheduler::acquire()
+{
+	if (m_free != nullptr)
+	{
+		return *std::exchange(m_free, m_free->next);
+	}
+	m_tasks.push_back(std::unique_ptr<task>(new task(*this, *m_loop, m_stack_size)));
+	return *m_tasks.back();
+}
+
+inline void scheduler::release(task& t) noexcept
+{
+	// Invalidate the outstanding handles of the task.
+	++t.generation;
+	t.state = task_state::free;
+	t.next = m_free;
+	m_free = &t;
+}
+
+inline void scheduler::push(task& t) noexcept
+{
+	t.state = task_state::runnable;
+	t.next = nullptr;
+	auto&& queue = m_queues[t.priority];
+	if (queue.tail == nullptr)
+	{
+		queue.head = &t;
+		m_mask |= std::uint32_t{ 1 } << t.priority;
+	}
+	else
+	{
+		queue.tail->next = &t;
+	}
+	queue.tail = &t;
+}
+
+inline scheduler::task* scheduler::pop() noexcept
+{
+	if (m_mask == 0)
+	{
+		return nullptr;
+	}
+	auto priority = highest_priority(m_mask);
+	auto&& queue = m_queues[priority];
+	auto* t = queue.head;
+	queue.head = t->next;
+	if (queue.head == nullptr)
+	{
+		queue.tail = nullptr;
+		m_mask &= ~(std::uint32_t{ 1 } << priority);
+	}
+	t->next = nullptr;
+	return t;
+}
+
+inline void scheduler::transfer(task* next)
+{
+	// Hand over directly to the next task, or return to `run()` if there is none.
+	auto* self = m_current;
+	m_current = next;
+	if (next == self)
+	{
+		self->state = task_state::running;
+		return;
+	}
+	if (next != nullptr)
+	{
+		next->state = task_state::running;
+		next->cothread.switch_to();
+	}
+	else
+	{
+		m_loop->switch_to();
+	}
+	assert(m_current == self);
+	if (CPPCO_UNLIKELY(m_finished != nullptr))
+	{
+		reap();
+	}
+}
+
+inline void scheduler::finish()
+{
+	auto&& self = *m_current;
+	self.state = task_state::finished;
+	self.next = m_finished;
+	m_finished = &self;
+	--m_size;
+	// The task is stopped by `reap()` from another cothread, which must not unwind the stack with an exception.
+	self.cothread.set_stop_mode(stop_mode::cooperative);
+	auto* next = pop();
+	m_current = next;
+	if (next != nullptr)
+	{
+		next->state = task_state::running;
+		next->cothread.switch_to();
+	}
+	else
+	{
+		m_loop->switch_to();
+	}
+	assert(stop_requested());
+}
+
+inline void scheduler::reap() noexcept
+{
+	while (m_finished != nullptr)
+	{
+		auto&& t = *std::exchange(m_finished, m_finished->next);
+		// Stops the finished task and releases its entry functor. The cothread is kept for the next `spawn()`.
+		t.cothread.reset(idle_entry());
+		t.cothread.set_stop_mode(default_stop_mode);
+		release(t);
+	}
+}
+
+inline void yield()
+{
+	auto* current = scheduler::current();
+	assert(current != nullptr);
+	current->yield();
+}
+
+inline void suspend()
+{
+	auto* current = scheduler::current();
+	assert(current != nullptr);
+	current->suspend();
+}
+
+inline scheduler::handle active_task() noexcept
+{
+	auto* current = scheduler::current();
+	if (current == nullptr)
+	{
+		return scheduler::handle();
+	}
+	return current->active_task();
+}
+
+inline void resume(scheduler::handle task) noexcept
+{
+	if (task.m_task != nullptr)
+	{
+		task.m_task->owner->resume(task);
+	}
+}
+
+} // namespace co
+
+#endif // CO_SCHEDULER_IPP_INCLUDE_GUARD
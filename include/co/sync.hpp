@@ -0,0 +1,210 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+
+/// \file sync.hpp
+/// Synchronization primitives for cothreads on the same OS thread.
+///
+/// A `std::mutex` blocks the whole OS thread, so a cothread that waits for another cothread of the same OS thread with
+/// it deadlocks. The primitives here suspend the waiting cothread instead and keep it in an intrusive wait list, whose
+/// nodes live on the stacks of the waiting cothreads. Signalling hands the primitive over to the first waiter and
+/// resumes it. There are no OS calls and no atomics, so all users of a primitive have to be on the same OS thread.
+///
+/// A waiting cothread that is a task of `co::scheduler::current()` is suspended with `co::suspend()` and resumed with
+/// `co::resume()`. Any other waiting cothread switches to its parent, and the cothread that signals it switches to it
+/// directly with `co::thread::switch_to()`. Then the signalling call returns once the signalling cothread is switched
+/// to again. The main cothread cannot wait without a `co::scheduler`, as it has no parent to switch to.
+///
+/// A waiting cothread may be stopped with `co::stop_mode::unwind`, it leaves the wait list then. If it is stopped after
+/// it was signalled but before it ran, then what was handed over to it goes to the next waiter, or back to the
+/// primitive. It must not be abandoned while it waits.
+
+#ifndef CO_SYNC_HPP_INCLUDE_GUARD
+#define CO_SYNC_HPP_INCLUDE_GUARD
+
+#include "../co.hpp"
+#include "scheduler.hpp"
+#include <cstddef>
+#include <mutex>
+
+namespace co {
+
+namespace detail {
+
+/// `co::detail::wait_queue` is a FIFO list of waiting cothreads.
+class wait_queue
+{
+public:
+	/// `co::detail::wait_queue::waiter` puts the active cothread in a `co::detail::wait_queue` while it exists.
+	class waiter
+	{
+	public:
+		explicit waiter(wait_queue& queue) noexcept;
+		/// Leaves the queue, unless the waiter was signalled.
+		~waiter();
+
+		waiter(const waiter& other) = delete;
+		waiter& operator=(const waiter& other) = delete;
+
+		/// Suspends the active cothread until it is signalled.
+		///
+		/// \param hand_back  Called if the stack is unwound after the waiter was signalled, but before it resumed, to
+		///                   give back what was handed over to it.
+		template <typename F>
+		void wait(F hand_back);
+
+	private:
+		friend class wait_queue;
+
+		wait_queue* m_queue;
+		waiter* m_next;
+		scheduler::handle m_task;
+		const thread* m_thread;
+		bool m_signalled;
+		bool m_claimed;
+	};
+
+	wait_queue() noexcept;
+	~wait_queue();
+
+	wait_queue(const wait_queue& other) = delete;
+	wait_queue& operator=(const wait_queue& other) = delete;
+
+	bool empty() const noexcept;
+
+	/// Signals the first waiter.
+	///
+	/// \return `false` if there was no waiter.
+	bool notify_one();
+	/// Signals the first waiter without switching cothreads.
+	///
+	/// A task is resumed, any other waiter runs when it is switched to again.
+	///
+	/// \return `false` if there was no waiter.
+	bool pass_on() noexcept;
+	/// Signals every waiter that is in the queue when it is called, in order.
+	///
+	/// The waiters that are not woken yet must not be stopped by the ones that are woken before them.
+	void notify_all();
+
+private:
+	void push(waiter& node) noexcept;
+	void remove(waiter& node) noexcept;
+	static void signal(waiter& node);
+	void pop() noexcept;
+
+	waiter* m_head;
+	waiter* m_tail;
+};
+
+} // namespace detail
+
+/// `co::mutex` is a mutex that suspends the cothreads waiting for it.
+///
+/// `unlock()` hands the mutex over to the first waiting cothread, so the waiters get it in FIFO order. It meets the
+/// requirements of Lockable, so it can be used with `std::lock_guard` and `std::unique_lock`. It is not recursive.
+class mutex
+{
+public:
+	mutex() noexcept;
+
+	mutex(const mutex& other) = delete;
+	mutex& operator=(const mutex& other) = delete;
+
+	/// Locks the mutex, suspending the active cothread while another cothread holds it.
+	void lock();
+	/// Locks the mutex if no cothread holds it.
+	///
+	/// \return `true` if the mutex was locked.
+	bool try_lock() noexcept;
+	/// Unlocks the mutex, or hands it over to the first waiting cothread.
+	void unlock();
+
+private:
+	detail::wait_queue m_waiters;
+	bool m_locked;
+};
+
+/// `co::condition_variable` suspends cothreads until they are notified.
+///
+/// Like `std::condition_variable` it is used together with a locked `co::mutex`, which is unlocked while the cothread
+/// waits and is locked again before `wait()` returns. Cothreads are only woken by notifications, so there are no
+/// spurious wakeups, but the predicate still has to be checked, as another cothread may take the mutex first.
+class condition_variable
+{
+public:
+	condition_variable() noexcept;
+
+	condition_variable(const condition_variable& other) = delete;
+	condition_variable& operator=(const condition_variable& other) = delete;
+
+	/// Unlocks `lock` and suspends the active cothread until it is notified, then locks `lock` again.
+	///
+	/// \param lock  The lock of a `co::mutex` that is held by the active cothread.
+	void wait(std::unique_lock<mutex>& lock);
+	/// Waits until `predicate` returns `true`.
+	///
+	/// \param lock       The lock of a `co::mutex` that is held by the active cothread.
+	/// \param predicate  Checked with the mutex locked.
+	template <typename Predicate>
+	void wait(std::unique_lock<mutex>& lock, Predicate predicate);
+
+	/// Wakes the cothread that has been waiting for the longest time, if any.
+	void notify_one();
+	/// Wakes every waiting cothread, one after the other.
+	///
+	/// A cothread that is woken must not stop the ones that are woken after it.
+	void notify_all();
+
+private:
+	detail::wait_queue m_waiters;
+};
+
+/// `co::semaphore` is a counting semaphore that suspends the cothreads waiting for a permit.
+///
+/// `release()` hands permits over to the waiting cothreads in FIFO order before it adds them to the count.
+class semaphore
+{
+public:
+	/// Constructs a `co::semaphore` with `count` permits.
+	explicit semaphore(size_t count = 0) noexcept;
+
+	semaphore(const semaphore& other) = delete;
+	semaphore& operator=(const semaphore& other) = delete;
+
+	/// Takes a permit, suspending the active cothread until there is one.
+	void acquire();
+	/// Takes a permit if there is one.
+	///
+	/// \return `true` if a permit was taken.
+	bool try_acquire() noexcept;
+	/// Gives back `count` permits.
+	///
+	/// \param count  The number of permits.
+	void release(size_t count = 1);
+
+	/// \return The number of permits that can be taken without waiting.
+	size_t available() const noexcept;
+
+private:
+	detail::wait_queue m_waiters;
+	size_t m_count;
+};
+
+} // namespace co
+
+#include "sync.ipp"
+
+#endif // CO_SYNC_HPP_INCLUDE_GUARD
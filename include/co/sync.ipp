@@ -0,0 +1,340 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+
+#ifndef CO_SYNC_IPP_INCLUDE_GUARD
+#define CO_SYNC_IPP_INCLUDE_GUARD
+
+#include <cassert>
+#include <utility>
+
+namespace co {
+
+namespace detail {
+
+inline wait_queue::waiter::waiter(wait_queue& queue) noexcept
+	: m_queue{ &queue }
+	, m_next{ nullptr }
+	, m_task{ active_task() }
+	, m_thread{ nullptr }
+	, m_signalled{ false }
+	, m_claimed{ false }
+{
+	if (!m_task)
+	{
+		m_thread = &active();
+		assert(m_thread != &main());
+	}
+	queue.push(*this);
+}
+
+inline wait_queue::waiter::~waiter()
+{
+	// The waiting cothread is being stopped.
+	if (!m_signalled)
+	{
+		m_queue->remove(*this);
+	}
+}
+
+template <typename F>
+inline void wait_queue::waiter::wait(F hand_back)
+{
+	struct unwind_guard
+	{
+		waiter& self;
+		F& hand_back;
+
+		~unwind_guard()
+		{
+			// The waiting cothread is stopped before it could take over what the signal handed to it.
+			if (self.m_signalled && !self.m_claimed)
+			{
+				hand_back();
+			}
+		}
+	} guard = { *this, hand_back };
+	if (m_task)
+	{
+		while (!m_signalled)
+		{
+			suspend();
+		}
+	}
+	else
+	{
+		auto&& parent = m_thread->get_parent();
+		while (!m_signalled)
+		{
+			parent.switch_to();
+		}
+	}
+	m_claimed = true;
+}
+
+inline wait_queue::wait_queue() noexcept
+	: m_head{ nullptr }
+	, m_tail{ nullptr }
+{
+}
+
+inline wait_queue::~wait_queue()
+{
+	assert(m_head == nullptr);
+}
+
+inline bool wait_queue::empty() const noexcept
+{
+	return m_head == nullptr;
+}
+
+inline bool wait_queue::notify_one()
+{
+	auto* node = m_head;
+	if (node == nullptr)
+	{
+		return false;
+	}
+	pop();
+	signal(*node);
+	return true;
+}
+
+inline bool wait_queue::pass_on() noexcept
+{
+	auto* node = m_head;
+	if (node == nullptr)
+	{
+		return false;
+	}
+	pop();
+	node->m_signalled = true;
+	// A waiter that is not a task sees the signal once its parent switches to it again.
+	if (node->m_task)
+	{
+		resume(node->m_task);
+	}
+	return true;
+}
+
+inline void wait_queue::notify_all()
+{
+	// Waiters that wait again once they are woken go to the now empty queue, so they are not woken twice.
+	auto* node = std::exchange(m_head, nullptr);
+	m_tail = nullptr;
+	while (node != nullptr)
+	{
+		auto* next = node->m_next;
+		signal(*node);
+		node = next;
+	}
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 12
+#pragma GCC diagnostic push
+// The nodes live on the stacks of the waiting cothreads, and they leave the queue before their frames end.
+#pragma GCC diagnostic ignored "-Wdangling-pointer"
+#endif // GCC 12
+inline void wait_queue::push(waiter& node) noexcept
+{
+	if (m_tail == nullptr)
+	{
+		m_head = &node;
+	}
+	else
+	{
+		m_tail->m_next = &node;
+	}
+	m_tail = &node;
+}
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 12
+#pragma GCC diagnostic pop
+#endif // GCC 12
+
+inline void wait_queue::pop() noexcept
+{
+	m_head = m_head->m_next;
+	if (m_head == nullptr)
+	{
+		m_tail = nullptr;
+	}
+}
+
+inline void wait_queue::remove(waiter& node) noexcept
+{
+	// Only a cothread that is stopped while it waits leaves the queue this way, so a linear search is fine.
+	waiter* previous = nullptr;
+	auto* current = m_head;
+	while (current != nullptr && current != &node)
+	{
+		previous = current;
+		current = current->m_next;
+	}
+	if (current == nullptr)
+	{
+		return;
+	}
+	(previous == nullptr ? m_head : previous->m_next) = node.m_next;
+	if (m_tail == &node)
+	{
+		m_tail = previous;
+	}
+}
+
+inline void wait_queue::signal(waiter& node)
+{
+	assert(!node.m_signalled);
+	node.m_signalled = true;
+	// The node lives on the stack of the waiting cothread, it may be gone once the cothread runs.
+	if (node.m_task)
+	{
+		resume(node.m_task);
+	}
+	else
+	{
+		node.m_thread->switch_to();
+	}
+}
+
+} // namespace detail
+
+inline mutex::mutex() noexcept
+	: m_locked{ false }
+{
+}
+
+inline void mutex::lock()
+{
+	if (!m_locked)
+	{
+		m_locked = true;
+		return;
+	}
+	detail::wait_queue::waiter self(m_waiters);
+	// `unlock()` leaves the mutex locked for the waiter it signals.
+	self.wait([this]()
+	{
+		if (!m_waiters.pass_on())
+		{
+			m_locked = false;
+		}
+	});
+}
+
+inline bool mutex::try_lock() noexcept
+{
+	if (m_locked)
+	{
+		return false;
+	}
+	m_locked = true;
+	return true;
+}
+
+inline void mutex::unlock()
+{
+	assert(m_locked);
+	if (!m_waiters.notify_one())
+	{
+		m_locked = false;
+	}
+}
+
+inline condition_variable::condition_variable() noexcept
+{
+}
+
+inline void condition_variable::wait(std::unique_lock<mutex>& lock)
+{
+	assert(lock.owns_lock());
+	// Queue up before the mutex is unlocked, `unlock()` may switch to a cothread that notifies.
+	detail::wait_queue::waiter self(m_waiters);
+	lock.unlock();
+	self.wait([this]()
+	{
+		m_waiters.pass_on();
+	});
+	lock.lock();
+}
+
+template <typename Predicate>
+inline void condition_variable::wait(std::unique_lock<mutex>& lock, Predicate predicate)
+{
+	while (!predicate())
+	{
+		wait(lock);
+	}
+}
+
+inline void condition_variable::notify_one()
+{
+	m_waiters.notify_one();
+}
+
+inline void condition_variable::notify_all()
+{
+	m_waiters.notify_all();
+}
+
+inline semaphore::semaphore(size_t count) noexcept
+	: m_count{ count }
+{
+}
+
+inline void semaphore::acquire()
+{
+	if (m_count > 0)
+	{
+		--m_count;
+		return;
+	}
+	detail::wait_queue::waiter self(m_waiters);
+	// `release()` hands the permit over to the waiter it signals.
+	self.wait([this]()
+	{
+		if (!m_waiters.pass_on())
+		{
+			++m_count;
+		}
+	});
+}
+
+inline bool semaphore::try_acquire() noexcept
+{
+	if (m_count == 0)
+	{
+		return false;
+	}
+	--m_count;
+	return true;
+}
+
+inline void semaphore::release(size_t count)
+{
+	while (count > 0 && m_waiters.notify_one())
+	{
+		--count;
+	}
+	m_count += count;
+}
+
+inline size_t semaphore::available() const noexcept
+{
+	return m_count;
+}
+
+} // namespace co
+
+#endif // CO_SYNC_IPP_INCLUDE_GUARD
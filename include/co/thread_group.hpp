@@ -0,0 +1,153 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+
+/// \file thread_group.hpp
+/// A group of `co::thread`s that are created together.
+///
+/// A `co::thread_group` creates all of its cothreads with the same stack size from a single allocation, and keeps their
+/// `co::thread`s next to each other in a single array. Creating the group costs two allocations instead of a `co_create`
+/// per cothread, and iterating over the group walks memory in order.
+
+#ifndef CO_THREAD_GROUP_HPP_INCLUDE_GUARD
+#define CO_THREAD_GROUP_HPP_INCLUDE_GUARD
+
+#include "../co.hpp"
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace co {
+
+/// `co::thread_group` owns `count` `co::thread`s whose stacks are carved from one slab.
+///
+/// Each `co::thread` of the group runs a copy of the entry functor, which is called with the index of the
+/// `co::thread` in the group. The `co::thread`s are only handed out as `const co::thread&`, which is enough to switch to
+/// them, so they cannot be moved out of the group or get another stack size or allocator. They are rewound and reset
+/// through the group. Their cothreads are derived with `co_derive`, so this requires a `libco` backend that places the
+/// cothread at the start of the memory given to `co_derive`, which all of them do except the Windows fiber one.
+///
+/// The stacks are allocated with `std::malloc`, which maps large allocations lazily on most systems, so a stack only
+/// takes memory for the pages that are touched. There are no guard pages between the stacks.
+///
+/// A `co::thread_group` is neither copyable nor movable, as its `co::thread`s refer to its slab.
+class thread_group
+{
+public:
+	using iterator = std::vector<thread>::const_iterator;
+	using const_iterator = std::vector<thread>::const_iterator;
+
+	/// `co::thread_group::is_group_entry<F>` checks whether a decayed `F` can be used as the entry functor of a group.
+	template <typename F, typename = void>
+	struct is_group_entry : std::false_type {};
+	template <typename F>
+	struct is_group_entry<F, decltype(std::declval<F&>()(std::declval<size_t>()), void())> : std::true_type {};
+
+	/// Constructs a group of `count` `co::thread`s. None of them runs until it is switched to.
+	///
+	/// \param count       The number of `co::thread`s.
+	/// \param entry       The entry functor. Every `co::thread` gets a copy of it, which is called with the index of
+	///                    the `co::thread`.
+	/// \param stack_size  The stack size of every `co::thread`.
+	/// \param parent      The parent of every `co::thread`. Defaults to the calling `co::thread`.
+	/// \throw co::thread_create_failure if the slab cannot be allocated.
+	template <typename F, typename = typename std::enable_if<is_group_entry<typename std::decay<F>::type>::value>::type>
+	thread_group(size_t count, F&& entry, size_t stack_size = thread::default_stack_size,
+		const thread& parent = active());
+	/// Destructor. Stops the `co::thread`s in order and releases the slab.
+	~thread_group();
+
+	thread_group(const thread_group& other) = delete;
+	thread_group& operator=(const thread_group& other) = delete;
+
+	/// Gets the number of `co::thread`s in the group.
+	size_t size() const noexcept;
+	/// Gets the stack size of the `co::thread`s in the group.
+	size_t get_stack_size() const noexcept;
+
+	/// Gets the `co::thread` at `index`.
+	const thread& operator[](size_t index) const noexcept;
+
+	const_iterator begin() const noexcept;
+	const_iterator end() const noexcept;
+
+	/// Rewinds every `co::thread` of the group, see `co::thread::rewind()`. The cothreads are kept.
+	void rewind();
+	/// Rewinds the `co::thread` at `index`, see `co::thread::rewind()`. Its cothread is kept.
+	void rewind(size_t index);
+	/// Stops the `co::thread` at `index` and releases its entry functor and its stack, see `co::thread::reset()`.
+	///
+	/// The `co::thread` stays in the group empty, so the indices of the others do not change.
+	void reset(size_t index);
+
+	/// Stops and destroys every `co::thread` of the group in order and releases the slab. The group is empty afterwards.
+	void clear();
+
+private:
+	/// The `co::stack_allocator` that hands out the stacks of the slab.
+	class slab final : public stack_allocator
+	{
+	public:
+		slab(size_t count, size_t stack_size);
+
+		slab(const slab& other) = delete;
+		slab& operator=(const slab& other) = delete;
+
+		cothread_t allocate(size_t stack_size, void (*entry)()) noexcept override;
+		void deallocate(cothread_t cothread, size_t stack_size) noexcept override;
+		void discard(cothread_t cothread, size_t stack_size) noexcept override;
+
+		size_t get_stack_size() const noexcept;
+		/// Frees the memory of the slab. All stacks have to be returned already.
+		void release() noexcept;
+
+	private:
+		struct free_deleter
+		{
+			void operator()(void* memory) const noexcept;
+		};
+
+		/// Stacks are aligned to cache lines.
+		static constexpr size_t alignment = 64;
+
+		std::unique_ptr<void, free_deleter> m_memory;
+		unsigned char* m_begin = nullptr;
+		size_t m_stack_size;
+		size_t m_stride;
+		size_t m_count;
+		/// The number of stacks that were never handed out, they are at the end of the slab.
+		size_t m_untouched;
+		/// The stacks that were returned, linked through their first word.
+		void* m_free = nullptr;
+	};
+
+	template <typename F>
+	struct indexed_entry
+	{
+		F entry;
+		size_t index;
+
+		void operator()();
+	};
+
+	slab m_slab;
+	std::vector<thread> m_threads;
+};
+
+} // namespace co
+
+#include "thread_group.ipp"
+
+#endif // CO_THREAD_GROUP_HPP_INCLUDE_GUARD
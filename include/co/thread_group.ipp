@@ -0,0 +1,207 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+
+#ifndef CO_THREAD_GROUP_IPP_INCLUDE_GUARD
+#define CO_THREAD_GROUP_IPP_INCLUDE_GUARD
+
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <utility>
+
+namespace co {
+
+#ifdef __GNUC__
+constexpr size_t thread_group::slab::alignment __attribute__((weak));
+#endif // __GNUC__
+
+inline void thread_group::slab::free_deleter::operator()(void* memory) const noexcept
+{
+	std::free(memory);
+}
+
+inline thread_group::slab::slab(size_t count, size_t stack_size)
+	: m_stack_size{ stack_size }
+	, m_stride{ (stack_size + alignment - 1) / alignment * alignment }
+	, m_count{ count }
+	, m_untouched{ count }
+{
+	if (count == 0)
+	{
+		return;
+	}
+	if (stack_size > std::numeric_limits<unsigned int>::max()
+		|| m_stride > (std::numeric_limits<size_t>::max() - alignment) / count)
+	{
+		CPPCO_THROW(thread_create_failure());
+	}
+	m_memory.reset(std::malloc(m_stride * count + alignment));
+	if (m_memory == nullptr)
+	{
+		CPPCO_THROW(thread_create_failure());
+	}
+	auto address = reinterpret_cast<std::uintptr_t>(m_memory.get());
+	m_begin = static_cast<unsigned char*>(m_memory.get()) + (alignment - address % alignment) % alignment;
+}
+
+inline cothread_t thread_group::slab::allocate(size_t stack_size, void (*entry)()) noexcept
+{
+	if (stack_size != m_stack_size)
+	{
+		return nullptr;
+	}
+	void* memory = nullptr;
+	if (m_free != nullptr)
+	{
+		memory = m_free;
+		m_free = *static_cast<void**>(memory);
+	}
+	else if (m_untouched > 0)
+	{
+		memory = m_begin + (m_count - m_untouched) * m_stride;
+		--m_untouched;
+	}
+	else
+	{
+		return nullptr;
+	}
+#ifdef CPPCO_STACK_WATERMARK
+	paint_stack(memory, stack_size);
+#endif // CPPCO_STACK_WATERMARK
+	auto cothread = co_derive(memory, static_cast<unsigned int>(stack_size), entry);
+	if (cothread != memory)
+	{
+		// `deallocate` finds the stack from the address of the cothread.
+		assert(cothread == nullptr);
+		deallocate(memory, stack_size);
+		return nullptr;
+	}
+	return cothread;
+}
+
+inline void thread_group::slab::deallocate(cothread_t cothread, size_t stack_size) noexcept
+{
+	static_cast<void>(stack_size);
+	assert(stack_size == m_stack_size);
+	assert(cothread >= m_begin && cothread < m_begin + m_count * m_stride);
+	*static_cast<void**>(cothread) = m_free;
+	m_free = cothread;
+}
+
+inline void thread_group::slab::discard(cothread_t cothread, size_t stack_size) noexcept
+{
+	// Nothing runs on an abandoned stack again, and the next `allocate` derives a fresh cothread on it.
+	deallocate(cothread, stack_size);
+}
+
+inline size_t thread_group::slab::get_stack_size() const noexcept
+{
+	return m_stack_size;
+}
+
+inline void thread_group::slab::release() noexcept
+{
+	m_memory.reset();
+	m_begin = nullptr;
+	m_count = 0;
+	m_untouched = 0;
+	m_free = nullptr;
+}
+
+template <typename F>
+inline void thread_group::indexed_entry<F>::operator()()
+{
+	entry(index);
+}
+
+template <typename F, typename>
+inline thread_group::thread_group(size_t count, F&& entry, size_t stack_size, const thread& parent)
+	: m_slab{ count, stack_size }
+{
+	using entry_type = indexed_entry<typename std::decay<F>::type>;
+	m_threads.reserve(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		m_threads.emplace_back(entry_type{ entry, i }, stack_size, m_slab, parent);
+	}
+}
+
+inline thread_group::~thread_group()
+{
+	clear();
+}
+
+inline size_t thread_group::size() const noexcept
+{
+	return m_threads.size();
+}
+
+inline size_t thread_group::get_stack_size() const noexcept
+{
+	return m_slab.get_stack_size();
+}
+
+inline const thread& thread_group::operator[](size_t index) const noexcept
+{
+	assert(index < m_threads.size());
+	return m_threads[index];
+}
+
+inline thread_group::const_iterator thread_group::begin() const noexcept
+{
+	return m_threads.begin();
+}
+
+inline thread_group::const_iterator thread_group::end() const noexcept
+{
+	return m_threads.end();
+}
+
+inline void thread_group::rewind()
+{
+	for (auto&& t : m_threads)
+	{
+		t.rewind();
+	}
+}
+
+inline void thread_group::rewind(size_t index)
+{
+	assert(index < m_threads.size());
+	m_threads[index].rewind();
+}
+
+inline void thread_group::reset(size_t index)
+{
+	assert(index < m_threads.size());
+	m_threads[index].reset();
+}
+
+inline void thread_group::clear()
+{
+	// `std::vector::clear` destroys the elements in an unspecified order, the stops are issued front to back instead.
+	for (auto&& t : m_threads)
+	{
+		t.reset();
+	}
+	m_threads.clear();
+	m_slab.release();
+}
+
+} // namespace co
+
+#endif // CO_THREAD_GROUP_IPP_INCLUDE_GUARD
@@ -0,0 +1,167 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+/// \file timer.hpp
+/// Timers for the tasks of a `co::scheduler`.
+///
+/// A `co::timer_wheel` resumes the tasks of a scheduler at their deadlines. `co::sleep_for()` and `co::sleep_until()`
+/// suspend the active task until then, and a `co::timer_wheel::timer` armed for the active task puts a deadline on any
+/// operation that suspends it, e.g. the ones of `co::io`.
+
+#ifndef CO_TIMER_HPP_INCLUDE_GUARD
+#define CO_TIMER_HPP_INCLUDE_GUARD
+
+#include "scheduler.hpp"
+#include <chrono>
+#include <cstdint>
+
+namespace co {
+
+namespace io {
+class reactor;
+} // namespace io
+
+/// `co::timer_wheel` is a hierarchical timing wheel.
+///
+/// Time is counted in ticks since the construction of the wheel. The first level has a slot for each of the next
+/// `level0_size` ticks, and every further level has `level_size` slots that each cover a whole turn of the level below.
+/// Timers that are too far away for the last level wait in it and are placed again when it turns. Arming and cancelling
+/// a timer are O(1), and advancing the time costs O(1) per tick with timers plus a cascade every `level0_size` ticks, no
+/// matter how many timers are pending.
+///
+/// Timers never expire early, but they may expire up to a tick late. A wheel belongs to the OS thread that created it.
+class timer_wheel
+{
+	struct link
+	{
+		link* prev;
+		link* next;
+	};
+
+public:
+	using clock = std::chrono::steady_clock;
+
+	/// The number of slots of the first level.
+	static constexpr size_t level0_size = 256;
+	/// The number of slots of the further levels.
+	static constexpr size_t level_size = 64;
+	/// The number of further levels. With a tick of 1 ms the levels cover about 18 hours.
+	static constexpr size_t level_count = 3;
+
+	/// `co::timer_wheel::timer` resumes a task of a `co::scheduler` at its deadline.
+	///
+	/// A timer is cancelled when it is destroyed, so it can live on the stack of the task it belongs to.
+	class timer : private link
+	{
+	public:
+		timer() noexcept;
+		~timer();
+
+		timer(const timer& other) = delete;
+		timer& operator=(const timer& other) = delete;
+
+		/// Checks whether the timer waits for its deadline.
+		bool armed() const noexcept;
+		/// Checks whether the deadline has passed since the timer was last armed.
+		bool expired() const noexcept;
+		/// Gets the deadline the timer was last armed with.
+		clock::time_point get_deadline() const noexcept;
+
+	private:
+		friend class timer_wheel;
+
+		timer_wheel* m_wheel = nullptr;
+		std::uint64_t m_expiry = 0;
+		/// `0` for the first level, `n` for the `n`th further level.
+		size_t m_level = 0;
+		clock::time_point m_deadline;
+		scheduler::handle m_task;
+		bool m_expired = false;
+	};
+
+	/// Constructs a timer wheel.
+	///
+	/// \param tick  The resolution of the wheel.
+	explicit timer_wheel(clock::duration tick = std::chrono::milliseconds(1));
+	/// Cancels the pending timers.
+	~timer_wheel();
+
+	timer_wheel(const timer_wheel& other) = delete;
+	timer_wheel& operator=(const timer_wheel& other) = delete;
+
+	/// Arms `t` to resume `task` at `deadline`. A timer that is already armed is moved to the new deadline.
+	void arm(timer& t, clock::time_point deadline, scheduler::handle task = active_task());
+	/// Cancels `t` if it is armed.
+	void cancel(timer& t) noexcept;
+
+	/// Expires the timers whose deadline has passed at `now` and resumes their tasks.
+	///
+	/// \return The number of timers that expired.
+	size_t advance(clock::time_point now) noexcept;
+	/// Gets the time until the next call of `advance()` may have work to do. Blocking until then is safe.
+	///
+	/// \return `clock::duration::max()` if no timer is armed.
+	clock::duration time_until_next(clock::time_point now) const noexcept;
+
+	/// Runs the tasks of `scheduler`, sleeping until the next deadline whenever none of them is runnable.
+	///
+	/// Returns once every task has finished, or when the remaining tasks are suspended without an armed timer. If a task
+	/// fails, its exception is rethrown from here.
+	void run(scheduler& scheduler);
+
+	/// Gets the number of armed timers.
+	size_t size() const noexcept;
+	/// Checks whether no timer is armed.
+	bool empty() const noexcept;
+
+	/// Gets the timer wheel whose `run()` is executing on the calling OS thread.
+	///
+	/// \return The innermost running timer wheel, or `nullptr` if there is none.
+	static timer_wheel* current() noexcept;
+
+private:
+	friend class io::reactor;
+
+	struct current_guard;
+
+	static timer_wheel*& current_instance() noexcept;
+	static void unlink(link& node) noexcept;
+	static void push_back(link& list, link& node) noexcept;
+
+	std::uint64_t to_tick(clock::time_point time) const noexcept;
+	void place(timer& t) noexcept;
+	void cascade(size_t level) noexcept;
+	size_t expire(link& slot) noexcept;
+
+	clock::time_point m_epoch;
+	clock::duration m_tick;
+	/// The next tick to process.
+	std::uint64_t m_now = 0;
+	size_t m_size = 0;
+	size_t m_level0_count = 0;
+	link m_level0[level0_size];
+	link m_levels[level_count][level_size];
+};
+
+/// Suspends the active task of the running `co::timer_wheel` until `deadline`.
+void sleep_until(timer_wheel::clock::time_point deadline);
+/// Suspends the active task of the running `co::timer_wheel` for `duration`.
+void sleep_for(timer_wheel::clock::duration duration);
+
+} // namespace co
+
+#include "timer.ipp"
+
+#endif // CO_TIMER_HPP_INCLUDE_GUARD
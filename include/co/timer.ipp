@@ -0,0 +1,376 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+#ifndef CO_TIMER_IPP_INCLUDE_GUARD
+#define CO_TIMER_IPP_INCLUDE_GUARD
+
+#include <cassert>
+#include <thread>
+#include <utility>
+
+namespace co {
+
+#ifdef __GNUC__
+constexpr size_t timer_wheel::level0_size __attribute__((weak));
+constexpr size_t timer_wheel::level_size __attribute__((weak));
+constexpr size_t timer_wheel::level_count __attribute__((weak));
+#endif // __GNUC__
+
+namespace detail {
+
+/// log2 of `timer_wheel::level0_size`.
+constexpr unsigned level0_bits = 8;
+/// log2 of `timer_wheel::level_size`.
+constexpr unsigned level_bits = 6;
+
+static_assert(timer_wheel::level0_size == 1u << level0_bits, "level0_bits doesn't match level0_size");
+static_assert(timer_wheel::level_size == 1u << level_bits, "level_bits doesn't match level_size");
+
+/// The number of ticks covered by the levels up to and including `level`.
+constexpr std::uint64_t span(size_t level) noexcept
+{
+	return std::uint64_t{ 1 } << (level0_bits + level * level_bits);
+}
+
+} // namespace detail
+
+struct timer_wheel::current_guard
+{
+	timer_wheel* previous;
+
+	~current_guard()
+	{
+		current_instance() = previous;
+	}
+};
+
+inline timer_wheel::timer::timer() noexcept
+	: link{ nullptr, nullptr }
+{
+}
+
+inline timer_wheel::timer::~timer()
+{
+	if (m_wheel != nullptr)
+	{
+		m_wheel->cancel(*this);
+	}
+}
+
+inline bool timer_wheel::timer::armed() const noexcept
+{
+	return m_wheel != nullptr;
+}
+
+inline bool timer_wheel::timer::expired() const noexcept
+{
+	return m_expired;
+}
+
+inline timer_wheel::clock::time_point timer_wheel::timer::get_deadline() const noexcept
+{
+	return m_deadline;
+}
+
+inline timer_wheel::timer_wheel(clock::duration tick)
+	: m_epoch{ clock::now() }
+	, m_tick{ tick }
+{
+	assert(tick > clock::duration::zero());
+	for (auto&& slot : m_level0)
+	{
+		slot.prev = slot.next = &slot;
+	}
+	for (auto&& level : m_levels)
+	{
+		for (auto&& slot : level)
+		{
+			slot.prev = slot.next = &slot;
+		}
+	}
+}
+
+inline timer_wheel::~timer_wheel()
+{
+	auto clear = [](link& slot)
+	{
+		while (slot.next != &slot)
+		{
+			auto&& t = static_cast<timer&>(*slot.next);
+			unlink(t);
+			t.m_wheel = nullptr;
+		}
+	};
+	for (auto&& slot : m_level0)
+	{
+		clear(slot);
+	}
+	for (auto&& level : m_levels)
+	{
+		for (auto&& slot : level)
+		{
+			clear(slot);
+		}
+	}
+}
+
+inline void timer_wheel::arm(timer& t, clock::time_point deadline, scheduler::handle task)
+{
+	if (t.m_wheel != nullptr)
+	{
+		t.m_wheel->cancel(t);
+	}
+	t.m_wheel = this;
+	t.m_deadline = deadline;
+	t.m_expiry = to_tick(deadline);
+	t.m_task = task;
+	t.m_expired = false;
+	++m_size;
+	place(t);
+}
+
+inline void timer_wheel::cancel(timer& t) noexcept
+{
+	if (t.m_wheel == nullptr)
+	{
+		return;
+	}
+	assert(t.m_wheel == this);
+	unlink(t);
+	t.m_wheel = nullptr;
+	--m_size;
+	if (t.m_level == 0)
+	{
+		--m_level0_count;
+	}
+}
+
+inline size_t timer_wheel::advance(clock::time_point now) noexcept
+{
+	if (now < m_epoch)
+	{
+		return 0;
+	}
+	auto target = static_cast<std::uint64_t>((now - m_epoch) / m_tick);
+	auto expired = size_t{ 0 };
+	while (m_now <= target)
+	{
+		if (m_size == 0)
+		{
+			m_now = target + 1;
+			break;
+		}
+		auto index = static_cast<size_t>(m_now & (level0_size - 1));
+		if (index == 0)
+		{
+			cascade(1);
+		}
+		if (m_level0_count == 0)
+		{
+			// Nothing to expire before the next cascade.
+			auto boundary = (m_now | (level0_size - 1)) + 1;
+			m_now = boundary <= target ? boundary : target + 1;
+			continue;
+		}
+		expired += expire(m_level0[index]);
+		++m_now;
+	}
+	return expired;
+}
+
+inline timer_wheel::clock::duration timer_wheel::time_until_next(clock::time_point now) const noexcept
+{
+	if (m_size == 0)
+	{
+		return clock::duration::max();
+	}
+	// The first non-empty slot of the first level, or the next cascade, which may fill it.
+	auto next = m_now;
+	do
+	{
+		if (m_level0[static_cast<size_t>(next & (level0_size - 1))].next != &m_level0[static_cast<size_t>(next & (level0_size - 1))])
+		{
+			break;
+		}
+		++next;
+	} while ((next & (level0_size - 1)) != 0);
+	auto due = m_epoch + m_tick * static_cast<clock::rep>(next);
+	return due > now ? due - now : clock::duration::zero();
+}
+
+inline void timer_wheel::run(scheduler& scheduler)
+{
+	current_guard guard = { std::exchange(current_instance(), this) };
+	while (true)
+	{
+		advance(clock::now());
+		scheduler.run();
+		if (scheduler.size() == 0 || empty())
+		{
+			return;
+		}
+		auto now = clock::now();
+		auto wait = time_until_next(now);
+		if (wait > clock::duration::zero())
+		{
+			std::this_thread::sleep_until(now + wait);
+		}
+	}
+}
+
+inline size_t timer_wheel::size() const noexcept
+{
+	return m_size;
+}
+
+inline bool timer_wheel::empty() const noexcept
+{
+	return m_size == 0;
+}
+
+inline timer_wheel* timer_wheel::current() noexcept
+{
+	return current_instance();
+}
+
+inline timer_wheel*& timer_wheel::current_instance() noexcept
+{
+	static thread_local timer_wheel* instance = nullptr;
+	return instance;
+}
+
+inline void timer_wheel::unlink(link& node) noexcept
+{
+	node.prev->next = node.next;
+	node.next->prev = node.prev;
+	node.prev = node.next = nullptr;
+}
+
+inline void timer_wheel::push_back(link& list, link& node) noexcept
+{
+	node.prev = list.prev;
+	node.next = &list;
+	list.prev->next = &node;
+	list.prev = &node;
+}
+
+inline std::uint64_t timer_wheel::to_tick(clock::time_point time) const noexcept
+{
+	if (time <= m_epoch)
+	{
+		return 0;
+	}
+	// Rounded up, so that a timer never expires early.
+	auto elapsed = time - m_epoch;
+	auto ticks = static_cast<std::uint64_t>(elapsed / m_tick);
+	return elapsed % m_tick != clock::duration::zero() ? ticks + 1 : ticks;
+}
+
+inline void timer_wheel::place(timer& t) noexcept
+{
+	using namespace detail;
+	// Deadlines that have passed go to the slot processed next.
+	auto expiry = t.m_expiry < m_now ? m_now : t.m_expiry;
+	auto delta = expiry - m_now;
+	if (delta < span(0))
+	{
+		t.m_level = 0;
+		++m_level0_count;
+		push_back(m_level0[static_cast<size_t>(expiry & (level0_size - 1))], t);
+		return;
+	}
+	for (size_t level = 1; level <= level_count; ++level)
+	{
+		if (delta < span(level) || level == level_count)
+		{
+			if (delta >= span(level))
+			{
+				// Too far for the wheel: wait for the last level to turn once more and place it again then.
+				expiry = m_now + span(level) - 1;
+			}
+			auto shift = level0_bits + (level - 1) * level_bits;
+			t.m_level = level;
+			push_back(m_levels[level - 1][static_cast<size_t>((expiry >> shift) & (level_size - 1))], t);
+			return;
+		}
+	}
+}
+
+inline void timer_wheel::cascade(size_t level) noexcept
+{
+	using namespace detail;
+	auto shift = level0_bits + (level - 1) * level_bits;
+	auto index = static_cast<size_t>((m_now >> shift) & (level_size - 1));
+	// The turn of this level moves the next slot of the level above down first.
+	if (index == 0 && level < level_count)
+	{
+		cascade(level + 1);
+	}
+	auto&& slot = m_levels[level - 1][index];
+	link pending = { &pending, &pending };
+	if (slot.next != &slot)
+	{
+		pending.next = slot.next;
+		pending.prev = slot.prev;
+		pending.next->prev = &pending;
+		pending.prev->next = &pending;
+		slot.prev = slot.next = &slot;
+	}
+	while (pending.next != &pending)
+	{
+		auto&& t = static_cast<timer&>(*pending.next);
+		unlink(t);
+		place(t);
+	}
+}
+
+inline size_t timer_wheel::expire(link& slot) noexcept
+{
+	auto expired = size_t{ 0 };
+	while (slot.next != &slot)
+	{
+		auto&& t = static_cast<timer&>(*slot.next);
+		assert(t.m_expiry <= m_now);
+		unlink(t);
+		t.m_wheel = nullptr;
+		t.m_expired = true;
+		--m_size;
+		--m_level0_count;
+		++expired;
+		resume(t.m_task);
+	}
+	return expired;
+}
+
+inline void sleep_until(timer_wheel::clock::time_point deadline)
+{
+	auto* wheel = timer_wheel::current();
+	assert(wheel != nullptr);
+	timer_wheel::timer t;
+	wheel->arm(t, deadline);
+	while (!t.expired())
+	{
+		suspend();
+	}
+}
+
+inline void sleep_for(timer_wheel::clock::duration duration)
+{
+	sleep_until(timer_wheel::clock::now() + duration);
+}
+
+} // namespace co
+
+#endif // CO_TIMER_IPP_INCLUDE_GUARD
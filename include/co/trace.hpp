@@ -0,0 +1,137 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+
+/// \file trace.hpp
+/// Trace events of cothread switches, creations and failures.
+///
+/// With `CPPCO_TRACE` defined, `co.hpp` includes this file and `co::thread` records an event whenever a cothread is
+/// created, switched to, stopped, reset or fails. The events go to a ring buffer of the calling OS thread, so recording
+/// takes no lock. `co::trace::flush()` writes the events in the Chrome trace event format, which `chrome://tracing` and
+/// Perfetto open, as a timeline of the cothreads each OS thread ran.
+///
+/// Without `CPPCO_TRACE` the hooks in `co::thread` expand to nothing.
+
+#ifndef CO_TRACE_HPP_INCLUDE_GUARD
+#define CO_TRACE_HPP_INCLUDE_GUARD
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/// The number of events the ring buffer of an OS thread holds. Older events are overwritten once it is full.
+#ifndef CPPCO_TRACE_BUFFER_SIZE
+#define CPPCO_TRACE_BUFFER_SIZE 16384
+#endif // CPPCO_TRACE_BUFFER_SIZE
+
+namespace co {
+namespace trace {
+
+/// `co::trace::event_kind` is the kind of a trace event.
+enum class event_kind : std::uint8_t
+{
+	/// A cothread was created for a `co::thread`.
+	create,
+	/// The OS thread switched from `cothread` to `target`.
+	switch_to,
+	/// The entry functor on `cothread` is being stopped.
+	stop,
+	/// The `co::thread` of `cothread` released it, by `reset()`, by changing its stack size or by its destructor.
+	reset,
+	/// The entry functor on `cothread` failed, and the OS thread switched to the parent `target`.
+	failure,
+};
+
+/// `co::trace::event` is a recorded trace event.
+struct event
+{
+	/// The time of the event in nanoseconds of `std::chrono::steady_clock`.
+	std::uint64_t timestamp;
+	event_kind kind;
+	/// The cothread the event is about.
+	const void* cothread;
+	/// The cothread switched to, or `nullptr`.
+	const void* target;
+};
+
+/// `co::trace::ring_buffer` holds the recent events of an OS thread.
+///
+/// Only its OS thread records into it, `co::trace::flush()` reads it from any OS thread. The slots are atomics, so an
+/// event overwritten while it is being read is detected and skipped instead of being torn.
+class ring_buffer
+{
+public:
+	static constexpr size_t capacity = CPPCO_TRACE_BUFFER_SIZE;
+	static_assert((capacity & (capacity - 1)) == 0, "CPPCO_TRACE_BUFFER_SIZE has to be a power of two");
+
+	/// \param index  The index of the OS thread, used as its thread id in the trace.
+	explicit ring_buffer(std::uint32_t index) noexcept;
+
+	ring_buffer(const ring_buffer& other) = delete;
+	ring_buffer& operator=(const ring_buffer& other) = delete;
+
+	/// Records an event. Only called by the owning OS thread.
+	void push(const event& e) noexcept;
+
+	/// Gets the events recorded since the last call and that have not been overwritten since.
+	std::vector<event> take();
+
+	std::uint32_t get_index() const noexcept;
+
+private:
+	struct slot
+	{
+		std::atomic<std::uint64_t> timestamp;
+		std::atomic<std::uint64_t> kind;
+		std::atomic<const void*> cothread;
+		std::atomic<const void*> target;
+	};
+
+	std::unique_ptr<slot[]> m_slots;
+	std::atomic<std::uint64_t> m_head;
+	std::uint64_t m_taken = 0;
+	std::uint32_t m_index;
+};
+
+/// `co::trace::record()` records an event into the ring buffer of the calling OS thread.
+///
+/// \param kind      The kind of the event.
+/// \param cothread  The cothread the event is about.
+/// \param target    The cothread switched to, or `nullptr`.
+void record(event_kind kind, const void* cothread, const void* target = nullptr) noexcept;
+
+/// `co::trace::flush()` writes the events recorded since the last flush as Chrome trace event JSON.
+///
+/// Each OS thread becomes a track, with a slice for every stretch of time a cothread ran on it and instant events for
+/// the creations, stops, resets and failures. The slice of the cothread that is still running when the events are
+/// flushed is left out. The ring buffers of OS threads that have exited are flushed as well,
+/// and dropped afterwards.
+///
+/// \param out  The stream to write to.
+void flush(std::ostream& out);
+
+/// `co::trace::clear()` drops the events recorded so far.
+void clear();
+
+} // namespace trace
+} // namespace co
+
+#include "trace.ipp"
+
+#endif // CO_TRACE_HPP_INCLUDE_GUARD
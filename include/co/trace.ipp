@@ -0,0 +1,289 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+
+#ifndef CO_TRACE_IPP_INCLUDE_GUARD
+#define CO_TRACE_IPP_INCLUDE_GUARD
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <ostream>
+#include <utility>
+
+namespace co {
+namespace trace {
+
+#ifdef __GNUC__
+constexpr size_t ring_buffer::capacity __attribute__((weak));
+#endif // __GNUC__
+
+inline ring_buffer::ring_buffer(std::uint32_t index) noexcept
+	: m_slots{ new slot[capacity] }
+	, m_head{ 0 }
+	, m_index{ index }
+{
+}
+
+inline void ring_buffer::push(const event& e) noexcept
+{
+	auto head = m_head.load(std::memory_order_relaxed);
+	// Pairs with the fence in `take()`: a reader that sees any part of this event also sees that the slot is reused.
+	std::atomic_thread_fence(std::memory_order_release);
+	auto&& s = m_slots[head & (capacity - 1)];
+	s.timestamp.store(e.timestamp, std::memory_order_relaxed);
+	s.kind.store(static_cast<std::uint64_t>(e.kind), std::memory_order_relaxed);
+	s.cothread.store(e.cothread, std::memory_order_relaxed);
+	s.target.store(e.target, std::memory_order_relaxed);
+	m_head.store(head + 1, std::memory_order_release);
+}
+
+inline std::vector<event> ring_buffer::take()
+{
+	auto head = m_head.load(std::memory_order_acquire);
+	auto first = std::max(m_taken, head > capacity ? head - capacity : 0);
+	auto events = std::vector<event>();
+	events.reserve(static_cast<size_t>(head - first));
+	for (auto i = first; i < head; ++i)
+	{
+		auto&& s = m_slots[i & (capacity - 1)];
+		events.push_back(event{
+			s.timestamp.load(std::memory_order_relaxed),
+			static_cast<event_kind>(s.kind.load(std::memory_order_relaxed)),
+			s.cothread.load(std::memory_order_relaxed),
+			s.target.load(std::memory_order_relaxed),
+		});
+	}
+	std::atomic_thread_fence(std::memory_order_acquire);
+	// Events whose slot the OS thread has started to reuse meanwhile may be torn.
+	auto reused = m_head.load(std::memory_order_relaxed);
+	auto valid = reused >= capacity ? reused - capacity + 1 : 0;
+	if (valid > first)
+	{
+		auto skipped = static_cast<size_t>(std::min(valid, head) - first);
+		events.erase(events.begin(), events.begin() + static_cast<std::ptrdiff_t>(skipped));
+	}
+	m_taken = head;
+	return events;
+}
+
+inline std::uint32_t ring_buffer::get_index() const noexcept
+{
+	return m_index;
+}
+
+namespace detail {
+
+struct registry
+{
+	std::mutex mutex;
+	std::vector<std::shared_ptr<ring_buffer>> buffers;
+	std::uint32_t next_index = 0;
+
+	static registry& instance()
+	{
+		static registry r;
+		return r;
+	}
+};
+
+/// The ring buffer of an OS thread. Constant initialized, so it is accessed without the guard of dynamic
+/// initialization.
+struct local_state
+{
+	ring_buffer* buffer;
+	/// Set once the OS thread destroys its `thread_local` variables. Events recorded by the destructors that run after
+	/// that are dropped.
+	bool retired;
+};
+
+inline local_state& local() noexcept
+{
+	static thread_local local_state state = { nullptr, false };
+	return state;
+}
+
+CPPCO_COLD inline ring_buffer* create_local_buffer() noexcept
+{
+	struct holder
+	{
+		std::shared_ptr<ring_buffer> buffer;
+
+		~holder()
+		{
+			local().buffer = nullptr;
+			local().retired = true;
+		}
+	};
+	CPPCO_TRY
+	{
+		auto&& r = registry::instance();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		static thread_local holder h;
+		h.buffer = std::make_shared<ring_buffer>(r.next_index++);
+		r.buffers.push_back(h.buffer);
+		return h.buffer.get();
+	}
+	CPPCO_CATCH(...)
+	{
+		// Tracing is best effort, the events of this OS thread are dropped.
+		local().retired = true;
+		return nullptr;
+	}
+}
+
+inline std::uint64_t now() noexcept
+{
+	auto time = std::chrono::steady_clock::now().time_since_epoch();
+	return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count());
+}
+
+struct json_writer
+{
+	std::ostream& out;
+	bool first;
+
+	explicit json_writer(std::ostream& out) noexcept
+		: out(out)
+		, first{ true }
+	{
+	}
+
+	void begin()
+	{
+		out << (first ? "\n" : ",\n");
+		first = false;
+	}
+
+	void address(const void* p)
+	{
+		out << "\"0x" << std::hex << reinterpret_cast<std::uintptr_t>(p) << std::dec << '"';
+	}
+
+	void timestamp(const char* name, std::uint64_t ns)
+	{
+		// Trace event times are microseconds.
+		out << ",\"" << name << "\":" << ns / 1000 << '.' << std::setw(3) << std::setfill('0') << ns % 1000;
+	}
+
+	void thread_name(std::uint32_t tid)
+	{
+		begin();
+		out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+			<< ",\"args\":{\"name\":\"OS thread " << tid << "\"}}";
+	}
+
+	void slice(std::uint32_t tid, const void* cothread, std::uint64_t begin_ns, std::uint64_t end_ns)
+	{
+		begin();
+		out << "{\"name\":";
+		address(cothread);
+		out << ",\"cat\":\"cothread\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid;
+		timestamp("ts", begin_ns);
+		timestamp("dur", end_ns - begin_ns);
+		out << '}';
+	}
+
+	void instant(std::uint32_t tid, const event& e)
+	{
+		static const char* const names[] = { "create", "switch", "stop", "reset", "failure" };
+		begin();
+		out << "{\"name\":\"" << names[static_cast<size_t>(e.kind)] << "\",\"cat\":\"cothread\",\"ph\":\"i\",\"s\":\"t\""
+			<< ",\"pid\":1,\"tid\":" << tid;
+		timestamp("ts", e.timestamp);
+		out << ",\"args\":{\"cothread\":";
+		address(e.cothread);
+		if (e.target != nullptr)
+		{
+			out << ",\"target\":";
+			address(e.target);
+		}
+		out << "}}";
+	}
+};
+
+} // namespace detail
+
+inline void record(event_kind kind, const void* cothread, const void* target) noexcept
+{
+	auto&& state = detail::local();
+	auto* buffer = state.buffer;
+	if (CPPCO_UNLIKELY(buffer == nullptr))
+	{
+		if (state.retired)
+		{
+			return;
+		}
+		buffer = state.buffer = detail::create_local_buffer();
+		if (buffer == nullptr)
+		{
+			return;
+		}
+	}
+	buffer->push(event{ detail::now(), kind, cothread, target });
+}
+
+inline void flush(std::ostream& out)
+{
+	auto&& r = detail::registry::instance();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	detail::json_writer writer(out);
+	out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+	for (auto&& buffer : r.buffers)
+	{
+		auto tid = buffer->get_index();
+		writer.thread_name(tid);
+		// A slice lasts from a switch to a cothread until the next switch away from the OS thread's running cothread.
+		const void* running = nullptr;
+		auto running_since = std::uint64_t{ 0 };
+		for (auto&& e : buffer->take())
+		{
+			if (e.kind != event_kind::switch_to)
+			{
+				writer.instant(tid, e);
+			}
+			if (e.kind == event_kind::switch_to || e.kind == event_kind::failure)
+			{
+				if (running != nullptr)
+				{
+					writer.slice(tid, running, running_since, e.timestamp);
+				}
+				running = e.target;
+				running_since = e.timestamp;
+			}
+		}
+	}
+	out << "\n]}\n";
+	// The buffers only referenced by the registry belong to OS threads that have exited.
+	r.buffers.erase(std::remove_if(r.buffers.begin(), r.buffers.end(), [](const std::shared_ptr<ring_buffer>& buffer)
+	{
+		return buffer.use_count() == 1;
+	}), r.buffers.end());
+}
+
+inline void clear()
+{
+	auto&& r = detail::registry::instance();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	for (auto&& buffer : r.buffers)
+	{
+		buffer->take();
+	}
+}
+
+} // namespace trace
+} // namespace co
+
+#endif // CO_TRACE_IPP_INCLUDE_GUARD
@@ -0,0 +1,127 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+#include "libco_mock.hpp"
+#include <co/basic_thread.hpp>
+#include "fixture.hpp"
+#include <type_traits>
+#include <utility>
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace cppco_test {
+
+namespace {
+
+constexpr size_t policy_stack_size = 64 * 1024;
+
+co::thread_pool& policy_pool()
+{
+	static co::thread_pool pool;
+	return pool;
+}
+
+struct pooled_policy : co::default_thread_policy
+{
+	static constexpr bool deferred = true;
+	static constexpr co::stop_mode stop = co::stop_mode::cooperative;
+	static constexpr size_t stack_size = policy_stack_size;
+
+	static co::stack_allocator* allocator() noexcept
+	{
+		return &policy_pool();
+	}
+};
+
+struct inline_policy : co::default_thread_policy
+{
+	static constexpr bool heap_entry = false;
+};
+
+} // namespace
+
+TEST_F(cppco, basic_thread_default_policy)
+{
+	auto cothread = co::basic_thread<co::default_thread_policy>();
+	EXPECT_FALSE(cothread);
+	EXPECT_EQ(cothread.get_stack_size(), co::thread::default_stack_size);
+	EXPECT_EQ(cothread.get_stop_mode(), co::stop_mode::unwind);
+	EXPECT_EQ(cothread.get_allocator(), nullptr);
+	EXPECT_FALSE(cothread.is_deferred());
+	EXPECT_EQ(&cothread.get_parent(), &co::active());
+}
+
+TEST_F(cppco, basic_thread_policy_applied)
+{
+	CPPCO_EXPECT_CREATE(_).Times(0);
+	auto& parent = co::active();
+	auto stopped = false;
+	{
+		auto cothread = co::basic_thread<pooled_policy>([&parent, &stopped]()
+		{
+			while (!co::stop_requested())
+			{
+				parent.switch_to();
+			}
+			stopped = true;
+		});
+		EXPECT_TRUE(cothread.is_deferred());
+		EXPECT_EQ(cothread.get_stop_mode(), co::stop_mode::cooperative);
+		EXPECT_EQ(cothread.get_allocator(), &policy_pool());
+		EXPECT_EQ(cothread.get_stack_size(), policy_stack_size);
+		libco_mock::api::verify();
+		CPPCO_EXPECT_CREATE(policy_stack_size).Times(1);
+		cothread.switch_to();
+		EXPECT_TRUE(cothread);
+	}
+	EXPECT_TRUE(stopped);
+	EXPECT_EQ(policy_pool().get_statistics(policy_stack_size).misses, 1u);
+	policy_pool().clear();
+}
+
+TEST_F(cppco, basic_thread_switch)
+{
+	auto& parent = co::active();
+	const co::thread* seen = nullptr;
+	auto cothread = co::basic_thread<inline_policy>([&parent, &seen]()
+	{
+		while (true)
+		{
+			seen = &co::active();
+			parent.switch_to();
+		}
+	});
+	cothread.switch_to();
+	EXPECT_EQ(seen, &cothread.get());
+	EXPECT_EQ(&co::active(), &parent);
+	auto moved = std::move(cothread);
+	moved.switch_to();
+	EXPECT_EQ(seen, &moved.get());
+	static_assert(co::thread::is_inline_entry<void (*)()>::value, "function pointers are stored inline");
+}
+
+TEST_F(cppco, basic_thread_not_a_thread)
+{
+	using thread_type = co::basic_thread<inline_policy>;
+	// The policy cannot be bypassed through the `co::thread`, it is only reachable as `const`.
+	static_assert(!std::is_convertible<thread_type&, co::thread&>::value, "co::basic_thread is not a co::thread");
+	static_assert(!std::is_constructible<co::thread, thread_type&&>::value, "co::basic_thread cannot be moved out");
+	static_assert(std::is_same<decltype(std::declval<thread_type&>().get()), const co::thread&>::value,
+		"co::basic_thread::get() returns a const co::thread");
+	auto cothread = thread_type([]() {});
+	auto child = co::thread([]() {}, cothread.get());
+	EXPECT_EQ(&child.get_parent(), &cothread.get());
+}
+
+} // namespace cppco_test
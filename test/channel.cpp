@@ -0,0 +1,121 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+#include "libco_mock.hpp"
+#include <co/channel.hpp>
+#include "fixture.hpp"
+#include <memory>
+#include <vector>
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace cppco_test {
+
+TEST_F(cppco, channel_buffered)
+{
+	EXPECT_CALL(libco_mock::api::get(), switch_to(_)).Times(10); // 8 in test, 2 in the destructor of the producer
+	co::channel<int> channel(16);
+	EXPECT_EQ(channel.get_capacity(), 16u);
+	co::thread producer([&channel]()
+	{
+		for (int i = 0; i < 64; ++i)
+		{
+			channel.send(i);
+		}
+		channel.close();
+		co::active().get_parent().switch_to();
+	});
+	channel.set_sender(producer);
+	auto result = std::vector<int>();
+	auto value = 0;
+	while (channel.recv(value))
+	{
+		result.push_back(value);
+	}
+	ASSERT_EQ(result.size(), 64u);
+	for (int i = 0; i < 64; ++i)
+	{
+		EXPECT_EQ(result[i], i);
+	}
+	EXPECT_TRUE(channel.closed());
+}
+
+TEST_F(cppco, channel_batch)
+{
+	co::channel<int> channel(5); // Rounded up to 8.
+	EXPECT_EQ(channel.get_capacity(), 8u);
+	auto result = std::vector<int>();
+	auto batches = 0;
+	co::thread consumer([&channel, &result, &batches]()
+	{
+		int values[8];
+		auto count = size_t{ 0 };
+		while ((count = channel.recv_batch(values, 8)) > 0)
+		{
+			result.insert(result.end(), values, values + count);
+			++batches;
+		}
+		co::active().get_parent().switch_to();
+	});
+	channel.set_receiver(consumer);
+	auto values = std::vector<int>();
+	for (int i = 0; i < 40; ++i)
+	{
+		values.push_back(i);
+	}
+	channel.send_batch(values.data(), values.size());
+	channel.close();
+	consumer.switch_to();
+	EXPECT_EQ(result, values);
+	EXPECT_EQ(batches, 5);
+}
+
+TEST_F(cppco, channel_unbuffered)
+{
+	co::channel<std::unique_ptr<int>> channel(0);
+	EXPECT_EQ(channel.get_capacity(), 0u);
+	int* sent = nullptr;
+	auto returned = false;
+	co::thread producer([&channel, &sent, &returned]()
+	{
+		auto value = std::unique_ptr<int>(new int(42));
+		sent = value.get();
+		channel.send(std::move(value));
+		returned = true;
+		co::active().get_parent().switch_to();
+	});
+	channel.set_sender(producer);
+	auto received = std::unique_ptr<int>();
+	ASSERT_TRUE(channel.recv(received));
+	EXPECT_EQ(received.get(), sent);
+	EXPECT_FALSE(returned); // The sender resumes only when the receiver switches to it.
+	producer.switch_to();
+	EXPECT_TRUE(returned);
+}
+
+TEST_F(cppco, channel_destroys_buffered_values)
+{
+	auto value = std::make_shared<int>(1);
+	{
+		co::channel<std::shared_ptr<int>> channel(4);
+		channel.send(value);
+		channel.send(value);
+		EXPECT_EQ(channel.size(), 2u);
+		EXPECT_EQ(value.use_count(), 3);
+	}
+	EXPECT_EQ(value.use_count(), 1);
+}
+
+} // namespace cppco_test
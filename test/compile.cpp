@@ -1,6 +1,14 @@
 #include <co.hpp>
+#include <co/basic_thread.hpp>
 #include <iostream>
 
+// A cothread type that only accepts inline entry functors.
+struct lean_policy : co::default_thread_policy
+{
+    static constexpr bool heap_entry = false;
+    static constexpr bool deferred = true;
+};
+
 int main()
 {
     using namespace std;
@@ -19,5 +27,14 @@ int main()
     cothread.switch_to();
 
     // Execution will resume here when `cothread` switches back to its parent.
+
+    // The same with a cothread type chosen at compile time.
+    auto lean = co::basic_thread<lean_policy>([&]()
+    {
+        cout << "Hello policy!" << endl;
+        co::active().get_parent().switch_to();
+    });
+    lean.switch_to();
+
     return 0;
 }
@@ -0,0 +1,111 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+#include "libco_mock.hpp"
+#include <co/executor.hpp>
+#include "fixture.hpp"
+#include <atomic>
+#include <stdexcept>
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace cppco_test {
+
+TEST_F(cppco, executor_runs_all_tasks)
+{
+	std::atomic<int> count{ 0 };
+	co::executor executor(2);
+	EXPECT_EQ(executor.get_worker_count(), 2u);
+	EXPECT_EQ(co::executor::current(), nullptr);
+	for (int i = 0; i < 1000; ++i)
+	{
+		executor.spawn([&count, &executor]()
+		{
+			EXPECT_EQ(co::executor::current(), &executor);
+			++count;
+		});
+	}
+	executor.wait();
+	EXPECT_EQ(count.load(), 1000);
+}
+
+TEST_F(cppco, executor_yield)
+{
+	std::atomic<int> count{ 0 };
+	co::executor executor(3);
+	for (int i = 0; i < 100; ++i)
+	{
+		executor.spawn([&count]()
+		{
+			// Each yield may resume the task on a different OS thread.
+			for (int j = 0; j < 10; ++j)
+			{
+				co::executor::yield();
+				++count;
+			}
+		});
+	}
+	executor.wait();
+	EXPECT_EQ(count.load(), 1000);
+}
+
+TEST_F(cppco, executor_spawn_from_task)
+{
+	std::atomic<int> count{ 0 };
+	co::executor executor(2);
+	executor.spawn([&count]()
+	{
+		for (int i = 0; i < 100; ++i)
+		{
+			co::executor::current()->spawn([&count]()
+			{
+				co::executor::yield();
+				++count;
+			});
+		}
+	});
+	executor.wait();
+	EXPECT_EQ(count.load(), 100);
+}
+
+TEST_F(cppco, executor_failure)
+{
+	std::atomic<int> count{ 0 };
+	co::executor executor(2);
+	executor.spawn([]()
+	{
+		co::executor::yield();
+		throw std::runtime_error("task failed");
+	});
+	for (int i = 0; i < 10; ++i)
+	{
+		executor.spawn([&count]()
+		{
+			co::executor::yield();
+			++count;
+		});
+	}
+	EXPECT_THROW(executor.wait(), std::runtime_error);
+	EXPECT_EQ(count.load(), 10);
+	// The failure is reported once, and the executor remains usable.
+	executor.spawn([&count]()
+	{
+		++count;
+	});
+	EXPECT_NO_THROW(executor.wait());
+	EXPECT_EQ(count.load(), 11);
+}
+
+} // namespace cppco_test
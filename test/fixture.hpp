@@ -21,6 +21,17 @@
 #include <thread>
 #include <memory>
 
+/// `CPPCO_EXPECT_CREATE(stack_size)` expects cothreads of `stack_size` to be created, and `CPPCO_EXPECT_DELETE(times)`
+/// expects `times` of them to be deleted. With `CPPCO_STACK_WATERMARK` the cothreads are derived with `co_derive` from
+/// `malloc`ed memory and freed with `std::free`, so `co_delete` must not be called at all then.
+#ifdef CPPCO_STACK_WATERMARK
+#define CPPCO_EXPECT_CREATE(stack_size) EXPECT_CALL(::libco_mock::api::get(), derive(_, stack_size, _))
+#define CPPCO_EXPECT_DELETE(times) EXPECT_CALL(::libco_mock::api::get(), delete_this(_)).Times(0)
+#else // CPPCO_STACK_WATERMARK
+#define CPPCO_EXPECT_CREATE(stack_size) EXPECT_CALL(::libco_mock::api::get(), create(stack_size, _))
+#define CPPCO_EXPECT_DELETE(times) EXPECT_CALL(::libco_mock::api::get(), delete_this(_)).Times(times)
+#endif // CPPCO_STACK_WATERMARK
+
 namespace cppco_test {
 
 using namespace ::testing;
@@ -0,0 +1,156 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+#include "libco_mock.hpp"
+#include <co/future.hpp>
+#include "fixture.hpp"
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace cppco_test {
+
+TEST_F(cppco, future_ready)
+{
+	co::promise<int> promise;
+	auto future = promise.get_future();
+	EXPECT_TRUE(future.valid());
+	EXPECT_FALSE(future.ready());
+	promise.set_value(42);
+	EXPECT_TRUE(future.ready());
+	EXPECT_EQ(future.get(), 42);
+	EXPECT_FALSE(future.valid());
+}
+
+TEST_F(cppco, future_thread_waits)
+{
+	co::promise<std::string> promise;
+	auto events = std::vector<std::string>();
+	auto consumer = co::thread([&promise, &events]()
+	{
+		auto future = promise.get_future();
+		events.push_back("waiting");
+		events.push_back(future.get());
+		co::active().get_parent().switch_to();
+	});
+	consumer.switch_to();
+	EXPECT_EQ(events, std::vector<std::string>({ "waiting" }));
+	// Switching to the waiting cothread before the value is set does not end the wait.
+	consumer.switch_to();
+	EXPECT_EQ(events.size(), 1u);
+	promise.set_value("value");
+	EXPECT_EQ(events, std::vector<std::string>({ "waiting", "value" }));
+}
+
+TEST_F(cppco, future_thread_exception)
+{
+	co::promise<int> promise;
+	auto caught = std::string();
+	auto consumer = co::thread([&promise, &caught]()
+	{
+		auto future = promise.get_future();
+		try
+		{
+			future.get();
+		}
+		catch (const std::runtime_error& e)
+		{
+			caught = e.what();
+		}
+		co::active().get_parent().switch_to();
+	});
+	consumer.switch_to();
+	promise.set_exception(std::make_exception_ptr(std::runtime_error("failed")));
+	EXPECT_EQ(caught, "failed");
+}
+
+TEST_F(cppco, future_scheduler)
+{
+	co::scheduler scheduler(64 * 1024);
+	co::promise<std::unique_ptr<int>> promise;
+	auto future = promise.get_future();
+	auto events = std::vector<int>();
+	scheduler.spawn([&future, &events]()
+	{
+		events.push_back(1);
+		auto value = future.get();
+		events.push_back(*value);
+	});
+	scheduler.spawn([&promise, &events]()
+	{
+		events.push_back(2);
+		promise.set_value(new int(3));
+		// The waiting task is resumed by the scheduler, not switched to.
+		events.push_back(4);
+	});
+	scheduler.run();
+	EXPECT_EQ(events, std::vector<int>({ 1, 2, 4, 3 }));
+}
+
+TEST_F(cppco, future_scheduler_exception)
+{
+	co::scheduler scheduler(64 * 1024);
+	co::promise<void> promise;
+	auto future = promise.get_future();
+	auto thrown = false;
+	scheduler.spawn([&future, &thrown]()
+	{
+		try
+		{
+			future.get();
+		}
+		catch (const std::logic_error&)
+		{
+			thrown = true;
+		}
+	});
+	scheduler.spawn([&promise]()
+	{
+		promise.set_exception(std::make_exception_ptr(std::logic_error("failed")));
+	});
+	scheduler.run();
+	EXPECT_TRUE(thrown);
+}
+
+TEST_F(cppco, future_broken_promise)
+{
+	auto future = co::future<void>();
+	{
+		co::promise<void> promise;
+		future = promise.get_future();
+	}
+	EXPECT_TRUE(future.ready());
+	EXPECT_THROW(future.get(), co::broken_promise);
+}
+
+TEST_F(cppco, future_stopped_waiter)
+{
+	co::promise<int> promise;
+	{
+		auto consumer = co::thread([&promise]()
+		{
+			auto future = promise.get_future();
+			future.get();
+		});
+		consumer.switch_to();
+	}
+	// The waiting cothread is gone, so there is nothing to switch to.
+	promise.set_value(1);
+}
+
+} // namespace cppco_test
@@ -0,0 +1,126 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+#include "libco_mock.hpp"
+#include <co/generator.hpp>
+#include "fixture.hpp"
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace cppco_test {
+
+TEST_F(cppco, generator_range)
+{
+	co::generator<int> numbers([](co::generator<int>::sink& yield)
+	{
+		for (int i = 0; i < 5; ++i)
+		{
+			yield(i);
+		}
+	});
+	auto result = std::vector<int>();
+	for (auto&& number : numbers)
+	{
+		result.push_back(number);
+	}
+	EXPECT_EQ(result, std::vector<int>({ 0, 1, 2, 3, 4 }));
+	EXPECT_TRUE(numbers.done());
+	EXPECT_FALSE(numbers.next());
+}
+
+TEST_F(cppco, generator_zero_copy)
+{
+	auto values = std::vector<std::string>({ "a", "b" });
+	co::generator<const std::string> strings([&values](co::generator<const std::string>::sink& yield)
+	{
+		for (auto&& value : values)
+		{
+			yield(value);
+		}
+	});
+	ASSERT_TRUE(strings.next());
+	EXPECT_EQ(&strings.value(), &values[0]);
+	ASSERT_TRUE(strings.next());
+	EXPECT_EQ(&strings.value(), &values[1]);
+	EXPECT_FALSE(strings.next());
+}
+
+TEST_F(cppco, generator_exception)
+{
+	co::generator<int> failing([](co::generator<int>::sink& yield)
+	{
+		yield(1);
+		throw std::runtime_error("producer failed");
+	});
+	ASSERT_TRUE(failing.next());
+	EXPECT_EQ(failing.value(), 1);
+	EXPECT_THROW(failing.next(), std::runtime_error);
+	EXPECT_TRUE(failing.done());
+	EXPECT_FALSE(failing.next());
+}
+
+TEST_F(cppco, generator_rewind)
+{
+	CPPCO_EXPECT_CREATE(_).Times(1);
+	auto destroyed = 0;
+	co::generator<int> numbers([&destroyed](co::generator<int>::sink& yield)
+	{
+		struct guard
+		{
+			int& destroyed;
+			~guard() { ++destroyed; }
+		} g{ destroyed };
+		for (int i = 0; i < 3; ++i)
+		{
+			yield(i);
+		}
+	});
+	ASSERT_TRUE(numbers.next());
+	ASSERT_TRUE(numbers.next());
+	EXPECT_EQ(numbers.value(), 1);
+	// The suspended producer is unwound, and then starts over on the same cothread.
+	numbers.rewind();
+	EXPECT_EQ(destroyed, 1);
+	auto result = std::vector<int>(numbers.begin(), numbers.end());
+	EXPECT_EQ(result, std::vector<int>({ 0, 1, 2 }));
+	EXPECT_EQ(destroyed, 2);
+	numbers.rewind();
+	EXPECT_EQ(std::vector<int>(numbers.begin(), numbers.end()), result);
+}
+
+TEST_F(cppco, generator_consumed_from_cothread)
+{
+	co::generator<int> numbers([](co::generator<int>::sink& yield)
+	{
+		yield(1);
+		yield(2);
+	});
+	auto sum = 0;
+	co::thread consumer([&numbers, &sum]()
+	{
+		for (auto&& number : numbers)
+		{
+			sum += number;
+		}
+		co::active().get_parent().switch_to();
+	});
+	consumer.switch_to();
+	EXPECT_EQ(sum, 3);
+}
+
+} // namespace cppco_test
@@ -0,0 +1,184 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+#include "libco_mock.hpp"
+#include <co/io.hpp>
+#include "fixture.hpp"
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace cppco_test {
+
+TEST_F(cppco, io_socketpair)
+{
+	int fds[2];
+	ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+	co::io::reactor reactor;
+	co::scheduler scheduler;
+	auto received = std::string();
+	auto waited = size_t{ 0 };
+	scheduler.spawn([&fds, &received]()
+	{
+		char buffer[16];
+		auto result = co::io::read(fds[0], buffer, sizeof(buffer));
+		ASSERT_GT(result, 0);
+		received.assign(buffer, static_cast<size_t>(result));
+	});
+	scheduler.spawn([&fds, &reactor, &waited]()
+	{
+		co::yield();
+		waited = reactor.waiting();
+		EXPECT_EQ(co::io::write(fds[1], "hello", 5), 5);
+	});
+	reactor.run(scheduler);
+	EXPECT_EQ(waited, 1u);
+	EXPECT_EQ(received, "hello");
+	EXPECT_EQ(reactor.waiting(), 0u);
+	EXPECT_EQ(scheduler.size(), 0u);
+	co::io::close(fds[0]);
+	co::io::close(fds[1]);
+}
+
+TEST_F(cppco, io_pipe_backpressure)
+{
+	int fds[2];
+	ASSERT_EQ(pipe2(fds, O_NONBLOCK), 0);
+	co::io::reactor reactor;
+	co::scheduler scheduler;
+	// Much more than the capacity of a pipe, so the writer has to wait for the reader.
+	auto payload = std::vector<char>(1024 * 1024);
+	for (size_t i = 0; i < payload.size(); ++i)
+	{
+		payload[i] = static_cast<char>(i * 7);
+	}
+	auto received = std::vector<char>();
+	scheduler.spawn([&fds, &payload]()
+	{
+		auto written = size_t{ 0 };
+		while (written < payload.size())
+		{
+			auto result = co::io::write(fds[1], payload.data() + written, payload.size() - written);
+			ASSERT_GT(result, 0);
+			written += static_cast<size_t>(result);
+		}
+		co::io::close(fds[1]);
+	});
+	scheduler.spawn([&fds, &received]()
+	{
+		char buffer[4096];
+		while (true)
+		{
+			auto result = co::io::read(fds[0], buffer, sizeof(buffer));
+			ASSERT_GE(result, 0);
+			if (result == 0)
+			{
+				break;
+			}
+			received.insert(received.end(), buffer, buffer + result);
+		}
+		co::io::close(fds[0]);
+	});
+	reactor.run(scheduler);
+	EXPECT_EQ(received, payload);
+}
+
+TEST_F(cppco, io_loopback_echo)
+{
+	auto listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	ASSERT_GE(listener, 0);
+	auto address = sockaddr_in{};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = 0;
+	ASSERT_EQ(bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+	ASSERT_EQ(listen(listener, 16), 0);
+	auto length = static_cast<socklen_t>(sizeof(address));
+	ASSERT_EQ(getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length), 0);
+
+	co::io::reactor reactor;
+	co::scheduler scheduler;
+	auto reply = std::string();
+	scheduler.spawn([listener]()
+	{
+		auto connection = co::io::accept(listener, nullptr, nullptr);
+		ASSERT_GE(connection, 0);
+		char buffer[16];
+		auto result = co::io::read(connection, buffer, sizeof(buffer));
+		ASSERT_GT(result, 0);
+		EXPECT_EQ(co::io::write(connection, buffer, static_cast<size_t>(result)), result);
+		co::io::close(connection);
+	});
+	scheduler.spawn([&address, &reply]()
+	{
+		auto connection = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+		ASSERT_GE(connection, 0);
+		ASSERT_EQ(co::io::connect(connection, reinterpret_cast<const sockaddr*>(&address), sizeof(address)), 0);
+		EXPECT_EQ(co::io::write(connection, "ping", 4), 4);
+		char buffer[16];
+		auto result = co::io::read(connection, buffer, sizeof(buffer));
+		ASSERT_GT(result, 0);
+		reply.assign(buffer, static_cast<size_t>(result));
+		co::io::close(connection);
+	});
+	reactor.run(scheduler);
+	EXPECT_EQ(reply, "ping");
+	co::io::close(listener);
+}
+
+TEST_F(cppco, io_outside_of_reactor)
+{
+	int fds[2];
+	ASSERT_EQ(pipe2(fds, O_NONBLOCK), 0);
+	char buffer[4];
+	errno = 0;
+	EXPECT_EQ(co::io::read(fds[0], buffer, sizeof(buffer)), -1);
+	EXPECT_EQ(errno, EAGAIN);
+	co::io::close(fds[0]);
+	co::io::close(fds[1]);
+}
+
+TEST_F(cppco, io_deadline)
+{
+	int fds[2];
+	ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+	co::io::reactor reactor;
+	co::timer_wheel wheel;
+	co::scheduler scheduler;
+	auto result = ssize_t{ 0 };
+	auto error = 0;
+	scheduler.spawn([&fds, &wheel, &result, &error]()
+	{
+		co::timer_wheel::timer deadline;
+		wheel.arm(deadline, co::timer_wheel::clock::now() + std::chrono::milliseconds(20));
+		char buffer[16];
+		result = co::io::read(fds[0], buffer, sizeof(buffer), deadline);
+		error = errno;
+	});
+	reactor.run(scheduler, wheel);
+	EXPECT_EQ(result, -1);
+	EXPECT_EQ(error, ETIMEDOUT);
+	EXPECT_EQ(reactor.waiting(), 0u);
+	co::io::close(fds[0]);
+	co::io::close(fds[1]);
+}
+
+} // namespace cppco_test
@@ -50,13 +50,18 @@ protected:
 		ON_CALL(*this, derive(_, _, _)).WillByDefault(Invoke(co_derive));
 		ON_CALL(*this, create(_, _)).WillByDefault(Invoke(co_create));
 		ON_CALL(*this, delete_this(_)).WillByDefault(Invoke(co_delete));
-		ON_CALL(*this, switch_to(_)).WillByDefault(Invoke([this](){ m_call_switch = true; })); // We can't directly call `co_switch` because GMock runs extra code in destructors that would not run.
+		ON_CALL(*this, switch_to(_)).WillByDefault(Invoke([](){ call_switch() = true; })); // We can't directly call `co_switch` because GMock runs extra code in destructors that would not run.
 		ON_CALL(*this, serializable()).WillByDefault(Invoke(co_serializable));
 
 	}
 	~api() = default;
 private:
-	bool m_call_switch = false;
+	// Per OS thread, as cothreads may be switched to concurrently on several OS threads.
+	static bool& call_switch() noexcept
+	{
+		static thread_local bool instance = false;
+		return instance;
+	}
 	friend void switch_to(cothread_t p) noexcept;
 };
 
@@ -79,7 +84,7 @@ inline void delete_this(cothread_t p) noexcept
 inline void switch_to(cothread_t p) noexcept
 {
 	api::get().switch_to(p);
-	if (std::exchange(api::get().m_call_switch, false))
+	if (std::exchange(api::call_switch(), false))
 	{
 		co_switch(p);
 	}
@@ -0,0 +1,179 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+#include "libco_mock.hpp"
+#include "fixture.hpp"
+#include <co/local.hpp>
+#include <memory>
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace cppco_test {
+
+namespace {
+
+/// Counts its constructions and destructions.
+struct tracked
+{
+	static int constructed;
+	static int destroyed;
+
+	int value;
+
+	explicit tracked(int value = 0) noexcept
+		: value{ value }
+	{
+		++constructed;
+	}
+	~tracked()
+	{
+		++destroyed;
+	}
+
+	tracked(const tracked& other) = delete;
+	tracked& operator=(const tracked& other) = delete;
+};
+
+int tracked::constructed = 0;
+int tracked::destroyed = 0;
+
+void reset_tracked()
+{
+	tracked::constructed = 0;
+	tracked::destroyed = 0;
+}
+
+} // namespace
+
+TEST_F(cppco, local_per_cothread)
+{
+	co::local<int> value;
+	auto& parent = co::active();
+	auto make = [&parent, &value](int start)
+	{
+		return [&parent, &value, start]()
+		{
+			*value = start;
+			while (true)
+			{
+				++*value;
+				parent.switch_to(int{ *value });
+			}
+		};
+	};
+	auto a = co::thread(make(10));
+	auto b = co::thread(make(20));
+	*value = 1;
+	a.switch_to();
+	EXPECT_EQ(co::receive<int>(), 11);
+	b.switch_to();
+	EXPECT_EQ(co::receive<int>(), 21);
+	a.switch_to();
+	EXPECT_EQ(co::receive<int>(), 12);
+	EXPECT_EQ(*value, 1);
+}
+
+TEST_F(cppco, local_lazy)
+{
+	reset_tracked();
+	co::local<tracked> value;
+	auto& parent = co::active();
+	auto found = true;
+	auto cothread = co::thread([&parent, &value, &found]()
+	{
+		found = value.find() != nullptr;
+		parent.switch_to();
+		value->value = 7;
+		parent.switch_to();
+	});
+	cothread.switch_to();
+	EXPECT_FALSE(found);
+	EXPECT_EQ(tracked::constructed, 0);
+	cothread.switch_to();
+	EXPECT_EQ(tracked::constructed, 1);
+	EXPECT_EQ(value.find(), nullptr);
+}
+
+TEST_F(cppco, local_destroyed_with_cothread)
+{
+	reset_tracked();
+	co::local<tracked> value;
+	auto& parent = co::active();
+	auto entry = [&parent, &value]()
+	{
+		value.emplace(3);
+		parent.switch_to();
+	};
+	{
+		auto cothread = co::thread(entry);
+		cothread.switch_to();
+		EXPECT_EQ(tracked::destroyed, 0);
+	}
+	EXPECT_EQ(tracked::destroyed, 1);
+	auto cothread = co::thread(entry);
+	cothread.switch_to();
+	cothread.reset(entry);
+	EXPECT_EQ(tracked::destroyed, 2);
+	cothread.switch_to();
+	cothread.rewind();
+	EXPECT_EQ(tracked::destroyed, 3);
+	cothread.switch_to();
+	cothread.reset();
+	EXPECT_EQ(tracked::destroyed, 4);
+	EXPECT_EQ(tracked::constructed, 4);
+}
+
+TEST_F(cppco, local_emplace_and_reset)
+{
+	reset_tracked();
+	co::local<tracked> value;
+	EXPECT_EQ(value.emplace(1).value, 1);
+	EXPECT_EQ(value.emplace(2).value, 2);
+	EXPECT_EQ(tracked::destroyed, 1);
+	EXPECT_EQ(value->value, 2);
+	value.reset();
+	EXPECT_EQ(tracked::destroyed, 2);
+	EXPECT_EQ(value.find(), nullptr);
+	value.reset();
+	EXPECT_EQ(tracked::destroyed, 2);
+}
+
+TEST_F(cppco, local_reused_slot)
+{
+	reset_tracked();
+	auto& parent = co::active();
+	auto first = std::unique_ptr<co::local<tracked>>(new co::local<tracked>());
+	co::local<int>* second = nullptr;
+	auto stale = true;
+	auto cothread = co::thread([&parent, &first, &second, &stale]()
+	{
+		first->emplace(5);
+		parent.switch_to();
+		stale = second->find() != nullptr;
+		second->emplace(6);
+		parent.switch_to();
+	});
+	cothread.switch_to();
+	// The slot of the destroyed `co::local` is handed to the next one, which must not see the stale value.
+	first.reset();
+	co::local<int> next;
+	second = &next;
+	EXPECT_EQ(tracked::destroyed, 0);
+	cothread.switch_to();
+	EXPECT_FALSE(stale);
+	EXPECT_EQ(tracked::destroyed, 1);
+}
+
+} // namespace cppco_test
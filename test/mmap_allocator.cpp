@@ -0,0 +1,88 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+#include "libco_mock.hpp"
+#include <co/mmap_allocator.hpp>
+#include "fixture.hpp"
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace cppco_test {
+
+TEST_F(cppco, mmap_allocator_thread)
+{
+	co::mmap_allocator allocator;
+	EXPECT_EQ(allocator.get_guard_size(), co::mmap_allocator::page_size());
+	EXPECT_CALL(libco_mock::api::get(), create(_, _)).Times(0);
+	EXPECT_CALL(libco_mock::api::get(), derive(_, _, _)).Times(1);
+	EXPECT_CALL(libco_mock::api::get(), delete_this(_)).Times(0);
+	auto& parent = co::active();
+	auto ran = false;
+	{
+		auto cothread = co::thread([&parent, &ran]()
+		{
+			// Deep enough to touch more than one page of the stack.
+			volatile char buffer[16 * 1024];
+			buffer[0] = 1;
+			ran = buffer[0] == 1;
+			parent.switch_to();
+		}, 64 * 1024, allocator);
+		EXPECT_EQ(allocator.get_reserved(), 64 * 1024 + allocator.get_guard_size());
+		cothread.switch_to();
+	}
+	EXPECT_TRUE(ran);
+	EXPECT_EQ(allocator.get_reserved(), 0u);
+}
+
+TEST_F(cppco, mmap_allocator_rounds_to_pages)
+{
+	co::mmap_allocator allocator(0);
+	EXPECT_EQ(allocator.get_guard_size(), 0u);
+	auto stack_size = 64 * 1024 + 1;
+	auto cothread = allocator.allocate(stack_size, []() {});
+	ASSERT_NE(cothread, nullptr);
+	EXPECT_EQ(allocator.get_reserved() % co::mmap_allocator::page_size(), 0u);
+	EXPECT_GE(allocator.get_reserved(), static_cast<size_t>(stack_size));
+	allocator.deallocate(cothread, stack_size);
+	EXPECT_EQ(allocator.get_reserved(), 0u);
+}
+
+TEST_F(cppco, mmap_allocator_guard_page)
+{
+	co::mmap_allocator allocator;
+	auto cothread = allocator.allocate(64 * 1024, []() {});
+	ASSERT_NE(cothread, nullptr);
+	auto* below = static_cast<volatile char*>(cothread) - 1;
+	EXPECT_DEATH(*below = 0, "");
+	allocator.deallocate(cothread, 64 * 1024);
+}
+
+TEST_F(cppco, mmap_allocator_pool_upstream)
+{
+	co::mmap_allocator allocator;
+	co::thread_pool pool(co::thread_pool::default_max_retained, &allocator);
+	EXPECT_CALL(libco_mock::api::get(), derive(_, _, _)).Times(1);
+	{
+		auto cothread = co::thread([]() {}, 64 * 1024, pool);
+	}
+	{
+		auto cothread = co::thread([]() {}, 64 * 1024, pool);
+	}
+	EXPECT_NE(allocator.get_reserved(), 0u);
+	pool.clear();
+	EXPECT_EQ(allocator.get_reserved(), 0u);
+}
+
+} // namespace cppco_test
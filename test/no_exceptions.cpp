@@ -0,0 +1,176 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+
+#include "libco_mock.hpp"
+#include "fixture.hpp"
+#include <co/scheduler.hpp>
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <vector>
+
+namespace cppco_test {
+
+namespace {
+
+class destruction_flag
+{
+public:
+	explicit destruction_flag(bool& destructed) noexcept
+		: m_destructed{ &destructed }
+	{
+	}
+	~destruction_flag()
+	{
+		*m_destructed = true;
+	}
+private:
+	bool* m_destructed;
+};
+
+} // namespace
+
+TEST_F(cppco, no_exceptions_try_create)
+{
+	auto error = co::make_error_code(co::errc::create_failure);
+	auto& parent = co::active();
+	auto switched = false;
+	auto cothread = co::thread::try_create(error, [&parent, &switched]()
+	{
+		switched = true;
+		parent.switch_to();
+	});
+	EXPECT_FALSE(error);
+	cothread.switch_to();
+	EXPECT_TRUE(switched);
+	EXPECT_TRUE(cothread);
+}
+
+TEST_F(cppco, no_exceptions_try_create_failure)
+{
+	EXPECT_CALL(libco_mock::api::get(), create(_, _)).WillOnce(Return(nullptr));
+	auto error = std::error_code();
+	auto cothread = co::thread::try_create(error, []() {});
+	EXPECT_EQ(error, co::errc::create_failure);
+	EXPECT_EQ(&error.category(), &co::error_category());
+	EXPECT_STREQ(error.category().name(), "cppco");
+}
+
+TEST_F(cppco, no_exceptions_cooperative_by_default)
+{
+	auto destructed = false;
+	auto& parent = co::active();
+	auto cothread = co::thread([&parent, &destructed]()
+	{
+		destruction_flag flag(destructed);
+		while (!co::stop_requested())
+		{
+			parent.switch_to();
+		}
+	});
+	EXPECT_EQ(cothread.get_stop_mode(), co::stop_mode::cooperative);
+	cothread.switch_to();
+	EXPECT_FALSE(destructed);
+	cothread.reset();
+	EXPECT_TRUE(destructed);
+}
+
+TEST_F(cppco, no_exceptions_unwind_aborts)
+{
+	auto& parent = co::active();
+	auto cothread = co::thread([&parent]()
+	{
+		parent.switch_to();
+	});
+	cothread.set_stop_mode(co::stop_mode::unwind);
+	cothread.switch_to();
+	EXPECT_DEATH(cothread.reset(), "co::stop_mode::unwind needs exceptions");
+	cothread.set_stop_mode(co::stop_mode::cooperative);
+}
+
+TEST_F(cppco, no_exceptions_abandon)
+{
+	auto destructed = false;
+	auto& parent = co::active();
+	auto cothread = co::thread([&parent, &destructed]()
+	{
+		destruction_flag flag(destructed);
+		parent.switch_to();
+	});
+	cothread.set_stop_mode(co::stop_mode::abandon);
+	cothread.switch_to();
+	cothread.reset();
+	EXPECT_FALSE(cothread);
+	EXPECT_FALSE(destructed);
+}
+
+TEST_F(cppco, no_exceptions_try_catch_else)
+{
+	auto branch = 0;
+	auto condition = false;
+	if (condition)
+		CPPCO_TRY
+		{
+			branch = 1;
+		}
+		CPPCO_CATCH(...)
+		{
+			branch = 2;
+		}
+	else
+		branch = 3;
+	EXPECT_EQ(branch, 3);
+}
+
+TEST_F(cppco, no_exceptions_try_switch_to)
+{
+	auto& parent = co::active();
+	auto cothread = co::thread([&parent]()
+	{
+		parent.switch_to();
+	});
+	EXPECT_FALSE(cothread.try_switch_to());
+	EXPECT_EQ(cothread.try_switch_to(), co::errc::return_failure);
+}
+
+TEST_F(cppco, no_exceptions_return_aborts)
+{
+	EXPECT_DEATH(
+	{
+		auto cothread = co::thread([]() {});
+		cothread.switch_to();
+	}, "Return from entry function");
+}
+
+TEST_F(cppco, no_exceptions_scheduler)
+{
+	auto order = std::vector<int>();
+	co::scheduler scheduler;
+	scheduler.spawn([&order]()
+	{
+		order.push_back(1);
+		co::yield();
+		order.push_back(3);
+	});
+	scheduler.spawn([&order]()
+	{
+		order.push_back(2);
+	});
+	scheduler.run();
+	EXPECT_EQ(order, (std::vector<int>{ 1, 2, 3 }));
+	EXPECT_EQ(scheduler.size(), 0u);
+}
+
+} // namespace cppco_test
@@ -0,0 +1,178 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+#include "libco_mock.hpp"
+#include <co/nursery.hpp>
+#include "fixture.hpp"
+#include <stdexcept>
+#include <vector>
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace cppco_test {
+
+namespace {
+
+constexpr size_t child_stack_size = 64 * 1024;
+
+void yield_to_owner()
+{
+	co::active().get_parent().switch_to();
+}
+
+struct destructor_counter
+{
+	int& destroyed;
+	~destructor_counter()
+	{
+		++destroyed;
+	}
+};
+
+} // namespace
+
+TEST_F(cppco, nursery_join_interleaves)
+{
+	co::nursery nursery(child_stack_size);
+	EXPECT_EQ(&nursery.get_owner(), &co::active());
+	auto order = std::vector<int>();
+	for (auto id = 0; id < 3; ++id)
+	{
+		nursery.spawn([&order, id]()
+		{
+			for (auto i = 0; i <= id; ++i)
+			{
+				order.push_back(id);
+				yield_to_owner();
+			}
+		});
+	}
+	EXPECT_EQ(nursery.size(), 3u);
+	nursery.join();
+	EXPECT_EQ(nursery.size(), 0u);
+	EXPECT_EQ(order, std::vector<int>({ 0, 1, 2, 1, 2, 2 }));
+}
+
+TEST_F(cppco, nursery_join_switches)
+{
+	// One switch to each child and one back to the owner when it finishes. Releasing the finished children does not
+	// switch to them again.
+	EXPECT_CALL(libco_mock::api::get(), switch_to(_)).Times(6);
+	co::nursery nursery(child_stack_size);
+	auto finished = 0;
+	for (auto id = 0; id < 3; ++id)
+	{
+		nursery.spawn([&finished]()
+		{
+			++finished;
+		});
+	}
+	nursery.join();
+	EXPECT_EQ(finished, 3);
+}
+
+TEST_F(cppco, nursery_failure_cancels_siblings)
+{
+	co::nursery nursery(child_stack_size);
+	auto destroyed = 0;
+	auto resumed = 0;
+	for (auto id = 0; id < 2; ++id)
+	{
+		nursery.spawn([&destroyed, &resumed]()
+		{
+			destructor_counter counter{ destroyed };
+			while (true)
+			{
+				yield_to_owner();
+				++resumed;
+			}
+		});
+	}
+	nursery.spawn([]()
+	{
+		yield_to_owner();
+		throw std::runtime_error("failure");
+	});
+	EXPECT_THROW(nursery.join(), std::runtime_error);
+	EXPECT_EQ(nursery.size(), 0u);
+	EXPECT_EQ(resumed, 2);
+	EXPECT_EQ(destroyed, 2);
+}
+
+TEST_F(cppco, nursery_abandon_cancel_mode)
+{
+	co::nursery nursery(child_stack_size, co::stop_mode::abandon);
+	auto destroyed = 0;
+	nursery.spawn([&destroyed]()
+	{
+		destructor_counter counter{ destroyed };
+		while (true)
+		{
+			yield_to_owner();
+		}
+	});
+	nursery.spawn([]()
+	{
+		throw std::runtime_error("failure");
+	});
+	EXPECT_THROW(nursery.join(), std::runtime_error);
+	// The stack of the abandoned child is not unwound.
+	EXPECT_EQ(destroyed, 0);
+}
+
+TEST_F(cppco, nursery_children_spawn_siblings)
+{
+	co::nursery nursery(child_stack_size);
+	auto order = std::vector<int>();
+	nursery.spawn([&nursery, &order]()
+	{
+		order.push_back(0);
+		nursery.spawn([&order]()
+		{
+			order.push_back(2);
+		});
+		yield_to_owner();
+		order.push_back(1);
+	});
+	nursery.join();
+	EXPECT_EQ(order, std::vector<int>({ 0, 2, 1 }));
+	// Released children are reused by later spawns.
+	nursery.spawn([&order]()
+	{
+		order.push_back(3);
+	});
+	nursery.join();
+	EXPECT_EQ(order, std::vector<int>({ 0, 2, 1, 3 }));
+}
+
+TEST_F(cppco, nursery_destructor_cancels)
+{
+	// Children that never ran are released without switching to them.
+	EXPECT_CALL(libco_mock::api::get(), switch_to(_)).Times(0);
+	auto started = 0;
+	{
+		co::nursery nursery(child_stack_size);
+		for (auto id = 0; id < 2; ++id)
+		{
+			nursery.spawn([&started]()
+			{
+				++started;
+			});
+		}
+		EXPECT_EQ(nursery.size(), 2u);
+	}
+	EXPECT_EQ(started, 0);
+}
+
+} // namespace cppco_test
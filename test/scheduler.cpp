@@ -0,0 +1,190 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+#include "libco_mock.hpp"
+#include <co/scheduler.hpp>
+#include "fixture.hpp"
+#include <vector>
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace cppco_test {
+
+TEST_F(cppco, scheduler_round_robin)
+{
+	auto trace = std::vector<int>();
+	co::scheduler scheduler;
+	for (int i = 0; i < 3; ++i)
+	{
+		scheduler.spawn([&trace, i]()
+		{
+			trace.push_back(i);
+			co::yield();
+			trace.push_back(i);
+		});
+	}
+	EXPECT_EQ(scheduler.size(), 3u);
+	scheduler.run();
+	EXPECT_EQ(trace, std::vector<int>({ 0, 1, 2, 0, 1, 2 }));
+	EXPECT_EQ(scheduler.size(), 0u);
+	EXPECT_EQ(co::scheduler::current(), nullptr);
+}
+
+TEST_F(cppco, scheduler_priority)
+{
+	auto trace = std::vector<int>();
+	co::scheduler scheduler;
+	scheduler.spawn([&trace]()
+	{
+		trace.push_back(0);
+		co::yield();
+		trace.push_back(0);
+	}, co::scheduler::default_priority - 1);
+	scheduler.spawn([&trace]()
+	{
+		trace.push_back(1);
+		co::yield(); // No other task of the same or higher priority, so this returns immediately.
+		trace.push_back(1);
+	}, co::scheduler::default_priority + 1);
+	scheduler.run();
+	EXPECT_EQ(trace, std::vector<int>({ 1, 1, 0, 0 }));
+}
+
+TEST_F(cppco, scheduler_suspend_resume)
+{
+	auto trace = std::vector<int>();
+	auto waiter = co::scheduler::handle();
+	co::scheduler scheduler;
+	waiter = scheduler.spawn([&trace]()
+	{
+		trace.push_back(0);
+		co::suspend();
+		trace.push_back(0);
+	});
+	scheduler.spawn([&trace, &waiter]()
+	{
+		trace.push_back(1);
+		co::resume(waiter);
+		co::yield();
+		trace.push_back(1);
+	});
+	scheduler.run();
+	EXPECT_EQ(trace, std::vector<int>({ 0, 1, 0, 1 }));
+	co::resume(waiter); // The task has finished, so this has no effect.
+	EXPECT_EQ(scheduler.size(), 0u);
+}
+
+TEST_F(cppco, scheduler_resume_before_suspend)
+{
+	bool done = false;
+	co::scheduler scheduler;
+	scheduler.spawn([&done]()
+	{
+		co::resume(co::active_task());
+		co::suspend(); // Returns immediately because of the pending resume.
+		done = true;
+	});
+	scheduler.run();
+	EXPECT_TRUE(done);
+}
+
+TEST_F(cppco, scheduler_suspended_after_run)
+{
+	bool done = false;
+	auto task = co::scheduler::handle();
+	co::scheduler scheduler;
+	task = scheduler.spawn([&done]()
+	{
+		co::suspend();
+		done = true;
+	});
+	scheduler.run();
+	EXPECT_FALSE(done);
+	EXPECT_EQ(scheduler.size(), 1u);
+	scheduler.resume(task);
+	scheduler.run();
+	EXPECT_TRUE(done);
+}
+
+TEST_F(cppco, scheduler_failure)
+{
+	struct Dummy {};
+	bool done = false;
+	co::scheduler scheduler;
+	scheduler.spawn([]()
+	{
+		co::yield();
+		throw Dummy{};
+	});
+	scheduler.spawn([&done]()
+	{
+		co::yield();
+		co::yield();
+		done = true;
+	});
+	EXPECT_THROW(scheduler.run(), Dummy);
+	EXPECT_EQ(scheduler.size(), 1u);
+	scheduler.run();
+	EXPECT_TRUE(done);
+}
+
+TEST_F(cppco, scheduler_destroy_suspended)
+{
+	bool destructed = false;
+
+	class A
+	{
+	public:
+		A(bool& destructed)
+			: m_destructed{ &destructed }
+		{
+		}
+		~A()
+		{
+			*m_destructed = true;
+		}
+	private:
+		bool* m_destructed;
+	};
+
+	{
+		co::scheduler scheduler;
+		scheduler.spawn([&destructed]()
+		{
+			auto a = A(destructed);
+			co::suspend();
+		});
+		scheduler.run();
+		EXPECT_FALSE(destructed);
+	}
+	EXPECT_TRUE(destructed);
+}
+
+TEST_F(cppco, scheduler_reuse)
+{
+	auto count = 0;
+	co::scheduler scheduler;
+	CPPCO_EXPECT_CREATE(_).Times(1);
+	for (int i = 0; i < 3; ++i)
+	{
+		scheduler.spawn([&count]()
+		{
+			++count;
+		});
+		scheduler.run();
+	}
+	EXPECT_EQ(count, 3);
+}
+
+} // namespace cppco_test
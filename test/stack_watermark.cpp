@@ -0,0 +1,127 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+#include "libco_mock.hpp"
+#include "fixture.hpp"
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace cppco_test {
+
+namespace {
+
+constexpr size_t watermark_stack_size = 256 * 1024;
+constexpr size_t deep_buffer_size = 64 * 1024;
+
+char touch_stack(size_t size)
+{
+	// Writes from the top of the buffer down, so that `size` bytes of the frame are used.
+	volatile char buffer[deep_buffer_size];
+	for (size_t i = deep_buffer_size - size; i < deep_buffer_size; i += 256)
+	{
+		buffer[i] = 1;
+	}
+	buffer[deep_buffer_size - size] = 1;
+	return buffer[deep_buffer_size - size];
+}
+
+} // namespace
+
+TEST_F(cppco, stack_watermark_depth)
+{
+	EXPECT_CALL(libco_mock::api::get(), create(_, _)).Times(0);
+	EXPECT_CALL(libco_mock::api::get(), derive(_, _, _)).Times(2);
+	auto& parent = co::active();
+	auto shallow = co::thread([&parent]()
+	{
+		parent.switch_to();
+	}, watermark_stack_size);
+	auto deep = co::thread([&parent]()
+	{
+		touch_stack(deep_buffer_size);
+		parent.switch_to();
+	}, watermark_stack_size);
+	EXPECT_LT(shallow.stack_high_water(), watermark_stack_size);
+	shallow.switch_to();
+	deep.switch_to();
+	EXPECT_GT(shallow.stack_high_water(), 0u);
+	EXPECT_GE(deep.stack_high_water(), deep_buffer_size);
+	EXPECT_LT(deep.stack_high_water(), watermark_stack_size);
+	EXPECT_GT(deep.stack_high_water(), shallow.stack_high_water());
+	EXPECT_EQ(co::main().stack_high_water(), 0u);
+}
+
+TEST_F(cppco, stack_watermark_report)
+{
+	co::reset_stack_usage_report();
+	auto& parent = co::active();
+	auto deepest = size_t{ 0 };
+	for (auto depth : { size_t{ 1024 }, deep_buffer_size / 2, deep_buffer_size })
+	{
+		auto cothread = co::thread([&parent, depth]()
+		{
+			touch_stack(depth);
+			parent.switch_to();
+		}, watermark_stack_size);
+		cothread.switch_to();
+		deepest = std::max(deepest, cothread.stack_high_water());
+	}
+	{
+		// A cothread that was never entered is sampled as well.
+		auto idle = co::thread([]() {}, watermark_stack_size / 2);
+	}
+	auto report = co::stack_usage_report();
+	ASSERT_EQ(report.size(), 2u);
+	EXPECT_EQ(report[0].stack_size, watermark_stack_size / 2);
+	EXPECT_EQ(report[0].samples, 1u);
+	EXPECT_EQ(report[1].stack_size, watermark_stack_size);
+	EXPECT_EQ(report[1].samples, 3u);
+	EXPECT_EQ(report[1].max_high_water, deepest);
+	EXPECT_GE(report[1].max_high_water, deep_buffer_size);
+	EXPECT_GT(report[1].total_high_water, report[1].max_high_water);
+	co::reset_stack_usage_report();
+	EXPECT_TRUE(co::stack_usage_report().empty());
+}
+
+TEST_F(cppco, stack_watermark_thread_pool)
+{
+	EXPECT_CALL(libco_mock::api::get(), create(_, _)).Times(0);
+	EXPECT_CALL(libco_mock::api::get(), derive(_, _, _)).Times(1);
+	co::thread_pool pool;
+	auto& parent = co::active();
+	auto high_water = size_t{ 0 };
+	{
+		auto cothread = co::thread([&parent]()
+		{
+			touch_stack(deep_buffer_size);
+			parent.switch_to();
+		}, watermark_stack_size, pool);
+		cothread.switch_to();
+		high_water = cothread.stack_high_water();
+	}
+	auto ran = false;
+	auto cothread = co::thread([&parent, &ran]()
+	{
+		ran = true;
+		parent.switch_to();
+	}, watermark_stack_size, pool);
+	// The reused stack keeps the mark of the earlier entry functor.
+	EXPECT_GE(cothread.stack_high_water(), high_water);
+	cothread.switch_to();
+	EXPECT_TRUE(ran);
+	EXPECT_EQ(pool.get_statistics(watermark_stack_size).hits, 1u);
+}
+
+} // namespace cppco_test
@@ -0,0 +1,126 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+#include "libco_mock.hpp"
+#include "fixture.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace cppco_test {
+
+namespace {
+
+void spin_for(std::chrono::steady_clock::duration duration)
+{
+	auto end = std::chrono::steady_clock::now() + duration;
+	while (std::chrono::steady_clock::now() < end)
+	{
+	}
+}
+
+co::thread make_ping()
+{
+	auto& parent = co::active();
+	return co::thread([&parent]()
+	{
+		while (true)
+		{
+			parent.switch_to();
+		}
+	});
+}
+
+} // namespace
+
+TEST_F(cppco, stats_switches)
+{
+	auto cothread = make_ping();
+	EXPECT_EQ(cothread.stats().switches, 0u);
+	auto main_switches = co::active().stats().switches;
+	for (auto i = 0; i < 3; ++i)
+	{
+		cothread.switch_to();
+	}
+	EXPECT_EQ(cothread.stats().switches, 3u);
+	EXPECT_EQ(co::active().stats().switches, main_switches + 3);
+}
+
+TEST_F(cppco, stats_run_time)
+{
+	// Only a sample of the run slices is timed, so the cothread runs for many slices of the same length.
+	const auto slices = 4000;
+	const auto slice = std::chrono::microseconds(5);
+	auto& parent = co::active();
+	auto cothread = co::thread([&parent, slice]()
+	{
+		while (true)
+		{
+			spin_for(slice);
+			parent.switch_to();
+		}
+	});
+	for (auto i = 0; i < slices; ++i)
+	{
+		cothread.switch_to();
+	}
+	auto stats = cothread.stats();
+	EXPECT_EQ(stats.switches, static_cast<std::uint64_t>(slices));
+	EXPECT_GE(stats.run_time, slices * slice / 2);
+	EXPECT_GE(stats.longest_slice, slice);
+	EXPECT_LE(stats.longest_slice, stats.run_time);
+	EXPECT_LT(stats.run_time, std::chrono::seconds(1));
+}
+
+TEST_F(cppco, stats_snapshot)
+{
+	auto cothread = make_ping();
+	cothread.switch_to();
+	cothread.switch_to();
+	auto snapshot = co::stats_snapshot();
+	auto found = std::find_if(snapshot.begin(), snapshot.end(), [&cothread](const co::thread_stats_entry& entry)
+	{
+		return entry.owner == &cothread;
+	});
+	ASSERT_NE(found, snapshot.end());
+	EXPECT_EQ(found->stats.switches, 2u);
+	auto main = std::find_if(snapshot.begin(), snapshot.end(), [](const co::thread_stats_entry& entry)
+	{
+		return entry.owner == &co::active();
+	});
+	EXPECT_NE(main, snapshot.end());
+}
+
+TEST_F(cppco, stats_move)
+{
+	auto cothread = make_ping();
+	cothread.switch_to();
+	auto moved = std::move(cothread);
+	EXPECT_EQ(moved.stats().switches, 1u);
+	EXPECT_EQ(cothread.stats().switches, 0u);
+	moved.switch_to();
+	EXPECT_EQ(moved.stats().switches, 2u);
+	auto snapshot = co::stats_snapshot();
+	auto count = std::count_if(snapshot.begin(), snapshot.end(), [&cothread, &moved](const co::thread_stats_entry& entry)
+	{
+		return entry.owner == &cothread || entry.owner == &moved;
+	});
+	EXPECT_EQ(count, 2);
+}
+
+} // namespace cppco_test
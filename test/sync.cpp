@@ -0,0 +1,280 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+#include "libco_mock.hpp"
+#include <co/sync.hpp>
+#include "fixture.hpp"
+#include <algorithm>
+#include <mutex>
+#include <vector>
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace cppco_test {
+
+TEST_F(cppco, mutex_try_lock)
+{
+	co::mutex mutex;
+	EXPECT_TRUE(mutex.try_lock());
+	EXPECT_FALSE(mutex.try_lock());
+	mutex.unlock();
+	{
+		std::lock_guard<co::mutex> lock(mutex);
+		EXPECT_FALSE(mutex.try_lock());
+	}
+	EXPECT_TRUE(mutex.try_lock());
+	mutex.unlock();
+}
+
+TEST_F(cppco, mutex_scheduler_fifo)
+{
+	co::scheduler scheduler(64 * 1024);
+	co::mutex mutex;
+	auto order = std::vector<int>();
+	auto inside = 0;
+	for (auto id = 0; id < 3; ++id)
+	{
+		scheduler.spawn([&mutex, &order, &inside, id]()
+		{
+			for (auto i = 0; i < 2; ++i)
+			{
+				std::lock_guard<co::mutex> lock(mutex);
+				EXPECT_EQ(++inside, 1);
+				order.push_back(id);
+				co::yield();
+				--inside;
+			}
+		});
+	}
+	scheduler.run();
+	// Every unlock hands the mutex to the task that has waited for the longest time.
+	EXPECT_EQ(order, std::vector<int>({ 0, 1, 2, 0, 1, 2 }));
+	EXPECT_TRUE(mutex.try_lock());
+	mutex.unlock();
+}
+
+TEST_F(cppco, mutex_thread_hand_off)
+{
+	co::mutex mutex;
+	auto events = std::vector<int>();
+	auto waiter = co::thread([&mutex, &events]()
+	{
+		events.push_back(1);
+		mutex.lock();
+		events.push_back(3);
+		mutex.unlock();
+		co::active().get_parent().switch_to();
+	});
+	mutex.lock();
+	waiter.switch_to();
+	EXPECT_EQ(events, std::vector<int>({ 1 }));
+	// The waiter does not get the mutex by being switched to.
+	waiter.switch_to();
+	EXPECT_EQ(events, std::vector<int>({ 1 }));
+	events.push_back(2);
+	mutex.unlock();
+	EXPECT_EQ(events, std::vector<int>({ 1, 2, 3 }));
+	EXPECT_TRUE(mutex.try_lock());
+	mutex.unlock();
+}
+
+TEST_F(cppco, mutex_waiter_stopped)
+{
+	co::mutex mutex;
+	mutex.lock();
+	{
+		auto waiter = co::thread([&mutex]()
+		{
+			mutex.lock();
+			co::active().get_parent().switch_to();
+		});
+		waiter.switch_to();
+	}
+	// The stopped waiter left the wait list, so unlocking does not switch to it.
+	mutex.unlock();
+	EXPECT_TRUE(mutex.try_lock());
+	mutex.unlock();
+}
+
+TEST_F(cppco, mutex_signalled_waiter_stopped)
+{
+	co::mutex mutex;
+	auto locked = 0;
+	mutex.lock();
+	{
+		co::scheduler scheduler(64 * 1024);
+		for (auto i = 0; i < 2; ++i)
+		{
+			scheduler.spawn([&mutex, &locked]()
+			{
+				std::lock_guard<co::mutex> lock(mutex);
+				++locked;
+			});
+		}
+		scheduler.run();
+		// The first waiter is handed the mutex, but it is stopped before it runs.
+		mutex.unlock();
+	}
+	// It passed the mutex on to the second waiter, which was stopped too, and that one unlocked it.
+	EXPECT_EQ(locked, 0);
+	EXPECT_TRUE(mutex.try_lock());
+	mutex.unlock();
+}
+
+TEST_F(cppco, mutex_signalled_waiter_stopped_thread_next)
+{
+	co::mutex mutex;
+	auto locked = 0;
+	auto& parent = co::active();
+	auto waiter = co::thread([&mutex, &locked, &parent]()
+	{
+		{
+			std::lock_guard<co::mutex> lock(mutex);
+			++locked;
+		}
+		parent.switch_to();
+	});
+	mutex.lock();
+	{
+		co::scheduler scheduler(64 * 1024);
+		scheduler.spawn([&mutex, &locked]()
+		{
+			std::lock_guard<co::mutex> lock(mutex);
+			++locked;
+		});
+		scheduler.run();
+		waiter.switch_to();
+		// The waiting task is handed the mutex, but it is stopped before it runs.
+		mutex.unlock();
+	}
+	// It passed the mutex on to the waiting `co::thread`, which takes it when it is switched to.
+	EXPECT_EQ(locked, 0);
+	EXPECT_FALSE(mutex.try_lock());
+	waiter.switch_to();
+	EXPECT_EQ(locked, 1);
+	EXPECT_TRUE(mutex.try_lock());
+	mutex.unlock();
+}
+
+TEST_F(cppco, condition_variable_scheduler)
+{
+	co::scheduler scheduler(64 * 1024);
+	co::mutex mutex;
+	co::condition_variable ready;
+	auto items = std::vector<int>();
+	auto consumed = std::vector<int>();
+	for (auto i = 0; i < 2; ++i)
+	{
+		scheduler.spawn([&mutex, &ready, &items, &consumed]()
+		{
+			std::unique_lock<co::mutex> lock(mutex);
+			ready.wait(lock, [&items]() { return !items.empty(); });
+			consumed.push_back(items.back());
+			items.pop_back();
+		});
+	}
+	scheduler.spawn([&mutex, &ready, &items]()
+	{
+		{
+			std::lock_guard<co::mutex> lock(mutex);
+			items.push_back(1);
+		}
+		ready.notify_one();
+		co::yield();
+		{
+			std::lock_guard<co::mutex> lock(mutex);
+			items.push_back(2);
+		}
+		ready.notify_all();
+	}, co::scheduler::default_priority - 1);
+	scheduler.run();
+	EXPECT_EQ(consumed, std::vector<int>({ 1, 2 }));
+	EXPECT_TRUE(items.empty());
+}
+
+TEST_F(cppco, condition_variable_thread)
+{
+	co::mutex mutex;
+	co::condition_variable changed;
+	auto value = 0;
+	auto seen = std::vector<int>();
+	auto& parent = co::active();
+	auto make = [&mutex, &changed, &value, &seen, &parent]()
+	{
+		return [&mutex, &changed, &value, &seen, &parent]()
+		{
+			std::unique_lock<co::mutex> lock(mutex);
+			changed.wait(lock);
+			seen.push_back(value);
+			lock.unlock();
+			parent.switch_to();
+		};
+	};
+	auto a = co::thread(make());
+	auto b = co::thread(make());
+	a.switch_to();
+	b.switch_to();
+	value = 7;
+	// Each woken cothread switches back to its parent, which is the notifying cothread here, so it wakes the next one.
+	changed.notify_all();
+	EXPECT_EQ(seen, std::vector<int>({ 7, 7 }));
+}
+
+TEST_F(cppco, semaphore)
+{
+	co::scheduler scheduler(64 * 1024);
+	co::semaphore slots(2);
+	auto inside = 0;
+	auto peak = 0;
+	for (auto i = 0; i < 5; ++i)
+	{
+		scheduler.spawn([&slots, &inside, &peak]()
+		{
+			slots.acquire();
+			peak = std::max(peak, ++inside);
+			co::yield();
+			--inside;
+			slots.release();
+		});
+	}
+	scheduler.run();
+	EXPECT_EQ(peak, 2);
+	EXPECT_EQ(slots.available(), 2u);
+	EXPECT_TRUE(slots.try_acquire());
+	EXPECT_TRUE(slots.try_acquire());
+	EXPECT_FALSE(slots.try_acquire());
+	slots.release(2);
+	EXPECT_EQ(slots.available(), 2u);
+}
+
+TEST_F(cppco, semaphore_signalled_waiter_stopped)
+{
+	co::semaphore permits;
+	{
+		co::scheduler scheduler(64 * 1024);
+		scheduler.spawn([&permits]()
+		{
+			permits.acquire();
+		});
+		scheduler.run();
+		permits.release();
+		EXPECT_EQ(permits.available(), 0u);
+	}
+	// The permit handed to the stopped waiter is given back.
+	EXPECT_EQ(permits.available(), 1u);
+	EXPECT_TRUE(permits.try_acquire());
+}
+
+} // namespace cppco_test
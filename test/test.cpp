@@ -16,6 +16,8 @@
 #include <co.hpp>
 #include "fixture.hpp"
 #include <sstream>
+#include <memory>
+#include <vector>
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
@@ -31,16 +33,16 @@ TEST_F(cppco, default_construct)
 
 TEST_F(cppco, create_and_destroy)
 {
-	EXPECT_CALL(libco_mock::api::get(), create(_, _));
-	EXPECT_CALL(libco_mock::api::get(), delete_this(_));
+	CPPCO_EXPECT_CREATE(_);
+	CPPCO_EXPECT_DELETE(1);
 	co::thread cothread([]() {});
 }
 
 TEST_F(cppco, create_and_reset)
 {
-	EXPECT_CALL(libco_mock::api::get(), create(_, _));
+	CPPCO_EXPECT_CREATE(_);
 	EXPECT_CALL(libco_mock::api::get(), switch_to(_)).Times(4); // 2 in test, 2 in reset
-	EXPECT_CALL(libco_mock::api::get(), delete_this(_));
+	CPPCO_EXPECT_DELETE(1);
 	auto cothread = co::thread([]()
 	{
 		co::active().get_parent().switch_to();
@@ -94,9 +96,50 @@ TEST_F(cppco, move_assign)
 	EXPECT_TRUE(b);
 }
 
+TEST_F(cppco, move_assign_over_suspended)
+{
+	bool destructed = false;
+	bool resumed = false;
+
+	struct A
+	{
+		bool* destructed;
+		~A()
+		{
+			*destructed = true;
+		}
+	};
+
+	co::thread_pool pool;
+	auto& parent = co::active();
+	auto cothread = co::thread([&]()
+	{
+		auto a = A{ &destructed };
+		parent.switch_to();
+		resumed = true;
+		parent.switch_to();
+	}, co::thread::default_stack_size, pool);
+	cothread.switch_to();
+	cothread = co::thread([&parent]()
+	{
+		parent.switch_to();
+	}, co::thread::default_stack_size, pool);
+	EXPECT_TRUE(destructed);
+	EXPECT_FALSE(resumed);
+	// The replaced cothread went back to the pool and starts over with the entry functor of the next `co::thread`.
+	auto reused = co::thread([&parent]()
+	{
+		parent.switch_to();
+	}, co::thread::default_stack_size, pool);
+	EXPECT_EQ(pool.get_statistics(co::thread::default_stack_size).hits, 1u);
+	reused.switch_to();
+	cothread.switch_to();
+	EXPECT_FALSE(resumed);
+}
+
 TEST_F(cppco, creation_failure)
 {
-	EXPECT_CALL(libco_mock::api::get(), create(_, _)).WillOnce(Return(nullptr));
+	CPPCO_EXPECT_CREATE(_).WillOnce(Return(nullptr));
 	EXPECT_THROW(co::thread([]() {}), co::thread_create_failure);
 }
 
@@ -120,7 +163,7 @@ TEST_F(cppco, destructors)
 	};
 
 	{
-		EXPECT_CALL(libco_mock::api::get(), create(_, _)).Times(1);
+		CPPCO_EXPECT_CREATE(_).Times(1);
 		EXPECT_CALL(libco_mock::api::get(), switch_to(_)).Times(4); // 2 in test, 2 in reset
 		auto& parent = co::active();
 		auto cothread = co::thread([&parent, &destructed]()
@@ -204,6 +247,22 @@ TEST_F(cppco, exception_for_new_cothread)
 	EXPECT_TRUE(caught);
 }
 
+TEST_F(cppco, switch_to_fast)
+{
+	auto count = 0;
+	auto cothread = co::thread([&]()
+	{
+		++count;
+		co::active().get_parent().switch_to_fast();
+		++count;
+		co::active().get_parent().switch_to();
+	});
+	cothread.switch_to_fast();
+	EXPECT_EQ(count, 1);
+	cothread.switch_to();
+	EXPECT_EQ(count, 2);
+}
+
 TEST_F(cppco, reset_entry)
 {
 	auto& parent = co::active();
@@ -271,7 +330,7 @@ TEST_F(cppco, set_stack_size)
 
 TEST_F(cppco, set_stack_size_when_active)
 {
-	EXPECT_CALL(::libco_mock::api::get(), create(co::thread::default_stack_size, _)).Times(1);
+	CPPCO_EXPECT_CREATE(co::thread::default_stack_size).Times(1);
 	auto cothread = co::thread([]()
 	{
 		co::active().get_parent().switch_to();
@@ -279,11 +338,291 @@ TEST_F(cppco, set_stack_size_when_active)
 	cothread.switch_to(); // Activate it
 	EXPECT_TRUE(cothread);
 	EXPECT_EQ(cothread.get_stack_size(), co::thread::default_stack_size);
-	EXPECT_CALL(::libco_mock::api::get(), create(2 * co::thread::default_stack_size, _)).Times(1);
+	CPPCO_EXPECT_CREATE(2 * co::thread::default_stack_size).Times(1);
 	cothread.set_stack_size(2 * co::thread::default_stack_size);
 	EXPECT_EQ(cothread.get_stack_size(), 2 * co::thread::default_stack_size);
 }
 
+TEST_F(cppco, move_running_entry)
+{
+	auto& parent = co::active();
+	auto value = std::make_shared<int>(1);
+	auto seen = 0;
+	auto cothread = co::thread([value, &parent, &seen]()
+	{
+		seen = *value;
+		parent.switch_to();
+		seen = *value + 1;
+		parent.switch_to();
+	});
+	cothread.switch_to();
+	EXPECT_EQ(seen, 1);
+	auto moved_cothread = std::move(cothread);
+	auto moved_again = co::thread();
+	moved_again = std::move(moved_cothread);
+	moved_again.switch_to();
+	EXPECT_EQ(seen, 2);
+	moved_again.rewind();
+	moved_again.switch_to();
+	EXPECT_EQ(seen, 1);
+	EXPECT_EQ(value.use_count(), 2);
+	moved_again.reset();
+	EXPECT_EQ(value.use_count(), 1);
+}
+
+TEST_F(cppco, move_only_entry)
+{
+	struct move_only_entry
+	{
+		std::unique_ptr<int> value;
+		int* seen;
+
+		void operator()()
+		{
+			*seen = *value;
+			co::active().get_parent().switch_to();
+		}
+	};
+	auto seen = 0;
+	auto cothread = co::thread();
+	cothread.reset(move_only_entry{ std::unique_ptr<int>(new int(3)), &seen });
+	cothread.switch_to();
+	EXPECT_EQ(seen, 3);
+}
+
+TEST_F(cppco, large_entry)
+{
+	auto& parent = co::active();
+	struct large
+	{
+		char data[2 * co::thread::inline_entry_size];
+	};
+	auto payload = large{};
+	payload.data[sizeof(payload.data) - 1] = 'x';
+	char seen = 0;
+	auto cothread = co::thread([payload, &parent, &seen]()
+	{
+		seen = payload.data[sizeof(payload.data) - 1];
+		parent.switch_to();
+	});
+	auto moved_cothread = std::move(cothread);
+	moved_cothread.switch_to();
+	EXPECT_EQ(seen, 'x');
+}
+
+TEST_F(cppco, thread_pool_reuse)
+{
+	co::thread_pool pool;
+	CPPCO_EXPECT_CREATE(co::thread::default_stack_size).Times(1);
+	CPPCO_EXPECT_DELETE(0);
+	{
+		auto cothread = co::thread([]() {}, co::thread::default_stack_size, pool);
+	}
+	EXPECT_EQ(pool.get_retained(), co::thread::default_stack_size);
+	{
+		auto cothread = co::thread([]() {}, co::thread::default_stack_size, pool);
+		EXPECT_EQ(pool.get_retained(), 0u);
+	}
+	auto stats = pool.get_statistics(co::thread::default_stack_size);
+	EXPECT_EQ(stats.misses, 1u);
+	EXPECT_EQ(stats.hits, 1u);
+	EXPECT_EQ(stats.retained, 1u);
+	CPPCO_EXPECT_DELETE(1);
+	pool.clear();
+	EXPECT_EQ(pool.get_retained(), 0u);
+}
+
+TEST_F(cppco, deferred_create_on_switch)
+{
+	CPPCO_EXPECT_CREATE(_).Times(0);
+	auto& parent = co::active();
+	auto runs = 0;
+	auto cothread = co::thread(co::deferred, [&parent, &runs]()
+	{
+		while (true)
+		{
+			++runs;
+			parent.switch_to();
+		}
+	});
+	EXPECT_TRUE(cothread.is_deferred());
+	EXPECT_FALSE(cothread);
+	// Rewinding a deferred `co::thread` that never ran creates nothing.
+	cothread.rewind();
+	cothread.set_stack_size(co::thread::default_stack_size / 2);
+	libco_mock::api::verify();
+	CPPCO_EXPECT_CREATE(co::thread::default_stack_size / 2).Times(1);
+	cothread.switch_to();
+	cothread.switch_to();
+	EXPECT_TRUE(cothread);
+	EXPECT_EQ(runs, 2);
+	// The cothread is kept when the entry functor is rewound.
+	cothread.rewind();
+	cothread.switch_to();
+	EXPECT_EQ(runs, 3);
+}
+
+TEST_F(cppco, deferred_creation_failure)
+{
+	auto cothread = co::thread(co::deferred, []() {});
+	CPPCO_EXPECT_CREATE(_).WillOnce(Return(nullptr));
+	EXPECT_THROW(cothread.switch_to(), co::thread_create_failure);
+	EXPECT_FALSE(cothread);
+}
+
+TEST_F(cppco, deferred_thread_pool)
+{
+	co::thread_pool pool;
+	auto& parent = co::active();
+	{
+		auto cothread = co::thread(co::deferred, []() {}, co::thread::default_stack_size, pool);
+	}
+	EXPECT_EQ(pool.get_statistics(co::thread::default_stack_size).misses, 0u);
+	auto cothread = co::thread(co::deferred, [&parent]()
+	{
+		parent.switch_to();
+	}, co::thread::default_stack_size, pool);
+	cothread.switch_to();
+	EXPECT_EQ(pool.get_statistics(co::thread::default_stack_size).misses, 1u);
+}
+
+TEST_F(cppco, set_deferred)
+{
+	EXPECT_CALL(libco_mock::api::get(), create(_, _)).Times(0);
+	auto cothread = co::thread();
+	EXPECT_FALSE(cothread.is_deferred());
+	cothread.set_deferred(true);
+	cothread.reset([]() {});
+	libco_mock::api::verify();
+	// A moved `co::thread` stays deferred.
+	auto moved = std::move(cothread);
+	EXPECT_TRUE(moved.is_deferred());
+	EXPECT_FALSE(cothread.is_deferred());
+}
+
+TEST_F(cppco, thread_pool_reuse_stopped)
+{
+	co::thread_pool pool;
+	auto& parent = co::active();
+	bool a = false;
+	bool b = false;
+	CPPCO_EXPECT_CREATE(_).Times(1);
+	auto cothread = co::thread([&]()
+	{
+		a = true;
+		parent.switch_to();
+	}, co::thread::default_stack_size, pool);
+	cothread.switch_to();
+	EXPECT_TRUE(a);
+	cothread.reset();
+	auto other_cothread = co::thread([&]()
+	{
+		b = true;
+		parent.switch_to();
+	}, co::thread::default_stack_size, pool);
+	other_cothread.switch_to();
+	EXPECT_TRUE(b);
+	EXPECT_TRUE(other_cothread);
+	EXPECT_EQ(pool.get_statistics(co::thread::default_stack_size).hits, 1u);
+}
+
+TEST_F(cppco, thread_pool_max_retained)
+{
+	co::thread_pool pool(co::thread::default_stack_size);
+	CPPCO_EXPECT_CREATE(_).Times(2);
+	CPPCO_EXPECT_DELETE(1);
+	{
+		auto first = co::thread([]() {}, co::thread::default_stack_size, pool);
+		auto second = co::thread([]() {}, co::thread::default_stack_size, pool);
+	}
+	EXPECT_EQ(pool.get_retained(), co::thread::default_stack_size);
+	CPPCO_EXPECT_DELETE(1);
+	pool.set_max_retained(0);
+	EXPECT_EQ(pool.get_retained(), 0u);
+}
+
+TEST_F(cppco, cooperative_stop)
+{
+	bool destructed = false;
+	bool stopped = false;
+
+	class A
+	{
+	public:
+		A(bool& destructed)
+			: m_destructed{ &destructed }
+		{
+		}
+		~A()
+		{
+			*m_destructed = true;
+		}
+	private:
+		bool* m_destructed;
+	};
+
+	auto& parent = co::active();
+	auto cothread = co::thread([&]()
+	{
+		auto a = A(destructed);
+		EXPECT_FALSE(co::stop_requested());
+		while (!co::stop_requested())
+		{
+			parent.switch_to();
+		}
+		stopped = true;
+	});
+	cothread.set_stop_mode(co::stop_mode::cooperative);
+	cothread.switch_to();
+	EXPECT_FALSE(cothread.stop_requested());
+	cothread.rewind();
+	EXPECT_TRUE(stopped);
+	EXPECT_TRUE(destructed);
+	EXPECT_FALSE(cothread);
+	stopped = false;
+	cothread.switch_to();
+	EXPECT_TRUE(cothread);
+	EXPECT_FALSE(stopped);
+}
+
+TEST_F(cppco, abandon_stop)
+{
+	bool destructed = false;
+	int runs = 0;
+
+	class A
+	{
+	public:
+		A(bool& destructed)
+			: m_destructed{ &destructed }
+		{
+		}
+		~A()
+		{
+			*m_destructed = true;
+		}
+	private:
+		bool* m_destructed;
+	};
+
+	auto& parent = co::active();
+	CPPCO_EXPECT_CREATE(_).Times(2);
+	CPPCO_EXPECT_DELETE(2);
+	auto cothread = co::thread([&]()
+	{
+		++runs;
+		auto a = A(destructed);
+		parent.switch_to();
+	});
+	cothread.set_stop_mode(co::stop_mode::abandon);
+	cothread.switch_to();
+	cothread.rewind();
+	EXPECT_FALSE(destructed);
+	EXPECT_FALSE(cothread);
+	cothread.switch_to(); // The entry functor is reclaimed from the abandoned cothread and runs again.
+	EXPECT_EQ(runs, 2);
+}
+
 #ifdef CPPCO_LIBCO_INTEROP
 TEST_F(cppco, libco_interop)
 {
@@ -332,6 +671,74 @@ TEST_F(cppco, libco_interop)
 
 	co::clear_external();
 }
+
+TEST_F(cppco, libco_interop_registry)
+{
+	constexpr size_t count = 100;
+	auto cothreads = std::vector<co::thread>();
+	cothreads.reserve(count);
+	auto hits = size_t{ 0 };
+	for (size_t i = 0; i < count; ++i)
+	{
+		cothreads.emplace_back([&cothreads, &hits]()
+		{
+			while (true)
+			{
+				auto&& self = co::active();
+				hits += static_cast<size_t>(&self >= cothreads.data() && &self < cothreads.data() + cothreads.size());
+				self.get_parent().switch_to();
+			}
+		});
+	}
+	// Removing every other cothread exercises the deletion from the middle of probe sequences.
+	for (size_t i = 0; i < count; i += 2)
+	{
+		cothreads[i].reset();
+	}
+	for (size_t i = 1; i < count; i += 2)
+	{
+		cothreads[i].switch_to();
+	}
+	EXPECT_EQ(hits, count / 2);
+	EXPECT_EQ(&co::active(), &co::main());
+}
+
+TEST_F(cppco, libco_interop_external_reuse)
+{
+	co::init();
+	auto external = co_create(static_cast<unsigned int>(co::thread::default_stack_size), +[]() {});
+	// Make `co::active()` encounter `external` as if it was running.
+	EXPECT_CALL(libco_mock::api::get(), active()).WillOnce(Return(external)).WillRepeatedly(DoDefault());
+	auto& external_thread = co::active();
+	EXPECT_NE(&external_thread, &co::main());
+	// A new cothread of `cppco` at the same address replaces the external one in the registry. It is never entered.
+	EXPECT_CALL(libco_mock::api::get(), create(_, _)).WillOnce(Return(external));
+	auto cothread = co::thread([]() {});
+	EXPECT_EQ(&co::active(), &co::main());
+	co::clear_external();
+	EXPECT_EQ(&co::active(), &co::main());
+}
+
+TEST_F(cppco, libco_interop_owned_reuse)
+{
+	auto& parent = co::active();
+	auto reused = cothread_t{};
+	auto stale = co::thread([&]()
+	{
+		reused = co_active();
+		parent.switch_to();
+	});
+	stale.switch_to();
+	// A cothread at an address that still has the entry of an owned `co::thread` takes the entry over.
+	EXPECT_CALL(libco_mock::api::get(), create(_, _)).WillOnce(Return(reused));
+	auto cothread = co::thread([]() {});
+	EXPECT_EQ(&co::active(), &co::main());
+	// The cothread is deleted only once, by the `co::thread` that created it.
+	EXPECT_CALL(libco_mock::api::get(), delete_this(reused)).WillOnce(Return()).WillOnce(DoDefault());
+	cothread.reset();
+	stale.reset();
+	EXPECT_EQ(&co::active(), &co::main());
+}
 #endif // CPPCO_LIBCO_INTEROP
 
 } // namespace cppco_test
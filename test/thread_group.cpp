@@ -0,0 +1,169 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+#include "libco_mock.hpp"
+#include <co/thread_group.hpp>
+#include "fixture.hpp"
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace cppco_test {
+
+namespace {
+
+constexpr size_t group_stack_size = 64 * 1024;
+
+} // namespace
+
+TEST_F(cppco, thread_group_run)
+{
+	constexpr size_t count = 8;
+	EXPECT_CALL(libco_mock::api::get(), create(_, _)).Times(0);
+	EXPECT_CALL(libco_mock::api::get(), derive(_, _, _)).Times(static_cast<int>(count));
+	auto& parent = co::active();
+	auto seen = std::vector<size_t>();
+	co::thread_group group(count, [&parent, &seen](size_t index)
+	{
+		seen.push_back(index);
+		parent.switch_to();
+	}, group_stack_size);
+	EXPECT_EQ(group.size(), count);
+	EXPECT_EQ(group.get_stack_size(), group_stack_size);
+	for (auto&& cothread : group)
+	{
+		EXPECT_EQ(cothread.get_stack_size(), group_stack_size);
+		EXPECT_EQ(&cothread.get_parent(), &parent);
+		cothread.switch_to();
+	}
+	EXPECT_EQ(seen, std::vector<size_t>({ 0, 1, 2, 3, 4, 5, 6, 7 }));
+}
+
+TEST_F(cppco, thread_group_rewind)
+{
+	EXPECT_CALL(libco_mock::api::get(), derive(_, _, _)).Times(3);
+	auto& parent = co::active();
+	auto steps = std::vector<int>(3, 0);
+	auto destroyed = 0;
+	struct guard
+	{
+		int& destroyed;
+		~guard()
+		{
+			++destroyed;
+		}
+	};
+	co::thread_group group(3, [&parent, &steps, &destroyed](size_t index)
+	{
+		guard g{ destroyed };
+		while (true)
+		{
+			++steps[index];
+			parent.switch_to();
+		}
+	}, group_stack_size);
+	group[0].switch_to();
+	group[0].switch_to();
+	group[1].switch_to();
+	EXPECT_EQ(steps, std::vector<int>({ 2, 1, 0 }));
+	group.rewind();
+	EXPECT_EQ(destroyed, 2);
+	for (auto&& cothread : group)
+	{
+		cothread.switch_to();
+	}
+	EXPECT_EQ(steps, std::vector<int>({ 3, 2, 1 }));
+	group.clear();
+	EXPECT_EQ(destroyed, 5);
+	EXPECT_EQ(group.size(), 0u);
+}
+
+TEST_F(cppco, thread_group_rewind_and_reset_one)
+{
+	static_assert(std::is_same<decltype(std::declval<co::thread_group&>()[0]), const co::thread&>::value,
+		"the co::threads of a group cannot be moved out of it");
+	static_assert(std::is_same<decltype(*std::declval<co::thread_group&>().begin()), const co::thread&>::value,
+		"the co::threads of a group cannot be moved out of it");
+	auto& parent = co::active();
+	auto steps = std::vector<int>(2, 0);
+	auto destroyed = 0;
+	struct guard
+	{
+		int& destroyed;
+		~guard()
+		{
+			++destroyed;
+		}
+	};
+	co::thread_group group(2, [&parent, &steps, &destroyed](size_t index)
+	{
+		guard g{ destroyed };
+		while (true)
+		{
+			++steps[index];
+			parent.switch_to();
+		}
+	}, group_stack_size);
+	group[0].switch_to();
+	group[1].switch_to();
+	group.rewind(0);
+	EXPECT_EQ(destroyed, 1);
+	group[0].switch_to();
+	EXPECT_EQ(steps, std::vector<int>({ 2, 1 }));
+	group.reset(1);
+	EXPECT_EQ(destroyed, 2);
+	EXPECT_FALSE(group[1]);
+	EXPECT_EQ(group.size(), 2u);
+	group[0].switch_to();
+	EXPECT_EQ(steps, std::vector<int>({ 3, 1 }));
+}
+
+TEST_F(cppco, thread_group_teardown_order)
+{
+	auto& parent = co::active();
+	auto order = std::vector<size_t>();
+	struct guard
+	{
+		std::vector<size_t>& order;
+		size_t index;
+		~guard()
+		{
+			order.push_back(index);
+		}
+	};
+	{
+		co::thread_group group(4, [&parent, &order](size_t index)
+		{
+			guard g{ order, index };
+			parent.switch_to();
+		}, group_stack_size);
+		for (size_t i = 4; i-- > 0;)
+		{
+			group[i].switch_to();
+		}
+	}
+	EXPECT_EQ(order, std::vector<size_t>({ 0, 1, 2, 3 }));
+}
+
+TEST_F(cppco, thread_group_empty)
+{
+	co::thread_group group(0, [](size_t) {}, group_stack_size);
+	EXPECT_EQ(group.size(), 0u);
+	EXPECT_EQ(group.begin(), group.end());
+}
+
+} // namespace cppco_test
@@ -0,0 +1,112 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+#include "libco_mock.hpp"
+#include <co/timer.hpp>
+#include "fixture.hpp"
+#include <chrono>
+#include <vector>
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace cppco_test {
+
+using clock = co::timer_wheel::clock;
+using std::chrono::milliseconds;
+using std::chrono::hours;
+
+TEST_F(cppco, timer_wheel_sleep_for)
+{
+	auto trace = std::vector<int>();
+	co::timer_wheel wheel;
+	co::scheduler scheduler;
+	auto start = clock::now();
+	for (int i : { 3, 1, 2 })
+	{
+		scheduler.spawn([&trace, i]()
+		{
+			co::sleep_for(milliseconds(10 * i));
+			trace.push_back(i);
+		});
+	}
+	wheel.run(scheduler);
+	EXPECT_EQ(trace, std::vector<int>({ 1, 2, 3 }));
+	EXPECT_GE(clock::now() - start, milliseconds(30));
+	EXPECT_TRUE(wheel.empty());
+}
+
+TEST_F(cppco, timer_wheel_never_early)
+{
+	co::timer_wheel wheel;
+	co::timer_wheel::timer t;
+	auto now = clock::now();
+	wheel.arm(t, now + milliseconds(5), co::scheduler::handle());
+	EXPECT_TRUE(t.armed());
+	EXPECT_EQ(wheel.size(), 1u);
+	EXPECT_EQ(wheel.advance(now + milliseconds(4)), 0u);
+	EXPECT_FALSE(t.expired());
+	EXPECT_LE(wheel.time_until_next(now), milliseconds(6));
+	EXPECT_EQ(wheel.advance(now + milliseconds(6)), 1u);
+	EXPECT_TRUE(t.expired());
+	EXPECT_FALSE(t.armed());
+	EXPECT_EQ(wheel.time_until_next(now), clock::duration::max());
+}
+
+TEST_F(cppco, timer_wheel_cascade)
+{
+	co::timer_wheel wheel;
+	auto now = clock::now();
+	// One timer per level, and one beyond the range of the wheel.
+	co::timer_wheel::timer timers[5];
+	const clock::duration delays[5] = { milliseconds(100), milliseconds(10000), hours(1), hours(10), hours(30) };
+	for (size_t i = 0; i < 5; ++i)
+	{
+		wheel.arm(timers[i], now + delays[i], co::scheduler::handle());
+	}
+	for (size_t i = 0; i < 5; ++i)
+	{
+		EXPECT_EQ(wheel.advance(now + delays[i] - milliseconds(2)), 0u) << i;
+		EXPECT_FALSE(timers[i].expired()) << i;
+		EXPECT_EQ(wheel.advance(now + delays[i] + milliseconds(1)), 1u) << i;
+		EXPECT_TRUE(timers[i].expired()) << i;
+	}
+	EXPECT_TRUE(wheel.empty());
+}
+
+TEST_F(cppco, timer_wheel_cancel)
+{
+	co::timer_wheel wheel;
+	auto now = clock::now();
+	{
+		co::timer_wheel::timer destroyed;
+		wheel.arm(destroyed, now + milliseconds(1), co::scheduler::handle());
+	}
+	co::timer_wheel::timer cancelled;
+	wheel.arm(cancelled, now + milliseconds(1), co::scheduler::handle());
+	wheel.cancel(cancelled);
+	EXPECT_FALSE(cancelled.armed());
+	EXPECT_TRUE(wheel.empty());
+	EXPECT_EQ(wheel.advance(now + milliseconds(10)), 0u);
+	EXPECT_FALSE(cancelled.expired());
+	// Re-arming moves a timer.
+	co::timer_wheel::timer moved;
+	wheel.arm(moved, now + milliseconds(20), co::scheduler::handle());
+	wheel.arm(moved, now + milliseconds(40), co::scheduler::handle());
+	EXPECT_EQ(wheel.size(), 1u);
+	EXPECT_EQ(wheel.advance(now + milliseconds(30)), 0u);
+	EXPECT_EQ(wheel.advance(now + milliseconds(50)), 1u);
+}
+
+} // namespace cppco_test
@@ -0,0 +1,135 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+#include "libco_mock.hpp"
+#include "fixture.hpp"
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace cppco_test {
+
+namespace {
+
+std::string flush_trace()
+{
+	auto out = std::ostringstream();
+	co::trace::flush(out);
+	return out.str();
+}
+
+std::string address(const void* p)
+{
+	auto out = std::ostringstream();
+	out << "\"0x" << std::hex << reinterpret_cast<std::uintptr_t>(p) << '"';
+	return out.str();
+}
+
+size_t count(const std::string& text, const std::string& pattern)
+{
+	auto result = size_t{ 0 };
+	for (auto pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1))
+	{
+		++result;
+	}
+	return result;
+}
+
+} // namespace
+
+TEST_F(cppco, trace_switches)
+{
+	co::trace::clear();
+	auto& parent = co::active();
+	{
+		auto cothread = co::thread([&parent]()
+		{
+			parent.switch_to();
+			parent.switch_to();
+		});
+		cothread.switch_to();
+		cothread.switch_to();
+	}
+	auto trace = flush_trace();
+	EXPECT_EQ(trace.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["), 0u);
+	EXPECT_EQ(trace.substr(trace.size() - 4), "\n]}\n");
+	EXPECT_EQ(count(trace, "\"name\":\"create\""), 1u);
+	EXPECT_EQ(count(trace, "\"name\":\"stop\""), 1u);
+	EXPECT_EQ(count(trace, "\"name\":\"reset\""), 1u);
+	// Three slices of the cothread, the last one for the stop, and the two slices of the main cothread between them.
+	// The main cothread that runs again since the stop is still running.
+	EXPECT_EQ(count(trace, "\"ph\":\"X\""), 5u);
+	EXPECT_EQ(count(trace, "\"name\":" + address(libco_mock::active()) + ",\"cat\":\"cothread\",\"ph\":\"X\""), 2u);
+	EXPECT_EQ(flush_trace().find("\"ph\":\"X\""), std::string::npos);
+}
+
+TEST_F(cppco, trace_failure)
+{
+	co::trace::clear();
+	auto cothread = co::thread([]()
+	{
+		throw std::runtime_error("failure");
+	});
+	EXPECT_THROW(cothread.switch_to(), std::runtime_error);
+	auto trace = flush_trace();
+	EXPECT_EQ(count(trace, "\"name\":\"failure\""), 1u);
+	EXPECT_EQ(count(trace, "\"target\":" + address(libco_mock::active())), 1u);
+	EXPECT_EQ(count(trace, "\"ph\":\"X\""), 1u);
+}
+
+TEST_F(cppco, trace_os_threads)
+{
+	co::trace::clear();
+	auto before = count(flush_trace(), "\"name\":\"thread_name\"");
+	auto worker = std::thread([]()
+	{
+		auto& parent = co::active();
+		auto cothread = co::thread([&parent]()
+		{
+			parent.switch_to();
+		});
+		cothread.switch_to();
+	});
+	worker.join();
+	auto trace = flush_trace();
+	EXPECT_EQ(count(trace, "\"name\":\"thread_name\""), before + 1);
+	EXPECT_EQ(count(trace, "\"name\":\"create\""), 1u);
+	// The ring buffer of the exited OS thread is dropped by the flush.
+	EXPECT_EQ(count(flush_trace(), "\"name\":\"thread_name\""), before);
+}
+
+TEST(cppco_trace, ring_buffer_overwrites)
+{
+	auto buffer = std::unique_ptr<co::trace::ring_buffer>(new co::trace::ring_buffer(0));
+	auto total = co::trace::ring_buffer::capacity + 10;
+	for (size_t i = 0; i < total; ++i)
+	{
+		buffer->push(co::trace::event{ i, co::trace::event_kind::create, nullptr, nullptr });
+	}
+	auto events = buffer->take();
+	// The oldest slot counts as being reused, so one event less than the capacity is kept.
+	ASSERT_EQ(events.size(), co::trace::ring_buffer::capacity - 1);
+	EXPECT_EQ(events.front().timestamp, 11u);
+	EXPECT_EQ(events.back().timestamp, total - 1);
+	EXPECT_TRUE(buffer->take().empty());
+	buffer->push(co::trace::event{ total, co::trace::event_kind::stop, nullptr, nullptr });
+	events = buffer->take();
+	ASSERT_EQ(events.size(), 1u);
+	EXPECT_EQ(events.front().kind, co::trace::event_kind::stop);
+}
+
+} // namespace cppco_test
@@ -0,0 +1,131 @@
+// Copyright(C) 2024 by Balazs Cziraki <balazs.cziraki@gmail.com>
+//
+// Permission to use, copy, modify, and /or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above copyright
+// notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+// FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+// OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+// TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+// THIS SOFTWARE.
+
+
+#include "libco_mock.hpp"
+#include "fixture.hpp"
+#include <memory>
+#include <string>
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace cppco_test {
+
+namespace {
+
+/// Counts its copies and moves.
+struct counted
+{
+	static int copies;
+	static int moves;
+
+	int value;
+
+	explicit counted(int value) noexcept
+		: value{ value }
+	{
+	}
+	counted(const counted& other) noexcept
+		: value{ other.value }
+	{
+		++copies;
+	}
+	counted(counted&& other) noexcept
+		: value{ other.value }
+	{
+		++moves;
+	}
+};
+
+int counted::copies = 0;
+int counted::moves = 0;
+
+} // namespace
+
+TEST_F(cppco, transfer_ping_pong)
+{
+	auto& parent = co::active();
+	auto doubler = co::thread([&parent]()
+	{
+		auto value = co::receive<int>();
+		while (true)
+		{
+			value = parent.switch_to<int>(value * 2);
+		}
+	});
+	EXPECT_EQ(doubler.switch_to<int>(1), 2);
+	EXPECT_EQ(doubler.switch_to<int>(21), 42);
+	EXPECT_EQ(doubler.switch_to<int>(-3), -6);
+}
+
+TEST_F(cppco, transfer_moves)
+{
+	counted::copies = 0;
+	counted::moves = 0;
+	auto& parent = co::active();
+	auto received = 0;
+	auto cothread = co::thread([&parent, &received]()
+	{
+		auto value = co::receive<counted>();
+		received = value.value;
+		parent.switch_to(counted(value.value + 1));
+	});
+	auto reply = cothread.switch_to<counted>(counted(7));
+	EXPECT_EQ(received, 7);
+	EXPECT_EQ(reply.value, 8);
+	EXPECT_EQ(counted::copies, 0);
+}
+
+TEST_F(cppco, transfer_move_only)
+{
+	auto& parent = co::active();
+	auto cothread = co::thread([&parent]()
+	{
+		auto owned = co::receive<std::unique_ptr<std::string>>();
+		owned->append(" world");
+		parent.switch_to(std::move(owned));
+	});
+	auto text = std::unique_ptr<std::string>(new std::string("hello"));
+	auto* address = text.get();
+	auto reply = cothread.switch_to<std::unique_ptr<std::string>>(std::move(text));
+	EXPECT_EQ(reply.get(), address);
+	EXPECT_EQ(*reply, "hello world");
+}
+
+TEST_F(cppco, transfer_ignored)
+{
+	auto& parent = co::active();
+	auto cothread = co::thread([&parent]()
+	{
+		// Resumed by a switch that passes a value, which is dropped.
+		co::receive<void>();
+		parent.switch_to(std::string("reply"));
+		parent.switch_to();
+	});
+	EXPECT_EQ(cothread.switch_to<std::string>(1), "reply");
+	// The cothread answers with a plain switch, so there is nothing to receive.
+	cothread.switch_to<void>(std::string("ignored"));
+}
+
+TEST_F(cppco, transfer_failure)
+{
+	auto cothread = co::thread([]()
+	{
+		static_cast<void>(co::receive<int>());
+		throw std::runtime_error("failed");
+	});
+	EXPECT_THROW(cothread.switch_to<int>(1), std::runtime_error);
+}
+
+} // namespace cppco_test